@@ -0,0 +1,302 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_port.h"
+#include "bitblt.h"
+
+void srn_bitmap_init(srn_bitmap_t *this, uint8_t *pixels, int width, int height) {
+  this->pixels = pixels;
+  this->width = width;
+  this->height = height;
+  this->page_stride = width;
+  this->col_stride = 1;
+  this->screen = false;
+}
+
+void srn_screen_bitmap(srn_bitmap_t *this) {
+  this->pixels = &SRN_PAGE_BYTE(0, 0);
+  this->width = 128;
+  this->height = 128;
+  this->page_stride = &SRN_PAGE_BYTE(1, 0) - &SRN_PAGE_BYTE(0, 0);
+  this->col_stride = &SRN_PAGE_BYTE(0, 1) - &SRN_PAGE_BYTE(0, 0);
+  this->screen = true;
+}
+
+// RASTER OPS
+// rop() works on bytes or words alike.  The result is only stored where
+// the mask is set.
+
+static inline uint32_t rop(uint32_t d, uint32_t s, srn_rop_t op) {
+  switch (op) {
+  case SRN_ROP_COPY: return s;
+  case SRN_ROP_OR: return d | s;
+  case SRN_ROP_AND: return d & s;
+  case SRN_ROP_AND_NOT: return d & ~s;
+  case SRN_ROP_XOR: return d ^ s;
+  case SRN_ROP_NOT_COPY: return ~s;
+  case SRN_ROP_INVERT: return ~d;
+  case SRN_ROP_CLEAR: return 0;
+  case SRN_ROP_SET: return 0xFFFFFFFF;
+  }
+  return d;
+}
+
+static inline uint32_t rop_masked(uint32_t d, uint32_t s, uint32_t m, srn_rop_t op) {
+  return (d & ~m) | (rop(d, s, op) & m);
+}
+
+// BLIT
+// A blit covers the destination rectangle x0, y0 to x1, y1, already
+// clipped.  Destination row y takes source row y + dy and column x takes
+// source column x + dx.  When the source and destination are the same
+// bitmap the pages and columns are walked in the order that reads every
+// source byte before it is overwritten.
+
+typedef struct blit {
+  const srn_bitmap_t *src;   // NULL for ops without a source
+  srn_bitmap_t *dst;
+  int x0, y0, x1, y1;
+  int dx, dy;
+  srn_rop_t op;
+  bool same;                 // the source pixels are the destination's
+  bool backwards;            // columns last to first
+} blit_t;
+
+// page of the source holding row base, and the shift of base in it
+static inline int floor_page(int base) {
+  return base >= 0 ? base >> 3 : -((7 - base) >> 3);
+}
+
+// a source page row at column x, NULL if the page is outside the bitmap
+static inline const uint8_t *src_row(const blit_t *b, int page, int x) {
+  const srn_bitmap_t *s = b->src;
+  if (page < 0 || page >= (s->height + 7) >> 3) return NULL;
+  return s->pixels + page * s->page_stride + x * s->col_stride;
+}
+
+// columns x to x + n - 1 of page p, a byte at a time
+static void blit_bytes(const blit_t *b, int p, int x, int n, uint8_t m) {
+  int step = b->backwards ? -1 : 1;
+  if (b->backwards) x += n - 1;
+  uint8_t *d = b->dst->pixels + p * b->dst->page_stride + x * b->dst->col_stride;
+  int dstep = step * b->dst->col_stride;
+  if (b->src == NULL) {
+    for (int i = 0; i < n; i++, d += dstep) *d = rop_masked(*d, 0, m, b->op);
+    return;
+  }
+  int base = p * 8 + b->dy;
+  int sp = floor_page(base);
+  int sh = base - sp * 8;
+  const uint8_t *s0 = src_row(b, sp, x + b->dx);
+  const uint8_t *s1 = sh ? src_row(b, sp + 1, x + b->dx) : NULL;
+  int sstep = step * b->src->col_stride;
+  for (int i = 0; i < n; i++, d += dstep) {
+    uint8_t s = 0;
+    // read both source bytes before the store, they may be *d
+    if (s0 != NULL) s = s0[i * sstep] >> sh;
+    if (s1 != NULL) s |= s1[i * sstep] << (8 - sh);
+    *d = rop_masked(*d, s, m, b->op);
+  }
+}
+
+// the four source bytes at p, which is k bytes past a word boundary
+static inline uint32_t load_word(const uint8_t *p, int k) {
+  const uint32_t *w = (const uint32_t *)(p - k);
+  return k ? (w[0] >> (8 * k)) | (w[1] << (32 - 8 * k)) : w[0];
+}
+
+// the inner loop of blit_words(), inlined once per raster op so the op is
+// not decided again for every word
+static inline __attribute__((always_inline))
+void words_loop(uint32_t *d, int step, int n, const uint8_t *s0, const uint8_t *s1,
+                int k, int sh, uint32_t m32, srn_rop_t op) {
+  uint32_t lo_lanes = (0xFF >> sh) * 0x01010101u;
+  for (int i = 0; i < n; i++, d += step) {
+    uint32_t s = 0;
+    // a shift moves the bits within each byte lane
+    if (s0 != NULL) s = (load_word(s0 + i * step * 4, k) >> sh) & lo_lanes;
+    if (s1 != NULL) s |= (load_word(s1 + i * step * 4, k) << (8 - sh)) & ~lo_lanes;
+    *d = rop_masked(*d, s, m32, op);
+  }
+}
+
+// columns x to x + 4 * n - 1 of page p, four at a time.  x is on a word
+// boundary of the destination.  Source columns that are not on a word
+// boundary are put together from two words.
+static void blit_words(const blit_t *b, int p, int x, int n, uint8_t m) {
+  int step = b->backwards ? -1 : 1;
+  if (b->backwards) x += (n - 1) * 4;
+  uint32_t *d = (uint32_t *)(b->dst->pixels + p * b->dst->page_stride + x);
+  uint32_t m32 = m * 0x01010101u;
+  const uint8_t *s0 = NULL, *s1 = NULL;
+  int k = 0, sh = 0;
+  if (b->src != NULL) {
+    int base = p * 8 + b->dy;
+    int sp = floor_page(base);
+    sh = base - sp * 8;
+    k = (x + b->dx) & 3;
+    s0 = src_row(b, sp, x + b->dx);
+    s1 = sh ? src_row(b, sp + 1, x + b->dx) : NULL;
+  }
+  switch (b->op) {
+  case SRN_ROP_COPY: words_loop(d, step, n, s0, s1, k, sh, m32, SRN_ROP_COPY); break;
+  case SRN_ROP_OR: words_loop(d, step, n, s0, s1, k, sh, m32, SRN_ROP_OR); break;
+  case SRN_ROP_CLEAR: words_loop(d, step, n, NULL, NULL, 0, 0, m32, SRN_ROP_CLEAR); break;
+  case SRN_ROP_SET: words_loop(d, step, n, NULL, NULL, 0, 0, m32, SRN_ROP_SET); break;
+  default: words_loop(d, step, n, s0, s1, k, sh, m32, b->op); break;
+  }
+}
+
+static inline bool word_aligned(const srn_bitmap_t *bm) {
+  return bm->col_stride == 1 && (bm->page_stride & 3) == 0 &&
+         ((uintptr_t)bm->pixels & 3) == 0;
+}
+
+static void blit_pages(const blit_t *b) {
+  int p0 = b->y0 >> 3;
+  int p1 = b->y1 >> 3;
+  // whole words of columns can be used if the rows are whole words
+  bool words = word_aligned(b->dst) && (b->src == NULL || word_aligned(b->src));
+  int a = (b->x0 + 3) & ~3;  // first column of a whole word
+  int e = (b->x1 + 1) & ~3;  // column after the last whole word
+  if (!words || a >= e) {
+    a = e = b->x1 + 1;
+  }
+  // rows move up when dy > 0, so the pages are done top to bottom
+  bool up = !b->same || b->dy >= 0;
+  for (int i = 0; i <= p1 - p0; i++) {
+    int p = up ? p0 + i : p1 - i;
+    uint8_t m = 0xFF;
+    if (p == p0) m &= 0xFF << (b->y0 & 7);
+    if (p == p1) m &= 0xFF >> (7 - (b->y1 & 7));
+    if (b->backwards) {
+      blit_bytes(b, p, e, b->x1 - e + 1, m);
+      blit_words(b, p, a, (e - a) >> 2, m);
+      blit_bytes(b, p, b->x0, a - b->x0, m);
+    } else {
+      blit_bytes(b, p, b->x0, a - b->x0, m);
+      blit_words(b, p, a, (e - a) >> 2, m);
+      blit_bytes(b, p, e, b->x1 - e + 1, m);
+    }
+  }
+}
+
+// COLUMN-MAJOR LAYOUT
+// A 128 pixel column is 16 contiguous bytes, four words with row y in bit
+// y & 31 of word y >> 5.  A blit then shifts whole columns.
+
+static inline bool column_major(const srn_bitmap_t *bm) {
+  return bm->col_stride == 16 && bm->page_stride == 1 && bm->height == 128 &&
+         ((uintptr_t)bm->pixels & 3) == 0;
+}
+
+// sets m to the bits of rows y0 to y1 inclusive.  Empty if y1 < y0.
+static void rows_mask(uint32_t m[4], int y0, int y1) {
+  for (int w = 0; w < 4; w++) {
+    int lo = y0 > w * 32 ? y0 - w * 32 : 0;
+    int hi = y1 < w * 32 + 31 ? y1 - w * 32 : 31;
+    if (lo > hi) {
+      m[w] = 0;
+    } else {
+      m[w] = (0xFFFFFFFF >> (31 - hi)) & (0xFFFFFFFF << lo);
+    }
+  }
+}
+
+// d = s moved n rows towards row 0, 0 <= n < 128
+static inline void column_shift_up(uint32_t d[4], const uint32_t s[4], int n) {
+  int ws = n >> 5;
+  int bs = n & 31;
+  for (int w = 0; w < 4; w++) {
+    uint32_t lo = w + ws < 4 ? s[w + ws] : 0;
+    uint32_t hi = w + ws + 1 < 4 ? s[w + ws + 1] : 0;
+    d[w] = bs ? (lo >> bs) | (hi << (32 - bs)) : lo;
+  }
+}
+
+// d = s moved n rows away from row 0, 0 <= n < 128
+static inline void column_shift_down(uint32_t d[4], const uint32_t s[4], int n) {
+  int ws = n >> 5;
+  int bs = n & 31;
+  for (int w = 0; w < 4; w++) {
+    uint32_t hi = w - ws >= 0 ? s[w - ws] : 0;
+    uint32_t lo = w - ws - 1 >= 0 ? s[w - ws - 1] : 0;
+    d[w] = bs ? (hi << bs) | (lo >> (32 - bs)) : hi;
+  }
+}
+
+static void blit_columns(const blit_t *b) {
+  uint32_t m[4];
+  rows_mask(m, b->y0, b->y1);
+  int n = b->x1 - b->x0 + 1;
+  for (int i = 0; i < n; i++) {
+    int x = b->backwards ? b->x1 - i : b->x0 + i;
+    uint32_t *d = (uint32_t *)(b->dst->pixels + x * 16);
+    uint32_t s[4] = {0, 0, 0, 0};
+    if (b->src != NULL) {
+      // a copy of the column, so a column can be moved onto itself
+      const uint32_t *col = (const uint32_t *)(b->src->pixels + (x + b->dx) * 16);
+      uint32_t c[4] = {col[0], col[1], col[2], col[3]};
+      if (b->dy > 0) column_shift_up(s, c, b->dy);
+      else if (b->dy < 0) column_shift_down(s, c, -b->dy);
+      else memcpy(s, c, sizeof(s));
+    }
+    for (int w = 0; w < 4; w++) {
+      if (m[w]) d[w] = rop_masked(d[w], s[w], m[w], b->op);
+    }
+  }
+}
+
+static void run_blit(blit_t *b) {
+  // columns move right when dx < 0, so the columns are done last to first
+  b->same = b->src != NULL && b->src->pixels == b->dst->pixels;
+  b->backwards = b->same && b->dx < 0;
+  if (column_major(b->dst) && (b->src == NULL || column_major(b->src))) {
+    blit_columns(b);
+  } else {
+    blit_pages(b);
+  }
+  if (b->dst->screen) srn_mark_dirty_rect(b->x0, b->y0, b->x1, b->y1);
+}
+
+// clips lo..hi to 0..size-1 and moves pos, the matching start in the other
+// bitmap, by the same amount.  Returns false if nothing is left.
+static inline bool clip_axis(int *lo, int *hi, int *pos, int size) {
+  if (*lo < 0) {
+    *pos -= *lo;
+    *lo = 0;
+  }
+  if (*hi > size - 1) *hi = size - 1;
+  return *lo <= *hi;
+}
+
+void bitblt(const srn_bitmap_t *src, const screen_region_t *src_rect,
+            srn_bitmap_t *dst, int dst_x, int dst_y, srn_rop_t rop) {
+  int sx0 = src_rect->xMin, sx1 = src_rect->xMax;
+  int sy0 = src_rect->yMin, sy1 = src_rect->yMax;
+  // clip to the source, then the destination
+  if (!clip_axis(&sx0, &sx1, &dst_x, src->width) ||
+      !clip_axis(&sy0, &sy1, &dst_y, src->height)) return;
+  int x0 = dst_x, x1 = dst_x + sx1 - sx0;
+  int y0 = dst_y, y1 = dst_y + sy1 - sy0;
+  if (!clip_axis(&x0, &x1, &sx0, dst->width) ||
+      !clip_axis(&y0, &y1, &sy0, dst->height)) return;
+  if (rop == SRN_ROP_INVERT || rop == SRN_ROP_CLEAR || rop == SRN_ROP_SET) src = NULL;
+  blit_t b = {src, dst, x0, y0, x1, y1, sx0 - x0, sy0 - y0, rop};
+  run_blit(&b);
+}
+
+void bitblt_rect(srn_bitmap_t *dst, const screen_region_t *rect, srn_rop_t rop) {
+  int x0 = rect->xMin, x1 = rect->xMax;
+  int y0 = rect->yMin, y1 = rect->yMax;
+  int unused = 0;
+  if (!clip_axis(&x0, &x1, &unused, dst->width) ||
+      !clip_axis(&y0, &y1, &unused, dst->height)) return;
+  blit_t b = {NULL, dst, x0, y0, x1, y1, 0, 0, rop};
+  run_blit(&b);
+}
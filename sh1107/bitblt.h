@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* bitblt.h
+ * Bit block transfer between 1 bit per pixel bitmaps.  A rectangle of one
+ * bitmap is combined into another at any pixel position with a raster op.
+ * The source and destination may be the same bitmap and may overlap, so
+ * scrolls are a bitblt of a region onto itself.  Rows that are not on a
+ * page boundary are shifted as they are copied.
+ *
+ * Work is done 32 bits at a time where the layout allows it: four columns
+ * of a page at once in the page-major layout when the source and
+ * destination columns line up on words, and a whole 128 pixel column at
+ * once in the column-major layout (see sh1107_spi.h).  Everything else
+ * goes a byte at a time.
+ *
+ * scroll_screen_region(), clear_screen_region(), fill_rect(),
+ * invert_screen_region() and scroll_text() are all built on it.
+ */
+
+#ifndef BITBLT_H
+#define BITBLT_H
+
+#include "pixel_ops.h"
+
+// BITMAPS
+// A bitmap holds pixels as page bytes like srn_display_pixels: each byte is
+// 8 vertical pixels, bit 0 at the top.  The byte of page p and column x is
+// pixels[p * page_stride + x * col_stride].  srn_bitmap_init() sets up the
+// page-major layout used by the fonts, width bytes per page.
+typedef struct srn_bitmap {
+  uint8_t *pixels;
+  int width, height;   // in pixels
+  int page_stride;     // bytes from a page to the next
+  int col_stride;      // bytes from a column to the next
+  bool screen;         // changes are marked dirty for the refresh
+} srn_bitmap_t;
+
+// bytes needed for a width by height bitmap
+#define SRN_BITMAP_BYTES(_W, _H) ((_W) * (((_H) + 7) >> 3))
+
+// Sets up a page-major bitmap over pixels.  Word-aligned pixels and a
+// width that is a multiple of 4 let bitblt() work 32 bits at a time.
+void srn_bitmap_init(srn_bitmap_t *this, uint8_t *pixels, int width, int height);
+
+// Sets up a bitmap over srn_display_pixels (the layer drawn into, see
+// sh1107_spi.h).  Changes made through it are marked dirty.
+void srn_screen_bitmap(srn_bitmap_t *this);
+
+// RASTER OPS
+// d is the destination pixel and s the source pixel.
+typedef enum srn_rop {
+  SRN_ROP_COPY,       // d = s
+  SRN_ROP_OR,         // d = d | s
+  SRN_ROP_AND,        // d = d & s
+  SRN_ROP_AND_NOT,    // d = d & ~s
+  SRN_ROP_XOR,        // d = d ^ s
+  SRN_ROP_NOT_COPY,   // d = ~s
+  SRN_ROP_INVERT,     // d = ~d, no source
+  SRN_ROP_CLEAR,      // d = 0, no source
+  SRN_ROP_SET,        // d = 1, no source
+} srn_rop_t;
+
+// Combines the rectangle src_rect of src, bounds inclusive, into dst with
+// its top left corner at dst_x, dst_y.  The parts outside either bitmap
+// are skipped.
+void bitblt(const srn_bitmap_t *src, const screen_region_t *src_rect,
+            srn_bitmap_t *dst, int dst_x, int dst_y, srn_rop_t rop);
+
+// Applies a raster op that needs no source, such as SRN_ROP_INVERT, to the
+// rectangle rect of dst, bounds inclusive.
+void bitblt_rect(srn_bitmap_t *dst, const screen_region_t *rect, srn_rop_t rop);
+
+#endif
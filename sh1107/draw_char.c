@@ -2,13 +2,106 @@
 
 #include <stdio.h>
 #include <string.h>
-#include "pico/stdlib.h"
-#include "pico/binary_info.h"
-#include "font8x8_basic.h"
+#include "sh1107_port.h"
 #include "draw_char.h"
+#include "font8x8_basic.h"
+#include "font8x8_metrics.h"
+#include "srn_sched.h"
+#include "srn_perf.h"
+
+// SHADOW GRID
+
+static inline int shadow_cols(char_screen_region_t *this) {
+  return this->ccol_rgt - this->ccol_lft + 1;
+}
+
+static inline int shadow_rows(char_screen_region_t *this) {
+  return this->crow_bot - this->crow_top + 1;
+}
+
+static inline uint16_t *shadow_at(char_screen_region_t *this, int row, int col) {
+  return &this->shadow[(row - this->crow_top) * shadow_cols(this) + col - this->ccol_lft];
+}
+
+static void fill_shadow(char_screen_region_t *this, uint16_t val) {
+  int n = shadow_rows(this) * shadow_cols(this);
+  for (int i = 0; i < n; i++) this->shadow[i] = val;
+}
+
+bool set_char_shadow(char_screen_region_t *this, uint16_t *grid, int entries) {
+  if (grid != NULL && entries < shadow_rows(this) * shadow_cols(this)) return false;
+  this->shadow = grid;
+  if (grid != NULL) fill_shadow(this, SRN_SHADOW_UNKNOWN);
+  return true;
+}
+
+void invalidate_char_shadow(char_screen_region_t *this) {
+  if (this->shadow != NULL) fill_shadow(this, SRN_SHADOW_UNKNOWN);
+}
+
+// draws the 8x8 part of a cell described by a shadow entry at row, col
+static void draw_shadow_entry(char_screen_region_t *this, int row, int col, uint16_t entry) {
+  const srn_font_t *font = this->font;
+  uint8_t chr = entry & 0xFF;
+  int part_row = (entry >> 12) & 0xF;
+  int part_col = (entry >> 8) & 0xF;
+  const uint8_t *glyph = NULL;
+  if (entry != 0 && chr >= font->first && chr <= font->last) {
+    glyph = font->glyphs + (chr - font->first) * font->cell_width * this->cell_rows +
+            part_row * font->cell_width;
+  }
+  int x = col << 3;
+  for (int i = 0; i < 8; i++) {
+    int gc = (part_col << 3) + i;
+    SRN_PAGE_BYTE(row, x + i) = glyph != NULL && gc < font->cell_width ? glyph[gc] : 0;
+  }
+  srn_mark_dirty(row, x, x + 7);
+}
+
+// writes chr at the current position, drawing only the parts that change
+static void write_cell_shadow(char_screen_region_t *this, uint8_t chr) {
+  for (int r = 0; r < this->cell_rows; r++) {
+    for (int c = 0; c < this->cell_cols; c++) {
+      uint16_t entry = chr | (r << 12) | (c << 8);
+      uint16_t *s = shadow_at(this, this->crow + r, this->ccol + c);
+      if (*s == entry) continue;
+      *s = entry;
+      draw_shadow_entry(this, this->crow + r, this->ccol + c, entry);
+    }
+  }
+}
+
+// moves the grid n rows up (n > 0) or down.  With redraw the positions
+// whose entry changes are drawn, otherwise the pixels were moved already.
+static void scroll_shadow(char_screen_region_t *this, int n, bool redraw) {
+  int rows = shadow_rows(this);
+  int cols = shadow_cols(this);
+  for (int i = 0; i < rows; i++) {
+    int r = n > 0 ? i : rows - 1 - i;  // never read a row already moved
+    int from = r + n;
+    for (int c = 0; c < cols; c++) {
+      uint16_t entry = from >= 0 && from < rows ? this->shadow[from * cols + c] : 0;
+      uint16_t *s = &this->shadow[r * cols + c];
+      if (redraw && entry == SRN_SHADOW_UNKNOWN) {
+        // nothing known about it, so its pixels are moved as they are
+        int x = (c + this->ccol_lft) << 3;
+        for (int i = 0; i < 8; i++) {
+          SRN_PAGE_BYTE(r + this->crow_top, x + i) = SRN_PAGE_BYTE(from + this->crow_top, x + i);
+        }
+        srn_mark_dirty(r + this->crow_top, x, x + 7);
+      } else if (*s == entry) {
+        continue;
+      } else if (redraw) {
+        draw_shadow_entry(this, r + this->crow_top, c + this->ccol_lft, entry);
+      }
+      *s = entry;
+    }
+  }
+}
 
 void clear_text(char_screen_region_t *this) {
   clear_screen_region (&this->sr);
+  if (this->shadow != NULL) fill_shadow(this, 0);
   this->crow = this->crow_top;
   this->ccol = this->ccol_lft;
 }
@@ -28,6 +121,25 @@ bool init_char_screen_region(char_screen_region_t *this, int lft_col, int top_ro
   // set the character position at the top left corner
   this->crow = top_row;
   this->ccol = lft_col;
+  this->font = &srn_font8x8;
+  this->cell_cols = 1;
+  this->cell_rows = 1;
+  this->shadow = NULL;
+  return true;
+}
+
+bool set_char_font(char_screen_region_t *this, const srn_font_t *font) {
+  int cols = (font->cell_width + 7) >> 3;
+  int rows = (font->height + 7) >> 3;
+  if (cols > this->ccol_rgt - this->ccol_lft + 1 ||
+      rows > this->crow_bot - this->crow_top + 1) return false;
+  this->font = font;
+  this->cell_cols = cols;
+  this->cell_rows = rows;
+  invalidate_char_shadow(this);
+  this->crow = this->crow_top;
+  this->ccol = this->ccol_lft;
+  return true;
 }
 
 bool start_char_at(char_screen_region_t *this, int row, int col) {
@@ -39,57 +151,78 @@ bool start_char_at(char_screen_region_t *this, int row, int col) {
 }
 
 void scroll_text(char_screen_region_t *this, int n) {
+  SRN_PERF_TIME(SRN_PERF_SCROLL_TEXT);
   if (n > this->crow_bot || n < -this->crow_bot) { // if scroll >  region
     clear_text(this); // just clear the region and return
     return;
   }
-  int r;
-  if (n > 0) { // scroll up
-    for (r = this->crow_top + n; r <= this->crow_bot; r++) {
-      for (int c = this->sr.xMin;  c <= this->sr.xMax; c++) {
-      	srn_display_pixels[r-n][c] = srn_display_pixels[r][c];
-      }
-    }
-    for (r = r - n; r <= this->crow_bot; r++){
-      for (int c = this->sr.xMin;  c <= this->sr.xMax; c++) {
-	      srn_display_pixels[r][c] = 0;
-      }
-    }
-    srn_refresh();
-  } else if (n < 0) { //scroll down
-    for (r = this->crow_bot + n; r >= 0; r--) {
-      for (int c = this->sr.xMin;  c <= this->sr.xMax; c++) {
-	      srn_display_pixels[r-n][c] = srn_display_pixels[r][c];
-      }
-    }
-    for (r = this->crow_top; r > this->crow_top - n; r--) {
-      for (int c = this->sr.xMin;  c <= this->sr.xMax; c++) {
-	      srn_display_pixels[r][c] = 0;
-      }
+  // a whole screen region is scrolled by moving the display start line
+  if (this->ccol_lft == 0 && this->ccol_rgt == 15 &&
+      this->crow_top == 0 && this->crow_bot == 15 &&
+      srn_hw_scroll_pages(n)) {
+    if (this->shadow != NULL) scroll_shadow(this, n, false);
+    srn_sched_request(&this->sr);
+    return;
+  }
+  if (n == 0) return;
+  // with a shadow grid only the positions that change are drawn
+  if (this->shadow != NULL) {
+    scroll_shadow(this, n, true);
+    srn_sched_request(&this->sr);
+    return;
+  }
+  // whole character rows move, so every byte of the blit is page aligned
+  scroll_screen_region(&this->sr, 0, n * 8);
+  srn_sched_request(&this->sr);
+}
+
+// copies the page bytes of a glyph into the cell at the current position
+static void draw_cell(char_screen_region_t *this, uint8_t chr) {
+  const srn_font_t *font = this->font;
+  int x = this->ccol << 3;
+  int width = this->cell_cols << 3;
+  const uint8_t *glyph = NULL;
+  if (chr >= font->first && chr <= font->last) {
+    glyph = font->glyphs + (chr - font->first) * font->cell_width * this->cell_rows;
+  }
+  for (int p = 0; p < this->cell_rows; p++) {
+    for (int i = 0; i < width; i++) {
+      uint8_t b = 0;
+      if (glyph != NULL && i < font->cell_width) b = glyph[p * font->cell_width + i];
+      SRN_PAGE_BYTE(this->crow + p, x + i) = b;
     }
-    srn_refresh();
+    srn_mark_dirty(this->crow + p, x, x + width - 1);
   }
 }
 
 bool write_char_next(char_screen_region_t *this, uint8_t chr) {
-  if (this->crow > this->crow_bot) {
-    scroll_text(this, 1);
-    this->crow = this->crow_bot;
+  SRN_PERF_TIME(SRN_PERF_CHAR);
+  int last_row = this->crow_bot - this->cell_rows + 1;  // last row a cell fits
+  if (this->crow > last_row) {
+    scroll_text(this, this->cell_rows);
+    this->crow = last_row;
     this->ccol = this->ccol_lft;
   }
-  if (this->ccol > this->ccol_rgt || chr == '\n') {
-    this->crow += 1;
+  if (this->ccol + this->cell_cols - 1 > this->ccol_rgt || chr == '\n') {
+    this->crow += this->cell_rows;
     this->ccol = this->ccol_lft;
-    if (this->crow > this->crow_bot) {
-      scroll_text(this, 1);
-      this->crow = this->crow_bot;
+    if (this->crow > last_row) {
+      scroll_text(this, this->cell_rows);
+      this->crow = last_row;
       this->ccol = this->ccol_lft;
     }
   } else if (chr >= 0x20)  { // skip non-printable characters
-    for (int i = 0;  i < 8; i++) {
-      srn_display_pixels[this->crow][(this->ccol<<3)+i] = font8x8_basic[chr][i];
+    if (this->shadow != NULL) {
+      write_cell_shadow(this, chr);
+    } else if (this->font == &srn_font8x8) {
+      for (int i = 0;  i < 8; i++) {
+        SRN_PAGE_BYTE(this->crow, (this->ccol<<3)+i) = font8x8_basic[chr][i];
+      }
+      srn_mark_dirty(this->crow, this->ccol<<3, (this->ccol<<3)+7);
+    } else {
+      draw_cell(this, chr);
     }
-    this->ccol += 1;
+    this->ccol += this->cell_cols;
   }
   return true;
 }
@@ -104,6 +237,182 @@ void srn_print(char_screen_region_t *this, char pstr[]){
     if (pstr[i] == 0) break;
     write_char_next(this, pstr[i]);
   }
-  srn_refresh();
+  srn_sched_request(&this->sr);
+}
+
+// NUMBERS
+
+static const uint32_t pow10[10] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static inline void write_repeat(char_screen_region_t *this, uint8_t chr, int n) {
+  for (; n > 0; n--) write_char_next(this, chr);
+}
+
+static inline int count_digits(uint32_t val) {
+  int digits = 1;
+  while (digits < 10 && val >= pow10[digits]) digits++;
+  return digits;
+}
+
+// writes the digits of val with at least min_digits digits
+static void write_digits(char_screen_region_t *this, uint32_t val, int min_digits) {
+  int digits = count_digits(val);
+  if (digits < min_digits) digits = min_digits;
+  for (int d = digits - 1; d >= 0; d--) {
+    uint8_t digit = '0';
+    // each digit takes at most 9 subtractions
+    while (val >= pow10[d]) {
+      val -= pow10[d];
+      digit++;
+    }
+    write_char_next(this, digit);
+  }
+}
+
+// writes [sign]whole[.frac] padded to width, frac has decimals digits
+static void print_number(char_screen_region_t *this, bool neg, uint32_t whole,
+                         uint32_t frac, int decimals, int width, int flags) {
+  char sign = neg ? '-' : (flags & SRN_FMT_PLUS) ? '+' : (flags & SRN_FMT_SPACE) ? ' ' : 0;
+  int len = (sign != 0) + count_digits(whole) + (decimals > 0 ? decimals + 1 : 0);
+  int pad = width > len ? width - len : 0;
+  if (!(flags & (SRN_FMT_LEFT | SRN_FMT_ZERO))) write_repeat(this, ' ', pad);
+  if (sign) write_char_next(this, sign);
+  if (flags & SRN_FMT_ZERO && !(flags & SRN_FMT_LEFT)) write_repeat(this, '0', pad);
+  write_digits(this, whole, 1);
+  if (decimals > 0) {
+    write_char_next(this, '.');
+    write_digits(this, frac, decimals);
+  }
+  if (flags & SRN_FMT_LEFT) write_repeat(this, ' ', pad);
+  srn_sched_request(&this->sr);
+}
+
+static inline int clamp_decimals(int decimals) {
+  return decimals < 0 ? 0 : decimals > 9 ? 9 : decimals;
+}
+
+void srn_print_int(char_screen_region_t *this, int32_t val, int width, int flags) {
+  // negate as unsigned so INT32_MIN works
+  uint32_t mag = val < 0 ? 0u - (uint32_t)val : (uint32_t)val;
+  print_number(this, val < 0, mag, 0, 0, width, flags);
+}
+
+void srn_print_fixed(char_screen_region_t *this, srn_fix_t val, int decimals,
+                     int width, int flags) {
+  decimals = clamp_decimals(decimals);
+  uint32_t mag = val < 0 ? 0u - (uint32_t)val : (uint32_t)val;
+  uint32_t whole = mag >> SRN_FIX_FRAC_BITS;
+  uint32_t rem = mag & (SRN_FIX_ONE - 1);
+  // the fraction scaled to decimals digits, rounded half up
+  uint64_t scaled = (uint64_t)rem * pow10[decimals];
+  uint32_t frac = (uint32_t)((scaled + (SRN_FIX_ONE >> 1)) >> SRN_FIX_FRAC_BITS);
+  if (frac >= pow10[decimals]) {
+    frac -= pow10[decimals];
+    whole++;
+  }
+  print_number(this, val < 0 && (whole | frac) != 0, whole, frac, decimals, width, flags);
+}
+
+void srn_print_float(char_screen_region_t *this, float val, int decimals,
+                     int width, int flags) {
+  decimals = clamp_decimals(decimals);
+  bool neg = val < 0.0f;
+  float mag = neg ? -val : val;
+  if (!(mag < 4294967296.0f)) {  // too large, infinite or NaN
+    write_repeat(this, '#', width > 1 ? width : 1);
+    srn_sched_request(&this->sr);
+    return;
+  }
+  uint32_t whole = (uint32_t)mag;
+  // the fraction as 0.32 fixed point, exact unless mag is below 1, then
+  // scaled to decimals digits and rounded with integers only
+  uint32_t rem = (uint32_t)((mag - (float)whole) * 4294967296.0f);
+  uint32_t frac = (uint32_t)(((uint64_t)rem * pow10[decimals] + 0x80000000u) >> 32);
+  if (frac >= pow10[decimals]) {
+    frac -= pow10[decimals];
+    whole++;  // mag is at most 2^32 - 256, so this can not wrap
+  }
+  print_number(this, neg && (whole | frac) != 0, whole, frac, decimals, width, flags);
 }
 		    
+
+// PIXEL POSITIONED TEXT
+
+const srn_font_t srn_font8x8 = {
+  .first = 0, .last = 127, .height = 8, .cell_width = 8, .spacing = 0,
+  .glyphs = (const uint8_t *)font8x8_basic, .metrics = NULL,
+};
+
+const srn_font_t srn_font8x8_prop = {
+  .first = 0, .last = 127, .height = 8, .cell_width = 8, .spacing = 1,
+  .glyphs = (const uint8_t *)font8x8_basic, .metrics = font8x8_basic_metrics,
+};
+
+int text_width(const srn_font_t *font, const char *str) {
+  int w = 0;
+  int left;
+  for (; *str; str++) w += srn_glyph_advance(font, *str, &left);
+  return w;
+}
+
+// replaces the bits of mask in a page byte
+static inline void write_bits(int page, int x, uint8_t bits, uint8_t mask) {
+  if (mask == 0) return;
+  uint8_t *p = &SRN_PAGE_BYTE(page, x);
+  *p = (*p & ~mask) | (bits & mask);
+}
+
+int draw_text(const srn_font_t *font, const screen_region_t *clip,
+              int x, int y, const char *str) {
+  screen_region_t bounds;
+  srn_clip_bounds(clip, &bounds);
+  int pages = (font->height + 7) >> 3;
+  int top = y > bounds.yMin ? y : bounds.yMin;
+  int bot = y + font->height - 1 < bounds.yMax ? y + font->height - 1 : bounds.yMax;
+
+  // rows of each display page that are inside both the clip and the
+  // text cell
+  uint8_t row_mask[16];
+  memset(row_mask, 0, sizeof(row_mask));
+  for (int page = top >> 3; top <= bot && page <= bot >> 3; page++) {
+    int lo = page * 8 > top ? 0 : top - page * 8;
+    int hi = page * 8 + 7 < bot ? 7 : bot - page * 8;
+    row_mask[page] = (0xFF << lo) & (0xFF >> (7 - hi));
+  }
+  // rows of the last glyph page that are part of the glyph
+  uint8_t last_rows = 0xFF >> (pages * 8 - font->height);
+  int shift = y & 7;
+  int first_page = y >> 3;  // y may be negative, >> rounds down
+
+  int x0 = x;
+  for (; *str; str++) {
+    uint8_t chr = *str;
+    int left;
+    int advance = srn_glyph_advance(font, chr, &left);
+    if (advance == 0) continue;
+    const uint8_t *glyph = font->glyphs +
+        (chr - font->first) * font->cell_width * pages;
+    for (int c = 0; c < advance; c++, x++) {
+      if (x < bounds.xMin || x > bounds.xMax) continue;
+      int col = left + c;
+      for (int p = 0; p < pages; p++) {
+        uint8_t bits = col < font->cell_width ? glyph[p * font->cell_width + col] : 0;
+        uint8_t rows = p == pages - 1 ? last_rows : 0xFF;
+        int page = first_page + p;
+        if (page >= 0 && page <= 15) {
+          write_bits(page, x, bits << shift, (rows << shift) & row_mask[page]);
+        }
+        if (shift != 0 && page + 1 >= 0 && page + 1 <= 15) {
+          write_bits(page + 1, x, bits >> (8 - shift),
+                     (rows >> (8 - shift)) & row_mask[page + 1]);
+        }
+      }
+    }
+  }
+  int minX = x0 > bounds.xMin ? x0 : bounds.xMin;
+  int maxX = x - 1 < bounds.xMax ? x - 1 : bounds.xMax;
+  if (minX <= maxX && top <= bot) srn_mark_dirty_rect(minX, top, maxX, bot);
+  return x;
+}
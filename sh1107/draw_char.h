@@ -16,6 +16,26 @@
 #define DRAW_CHAR_H
 
 #include "pixel_ops.h"
+#include "draw_graphics.h"
+
+// FONTS
+// The glyphs of a srn_font_t are stored page by page in the byte layout of
+// srn_display_pixels, so a glyph column is always written as whole bytes.
+// More fonts are in srn_fonts.h.
+
+typedef struct srn_glyph_metrics {
+  uint8_t left;    // first column of the glyph that is drawn
+  uint8_t width;   // number of columns drawn from there
+} srn_glyph_metrics_t;
+
+typedef struct srn_font {
+  uint8_t first, last;      // characters in the font
+  uint8_t height;           // rows in a glyph
+  uint8_t cell_width;       // columns of each glyph in glyphs
+  uint8_t spacing;          // blank columns after a proportional glyph
+  const uint8_t *glyphs;    // cell_width bytes per page, pages per glyph
+  const srn_glyph_metrics_t *metrics;  // NULL for a fixed width font
+} srn_font_t;
 
 // This structure holds the bounds in 8x8 characters.  When Characters are written to 
 // screen the horizontal wrap and verticle scroll are kept within the bound of the
@@ -31,6 +51,12 @@ typedef struct char_screen_region {
   int crow_bot;
   int crow;
   int ccol;
+  // font of the region and the size of its cells in 8x8 characters
+  const srn_font_t *font;
+  int cell_cols;
+  int cell_rows;
+  // optional grid of what each 8x8 position shows, see set_char_shadow()
+  uint16_t *shadow;
   screen_region_t sr;
 } char_screen_region_t;
   
@@ -40,6 +66,32 @@ typedef struct char_screen_region {
 bool init_char_screen_region(char_screen_region_t *this, int lft_col, int top_row,
 			     int rgt_col, int bot_row);
 
+// Selects the font of the region.  Each character takes a cell of whole
+// 8x8 characters large enough for the font, for example 2 by 2 for a 16x16
+// font, and is drawn by copying its page bytes.  Returns false if a cell
+// does not fit in the region.  The position goes back to the top left.
+// init_char_screen_region() selects srn_font8x8.
+bool set_char_font(char_screen_region_t *this, const srn_font_t *font);
+
+// SHADOW GRID
+// A region can keep a shadow grid with one entry per 8x8 position: the
+// character in the low byte and which part of its cell it is in the high
+// byte (row << 4 | col).  0 is a cleared position.  With the grid, writing
+// the character that is already shown is a no-op that changes no pixels,
+// and scroll_text() moves the grid and redraws only the positions whose
+// contents differ, so the redraw and the refresh track the characters
+// that changed instead of the size of the region.
+#define SRN_SHADOW_UNKNOWN 0xFFFF
+
+// Gives the region a shadow grid.  grid must have room for one entry per
+// 8x8 position of the region, (right - left + 1) * (bottom - top + 1).
+// Returns false if entries is too small.  Pass NULL to stop using it.
+bool set_char_shadow(char_screen_region_t *this, uint16_t *grid, int entries);
+
+// Forgets what the shadow grid knows, so every position is redrawn on its
+// next write.  Call it after drawing into the region by other means.
+void invalidate_char_shadow(char_screen_region_t *this);
+
 // This fuction clears the region of the screen defined in the char_screen_region and
 // sets the current character position to the top, left corner. 
 void clear_text(char_screen_region_t *this);
@@ -66,4 +118,57 @@ bool write_char_at(char_screen_region_t *this, uint8_t chr, int row, int col);
 // convience function that calls write_char_next() for each char in the string.
 void srn_print(char_screen_region_t *this, char pstr[]);
 
+// NUMBERS
+// Numbers are written straight into the region with integer arithmetic, so
+// there is no sprintf() and no float printf code pulled in.  The number is
+// padded to width characters, with spaces on the left unless a flag says
+// otherwise.  A number that does not fit is written in full.
+#define SRN_FMT_PLUS  0x01  // write a '+' in front of positive numbers
+#define SRN_FMT_SPACE 0x02  // write a ' ' in front of positive numbers
+#define SRN_FMT_ZERO  0x04  // pad with '0' after the sign
+#define SRN_FMT_LEFT  0x08  // pad with spaces on the right
+
+// for example srn_print_int(&csr, -42, 5, 0) writes "  -42"
+void srn_print_int(char_screen_region_t *this, int32_t val, int width, int flags);
+
+// Writes a fixed point value (see draw_graphics.h) rounded to decimals
+// places, 0 to 9.  No floats are used at all.
+void srn_print_fixed(char_screen_region_t *this, srn_fix_t val, int decimals,
+                     int width, int flags);
+
+// Writes a float rounded to decimals places, 0 to 9, like printf("%.*f")
+// except that a value that rounds to zero has no '-'.  Numbers of 2^32 or
+// more, infinities and NaNs are written as '#'s filling the width.
+void srn_print_float(char_screen_region_t *this, float val, int decimals,
+                     int width, int flags);
+
+// PIXEL POSITIONED TEXT
+// Text can also be drawn at any pixel position.  The glyph columns are
+// split across two pages when y is not a multiple of 8.  The text cell is
+// opaque: rows of the cell not set in a glyph are cleared.
+
+extern const srn_font_t srn_font8x8;       // font8x8_basic in 8 pixel cells
+extern const srn_font_t srn_font8x8_prop;  // font8x8_basic, proportional
+
+// Draws str with its top left corner at x, y.  Only the part inside clip
+// is drawn, or inside the display if clip is NULL.  Returns the x position
+// after the last character.
+int draw_text(const srn_font_t *font, const screen_region_t *clip,
+              int x, int y, const char *str);
+
+// Returns the width of str in pixels.
+int text_width(const srn_font_t *font, const char *str);
+
+// Returns the columns drawn for chr, spacing included, and sets *left to
+// the first glyph column drawn.  0 if the font has no glyph for chr.
+static inline int srn_glyph_advance(const srn_font_t *font, uint8_t chr, int *left) {
+  *left = 0;
+  if (chr < font->first || chr > font->last) return 0;
+  if (font->metrics == NULL) return font->cell_width;
+  const srn_glyph_metrics_t *m = &font->metrics[chr - font->first];
+  if (m->width == 0) return 0;
+  *left = m->left;
+  return m->width + font->spacing;
+}
+
 #endif
@@ -7,23 +7,88 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
-#include "pico/stdlib.h"
-#include "pico/binary_info.h"
+#include "sh1107_port.h"
 #include "pixel_ops.h"
 #include "draw_char.h"
 #include "draw_graphics.h"
+#include "srn_perf.h"
  
 bool clear_window(graph_screen_region_t *this) {
-  this->next_x = this->win_lft;
+  this->next_x = this->sr.xMin;
   return clear_screen_region(&this->sr);
 }  
 
+// FIXED POINT MAPPING
+// The window is mapped to the screen with scale and offset pairs kept both
+// as floats for the float functions and in fixed point for the _q ones.
+// Fixed point screen coordinates are worked out in 64 bits, so values far
+// off the screen do not overflow.
+
+static inline int64_t floor_div(int64_t a, int64_t b) {
+  int64_t q = a / b;
+  if ((a % b != 0) && ((a < 0) != (b < 0))) q--;
+  return q;
+}
+
+static inline int64_t ceil_div(int64_t a, int64_t b) {
+  return -floor_div(-a, b);
+}
+
+// converts a screen coordinate to fixed point, saturating far off values.
+static inline int64_t to_fixed(float v) {
+  if (v > 1e6f) v = 1e6f;
+  else if (!(v > -1e6f)) v = -1e6f;  // also catches NaN
+  return (int64_t)floorf(v * SRN_FIX_ONE);
+}
+
+// window value to fixed point screen coordinate.  The scale is applied to
+// the distance from the window origin, which maps to pixel pix.
+static inline int64_t fix_to_screen(srn_fix_t v, srn_fix_t org, srn_fix_t scl, int pix) {
+  return ((((int64_t)v - org) * scl) >> SRN_FIX_FRAC_BITS) +
+         ((int64_t)pix << SRN_FIX_FRAC_BITS);
+}
+
+#define SCREEN_X(this, v) fix_to_screen(v, (this)->xorg_q, (this)->xscl_q, (this)->sr.xMin)
+#define SCREEN_Y(this, v) fix_to_screen(v, (this)->yorg_q, (this)->yscl_q, (this)->sr.yMin)
+
+// works out the fixed point scale that maps lo..hi onto pixels pixels.
+// Returns false if it does not fit.
+static bool fixed_scale(int pixels, srn_fix_t lo, srn_fix_t hi, srn_fix_t *scl) {
+  int64_t range = (int64_t)hi - lo;
+  if (range == 0) return false;
+  int64_t num = (int64_t)pixels << (2 * SRN_FIX_FRAC_BITS);
+  int64_t s = floor_div(2 * num + range, 2 * range);  // rounded
+  if (s > INT32_MAX || s < INT32_MIN) return false;
+  *scl = (srn_fix_t)s;
+  return true;
+}
+
+// fills in the fixed point mapping from the float one
+static void fixed_from_float(graph_screen_region_t *this) {
+  this->xscl_q = srn_float_to_fix(this->xscl);
+  this->xorg_q = srn_float_to_fix(this->win_lft);
+  this->yscl_q = srn_float_to_fix(this->yscl);
+  this->yorg_q = srn_float_to_fix(this->win_top);
+}
+
+// fills in the float mapping from the fixed point one
+static void float_from_fixed(graph_screen_region_t *this) {
+  this->xscl = (float)this->xscl_q / SRN_FIX_ONE;
+  this->yscl = (float)this->yscl_q / SRN_FIX_ONE;
+  this->xoff = this->sr.xMin - this->win_lft * this->xscl;
+  this->yoff = this->sr.yMin - this->win_top * this->yscl;
+}
+
+static inline bool pix_range_ok(int pix_l, int pix_t, int pix_r, int pix_b) {
+  return !(pix_l < 0 || pix_l > 127 || pix_r < 0 || pix_r > 127 ||
+           pix_t < 0 || pix_t > 127 || pix_b < 0 || pix_b > 127);
+}
+
 bool map_window(graph_screen_region_t *this,
 		float win_l, float win_t, float win_r, float win_b,
 		int   pix_l, int   pix_t, int   pix_r, int   pix_b) {
   //make sure the drawing region isinside the display 
-  if (pix_l < 0 || pix_l > 127 || pix_r < 0 || pix_r > 127 |
-      pix_t < 0 || pix_t > 127 || pix_b < 0 || pix_b > 127 ) return false;
+  if (!pix_range_ok(pix_l, pix_t, pix_r, pix_b)) return false;
   this->win_lft = win_l;
   this->win_rgt = win_r;
   this->win_top = win_t;
@@ -33,43 +98,178 @@ bool map_window(graph_screen_region_t *this,
   this->yscl = (float)(this->sr.yMax - this->sr.yMin + 1) / (this->win_bot - this->win_top);
   this->xoff = this->sr.xMin - this->win_lft * this->xscl;
   this->yoff = this->sr.yMin - this->win_top * this->yscl;
+  fixed_from_float(this);
   return clear_window(this);
 }
 
+bool map_window_q(graph_screen_region_t *this,
+		srn_fix_t win_l, srn_fix_t win_t, srn_fix_t win_r, srn_fix_t win_b,
+		int   pix_l, int   pix_t, int   pix_r, int   pix_b) {
+  if (!pix_range_ok(pix_l, pix_t, pix_r, pix_b)) return false;
+  screen_region_t sr;
+  set_screen_region(&sr, pix_l, pix_t, pix_r, pix_b);
+  srn_fix_t xscl, yscl;
+  if (!fixed_scale(sr.xMax - sr.xMin + 1, win_l, win_r, &xscl) ||
+      !fixed_scale(sr.yMax - sr.yMin + 1, win_t, win_b, &yscl)) {
+    return false;
+  }
+  this->sr = sr;
+  this->xscl_q = xscl;
+  this->xorg_q = win_l;
+  this->yscl_q = yscl;
+  this->yorg_q = win_t;
+  this->win_lft = (float)win_l / SRN_FIX_ONE;
+  this->win_rgt = (float)win_r / SRN_FIX_ONE;
+  this->win_top = (float)win_t / SRN_FIX_ONE;
+  this->win_bot = (float)win_b / SRN_FIX_ONE;
+  float_from_fixed(this);
+  return clear_window(this);
+}
+
+// LINE RASTERIZER
+// Lines are drawn with an integer DDA in fixed point screen coordinates.
+// Each axis moves by d / step of a pixel per step, where step is the
+// larger of |dx| and |dy|, so the major axis moves one pixel a step.  The
+// position is kept as a whole fixed point value and a remainder over step,
+// Bresenham style, so it never drifts from the true line however far away
+// the line starts.  The range of steps that lands inside the screen region
+// is solved for up front from the end points, Liang-Barsky style, so only
+// visible pixels are walked and they are written straight into
+// srn_display_pixels without per pixel bounds checks.
+
+// lines with an end further off the screen than this are not drawn, which
+// keeps the products below in 64 bits
+#define LINE_LIMIT ((int64_t)1000000 << SRN_FIX_FRAC_BITS)
+
+// floor(k * d * SRN_FIX_ONE / step), with the remainder over step in *rem
+static int64_t axis_offset(int64_t k, int64_t d, int64_t step, int64_t *rem) {
+  int64_t u = floor_div(k * d, step);
+  int64_t v = (k * d - u * step) * SRN_FIX_ONE;  // 0 <= v < step * SRN_FIX_ONE
+  int64_t w = floor_div(v, step);
+  *rem = v - w * step;
+  return u * SRN_FIX_ONE + w;
+}
+
+// ceil(c * step / (d * SRN_FIX_ONE)) for d > 0: the first step at which
+// the offset of an axis moving by d reaches c
+static int64_t first_step_at(int64_t c, int64_t d, int64_t step) {
+  int64_t c_hi = floor_div(c, SRN_FIX_ONE);
+  int64_t c_lo = c - c_hi * SRN_FIX_ONE;
+  int64_t q = floor_div(c_hi * step, d);
+  int64_t r = c_hi * step - q * d;
+  return q + ceil_div(r * SRN_FIX_ONE + c_lo * step, d * SRN_FIX_ONE);
+}
+
+// narrows the steps k0..k1 to those where the axis that starts at p and
+// moves by d, p + axis_offset(k), is in pixels lo to hi inclusive
+static void clip_steps(int64_t p, int64_t d, int64_t step, int lo, int hi,
+                       int64_t *k0, int64_t *k1) {
+  int64_t a = (int64_t)lo * SRN_FIX_ONE - p;  // the offsets allowed, a to b
+  int64_t b = (int64_t)hi * SRN_FIX_ONE + SRN_FIX_ONE - 1 - p;
+  if (d == 0) {
+    if (a > 0 || b < 0) *k1 = -1;
+    return;
+  }
+  int64_t first, last;
+  if (d > 0) {
+    first = first_step_at(a, d, step);
+    last = first_step_at(b + 1, d, step) - 1;
+  } else {
+    first = 1 - first_step_at(b + 1, -d, step);
+    last = -first_step_at(a, -d, step);
+  }
+  if (first > *k0) *k0 = first;
+  if (last < *k1) *k1 = last;
+}
+
+static inline bool far_off(int64_t v) {
+  return v > LINE_LIMIT || v < -LINE_LIMIT;
+}
+
+// draws from (x1, y1) towards (x2, y2), both in fixed point screen coordinates.
+// Like the float DDA the end point itself is not drawn.
+static void draw_fixed_line(screen_region_t *sr, int64_t x1, int64_t y1,
+                            int64_t x2, int64_t y2) {
+  if (far_off(x1) || far_off(y1) || far_off(x2) || far_off(y2)) return;
+  int64_t dx = x2 - x1;
+  int64_t dy = y2 - y1;
+  int64_t adx = dx < 0 ? -dx : dx;
+  int64_t ady = dy < 0 ? -dy : dy;
+  int64_t step = adx >= ady ? adx : ady;
+  int64_t n = step / SRN_FIX_ONE;  // number of pixels
+  if (n == 0) return;
+  int64_t k0 = 0;
+  int64_t k1 = n - 1;
+  clip_steps(x1, dx, step, sr->xMin, sr->xMax, &k0, &k1);
+  clip_steps(y1, dy, step, sr->yMin, sr->yMax, &k0, &k1);
+  if (k0 > k1) return;  // entirely outside the region
+  int64_t ex, ey, unused;
+  int32_t x = (int32_t)(x1 + axis_offset(k0, dx, step, &ex));
+  int32_t y = (int32_t)(y1 + axis_offset(k0, dy, step, &ey));
+  int32_t xe = (int32_t)(x1 + axis_offset(k1, dx, step, &unused));
+  int32_t ye = (int32_t)(y1 + axis_offset(k1, dy, step, &unused));
+  int xa = x >> SRN_FIX_FRAC_BITS, xb = xe >> SRN_FIX_FRAC_BITS;
+  int ya = y >> SRN_FIX_FRAC_BITS, yb = ye >> SRN_FIX_FRAC_BITS;
+  // axis lines are spans
+  if (dy == 0) {
+    fill_hspan(ya, xa < xb ? xa : xb, xa > xb ? xa : xb, 1);
+    return;
+  }
+  if (dx == 0) {
+    fill_vspan(xa, ya < yb ? ya : yb, ya > yb ? ya : yb, 1);
+    return;
+  }
+  srn_mark_dirty_rect(xa < xb ? xa : xb, ya < yb ? ya : yb,
+                      xa > xb ? xa : xb, ya > yb ? ya : yb);
+  // per step increments, whole and remainder over step
+  int64_t rx, ry;
+  int32_t sx = (int32_t)axis_offset(1, dx, step, &rx);
+  int32_t sy = (int32_t)axis_offset(1, dy, step, &ry);
+  for (int k = (int)(k1 - k0); k >= 0; k--) {
+    int px = x >> SRN_FIX_FRAC_BITS;
+    int py = y >> SRN_FIX_FRAC_BITS;
+    SRN_PAGE_BYTE(py >> 3, px) |= 1 << (py & 7);
+    x += sx;
+    y += sy;
+    ex += rx;
+    if (ex >= step) {
+      ex -= step;
+      x++;
+    }
+    ey += ry;
+    if (ey >= step) {
+      ey -= step;
+      y++;
+    }
+  }
+}
+
 void draw_line(graph_screen_region_t *this, float x1, float y1, float x2, float y2 ) {
+  SRN_PERF_TIME(SRN_PERF_LINE);
 
   // transform endpoints
   x1 = x1 * this->xscl + this->xoff;
   x2 = x2 * this->xscl + this->xoff;
   y1 = y1 * this->yscl + this->yoff;
   y2 = y2 * this->yscl + this->yoff;
- 
-  float x,y,dx,dy,step;
-  int i;
-  
-  dx = (x2 - x1);
-  dy = (y2 - y1);
-  float adx = fabs(dx);
-  float ady = fabs(dy);
-  
-  if(adx >= ady)
-    step = adx;
-  else
-    step = ady;
-  
-  dx /= step;
-  dy /= step;
-  
-  x = x1;
-  y = y1;
-  
-  i = 1;
-  while(i <= step) {
-    put_pixel(&this->sr, (int)x, (int)y, 1);
-    x = x + dx;
-    y = y + dy;
-    i = i + 1;
-  }
+
+  // nothing sensible to draw for lines far off the screen
+  if (!(fabsf(x1) < 1e6f && fabsf(x2) < 1e6f &&
+        fabsf(y1) < 1e6f && fabsf(y2) < 1e6f)) return;
+  draw_fixed_line(&this->sr, to_fixed(x1), to_fixed(y1), to_fixed(x2), to_fixed(y2));
+}
+
+void draw_line_q(graph_screen_region_t *this, srn_fix_t x1, srn_fix_t y1, srn_fix_t x2, srn_fix_t y2) {
+  draw_fixed_line(&this->sr, SCREEN_X(this, x1), SCREEN_Y(this, y1),
+                  SCREEN_X(this, x2), SCREEN_Y(this, y2));
+}
+
+// plots a pixel given in fixed point screen coordinates
+static void put_fixed_pixel(screen_region_t *sr, int64_t x, int64_t y) {
+  x >>= SRN_FIX_FRAC_BITS;
+  y >>= SRN_FIX_FRAC_BITS;
+  if (x < sr->xMin || x > sr->xMax || y < sr->yMin || y > sr->yMax) return;
+  put_pixel(sr, (int)x, (int)y, 1);
 }
 
 void draw_point(graph_screen_region_t *this, float x1, float y1) {
@@ -80,12 +280,15 @@ void draw_point(graph_screen_region_t *this, float x1, float y1) {
   put_pixel(&this->sr, (int)x1, (int)y1, 1);
 }
 
+void draw_point_q(graph_screen_region_t *this, srn_fix_t x1, srn_fix_t y1) {
+  put_fixed_pixel(&this->sr, SCREEN_X(this, x1), SCREEN_Y(this, y1));
+}
+
 bool map_autoscroll_bar_window(graph_screen_region_t *this,
     float win_t, float win_b,
 		int   pix_l, int   pix_t, int   pix_r, int   pix_b){
   //make sure the drawing region isinside the display 
-  if (pix_l < 0 || pix_l > 127 || pix_r < 0 || pix_r > 127 |
-      pix_t < 0 || pix_t > 127 || pix_b < 0 || pix_b > 127 ) return false;
+  if (!pix_range_ok(pix_l, pix_t, pix_r, pix_b)) return false;
   this->win_lft = pix_l;
   this->win_rgt = pix_r;
   this->win_top = win_t;
@@ -95,37 +298,92 @@ bool map_autoscroll_bar_window(graph_screen_region_t *this,
   this->yscl = (float)(this->sr.yMax - this->sr.yMin + 1) / (this->win_bot - this->win_top);
   this->xoff = this->sr.xMin - this->win_lft * this->xscl;
   this->yoff = this->sr.yMin - this->win_top * this->yscl;
+  fixed_from_float(this);
   return clear_window(this);
 }
 
-void draw_next_as_bar(graph_screen_region_t *this, float yVal){
-  if (this->next_x >= this->win_rgt) {
+bool map_autoscroll_bar_window_q(graph_screen_region_t *this,
+    srn_fix_t win_t, srn_fix_t win_b,
+		int   pix_l, int   pix_t, int   pix_r, int   pix_b){
+  if (!pix_range_ok(pix_l, pix_t, pix_r, pix_b)) return false;
+  screen_region_t sr;
+  set_screen_region(&sr, pix_l, pix_t, pix_r, pix_b);
+  srn_fix_t xscl, yscl;
+  if (!fixed_scale(sr.xMax - sr.xMin + 1, SRN_INT_TO_FIX(pix_l), SRN_INT_TO_FIX(pix_r), &xscl) ||
+      !fixed_scale(sr.yMax - sr.yMin + 1, win_t, win_b, &yscl)) {
+    return false;
+  }
+  this->sr = sr;
+  this->xscl_q = xscl;
+  this->xorg_q = SRN_INT_TO_FIX(pix_l);
+  this->yscl_q = yscl;
+  this->yorg_q = win_t;
+  this->win_lft = pix_l;
+  this->win_rgt = pix_r;
+  this->win_top = (float)win_t / SRN_FIX_ONE;
+  this->win_bot = (float)win_b / SRN_FIX_ONE;
+  float_from_fixed(this);
+  return clear_window(this);
+}
+
+// AUTOSCROLL GRAPHS
+// The float and fixed point entry points only differ in how the new value
+// is transformed to a screen row.  The rest works on screen coordinates.
+
+// moves to the next column, scrolling the graph if it is at the right edge
+static void next_column(graph_screen_region_t *this) {
+  if (this->next_x >= this->sr.xMax) {
     scroll_screen_region(&this->sr, 1, 0);
-    this->next_x = this->win_rgt;
+    this->next_x = this->sr.xMax;
   } else {
-    this->next_x += 1.0;
-  }
-  int i_next_x = (int)this->next_x;
-  int i_yval = (int)(yVal * this->yscl + this->yoff);
-  for (; i_yval <= this->sr.yMax; i_yval++) {
-    put_pixel(&this->sr, i_next_x, i_yval, 1);
+    this->next_x += 1;
   }
 }
 
-void draw_next_as_line(graph_screen_region_t *this, float yVal){
-  if (this->next_x == this->win_lft) {  // handle the case of no last y value
-    draw_point(this, this->next_x, yVal); //draw a point at first column
-    this->last_yVal = yVal; // save yval for next loop
-    this->next_x += 1.0;
+static void next_bar(graph_screen_region_t *this, int i_yval) {
+  next_column(this);
+  if (i_yval < this->sr.yMin) i_yval = this->sr.yMin;
+  fill_vspan(this->next_x, i_yval, this->sr.yMax, 1);
+}
+
+void draw_next_as_bar(graph_screen_region_t *this, float yVal){
+  next_bar(this, (int)(yVal * this->yscl + this->yoff));
+}
+
+void draw_next_as_bar_q(graph_screen_region_t *this, srn_fix_t yVal){
+  int64_t y = SCREEN_Y(this, yVal) >> SRN_FIX_FRAC_BITS;
+  if (y < this->sr.yMin) y = this->sr.yMin;
+  if (y > this->sr.yMax + 1) y = this->sr.yMax + 1;
+  next_bar(this, (int)y);
+}
+
+// x of the autoscroll column in fixed point screen coordinates
+static inline int64_t column_to_screen(graph_screen_region_t *this, int x) {
+  return SCREEN_X(this, SRN_INT_TO_FIX(x));
+}
+
+// y is the new value in fixed point screen coordinates
+static void next_line(graph_screen_region_t *this, int64_t y) {
+  if (this->next_x == this->sr.xMin) {  // handle the case of no last y value
+    //draw a point at first column
+    put_fixed_pixel(&this->sr, column_to_screen(this, this->next_x), y);
+    this->last_y = y; // save y for next loop
+    this->next_x += 1;
     return; // and we're done
   } 
-  if (this->next_x >= this->win_rgt) { // if at the right edge, scroll the window.
-    scroll_screen_region(&this->sr, 1, 0);
-    this->next_x = this->win_rgt;
-  } else {
-    this->next_x += 1.0;
-  }
-  draw_line(this, this->next_x-1.0, this->last_yVal, this->next_x, yVal );
-  this->last_yVal = yVal;
+  next_column(this);  // if at the right edge, scroll the window.
+  draw_fixed_line(&this->sr, column_to_screen(this, this->next_x - 1), this->last_y,
+                  column_to_screen(this, this->next_x), y);
+  this->last_y = y;
 }
 
+void draw_next_as_line(graph_screen_region_t *this, float yVal){
+  next_line(this, srn_float_to_fix(yVal * this->yscl + this->yoff));
+}
+
+void draw_next_as_line_q(graph_screen_region_t *this, srn_fix_t yVal){
+  int64_t y = SCREEN_Y(this, yVal);
+  if (y > INT32_MAX) y = INT32_MAX;
+  if (y < INT32_MIN) y = INT32_MIN;
+  next_line(this, y);
+}
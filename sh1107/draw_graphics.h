@@ -13,6 +13,38 @@
 #ifndef DRAW_GRAPHICS_H
 #define DRAW_GRAPHICS_H
 
+#include <math.h>
+
+// FIXED POINT
+// Every drawing function has a _q twin that takes signed fixed point values
+// with SRN_FIX_FRAC_BITS fraction bits (16.16 by default) instead of floats,
+// so values that are already integers, such as ADC counts, can be plotted
+// without any soft float work on the M0+.  Whole numbers convert with
+// SRN_INT_TO_FIX().  Window values up to +-32767 are supported at 16.16.
+// The _q functions land within one pixel of the float ones.
+#ifndef SRN_FIX_FRAC_BITS
+#define SRN_FIX_FRAC_BITS 16
+#endif
+#if SRN_FIX_FRAC_BITS < 8 || SRN_FIX_FRAC_BITS > 20
+#error "SRN_FIX_FRAC_BITS must be between 8 and 20"
+#endif
+
+typedef int32_t srn_fix_t;
+
+#define SRN_FIX_ONE (1 << SRN_FIX_FRAC_BITS)
+#define SRN_INT_TO_FIX(i) ((srn_fix_t)(i) * SRN_FIX_ONE)
+#define SRN_FLOAT_TO_FIX(f) ((srn_fix_t)((f) * SRN_FIX_ONE))
+
+// Converts a float to fixed point, rounding down and saturating values
+// out of range.  NaN gives the lowest value.  Unlike SRN_FLOAT_TO_FIX() it
+// is safe for any value.
+static inline srn_fix_t srn_float_to_fix(float v) {
+  v *= SRN_FIX_ONE;
+  if (v >= 2147483520.0f) return INT32_MAX;  // the largest float below 2^31
+  if (!(v > -2147483520.0f)) return INT32_MIN;
+  return (srn_fix_t)floorf(v);
+}
+
 // Provides a drawing contect for wither general line and dot drawing or
 // for the autoscrolling line and bar graphs.  This structure should always
 // be initialized with either the map_window() or map_autoscroll_bar_window()
@@ -22,8 +54,10 @@ typedef struct graph_screen_region {
   float win_top, win_bot;
   float xscl, xoff;
   float yscl, yoff;
-  float next_x;
-  float last_yVal;
+  srn_fix_t xscl_q, xorg_q;   // the same mapping in fixed point, scaled
+  srn_fix_t yscl_q, yorg_q;   // from the window origin at xMin, yMin
+  int next_x;                 // next column of the autoscroll graphs
+  srn_fix_t last_y;           // last graph value in fixed point screen rows
   screen_region_t sr;
 } graph_screen_region_t;
 
@@ -40,6 +74,9 @@ bool clear_window(graph_screen_region_t *this);
 bool map_window(graph_screen_region_t *this,
 		float win_l, float win_t, float win_r, float win_b,
 		int   pix_l, int   pix_t, int   pix_r, int   pix_b);
+bool map_window_q(graph_screen_region_t *this,
+		srn_fix_t win_l, srn_fix_t win_t, srn_fix_t win_r, srn_fix_t win_b,
+		int   pix_l, int   pix_t, int   pix_r, int   pix_b);
 
 // Same as above but only in Y.  X floating point range of the window 
 // is mapped to the same as the screen ragion x range.  This makes it
@@ -47,25 +84,32 @@ bool map_window(graph_screen_region_t *this,
 bool map_autoscroll_bar_window(graph_screen_region_t *this,
     float win_t, float win_b,
 		int   pix_l, int   pix_t, int   pix_r, int   pix_b);
+bool map_autoscroll_bar_window_q(graph_screen_region_t *this,
+    srn_fix_t win_t, srn_fix_t win_b,
+		int   pix_l, int   pix_t, int   pix_r, int   pix_b);
 
 // Draws a line in the graph_screen_region.  line endpoints should be in the 
 // window range defined in the map_window function.  Portions of the line 
 // outside that region will not be drawn.
 void draw_line(graph_screen_region_t *this, float x1, float y1, float x2, float y2 );
+void draw_line_q(graph_screen_region_t *this, srn_fix_t x1, srn_fix_t y1, srn_fix_t x2, srn_fix_t y2);
 
 // draws a point in the graph_screen_region.  The coordinate should be in the 
 // window range defined in the map_window function.  dots outside that region 
 // will not be drawn.
 void draw_point(graph_screen_region_t *this, float x1, float y1);
+void draw_point_q(graph_screen_region_t *this, srn_fix_t x1, srn_fix_t y1);
 
 // Takes a y value and plots a bar in a bar graph to the right of the last value.
 // When the screen region is full, the bargraph scrolls to the right.
 // Must use map_autoscroll_bar_window to initialize the screen region.
 void draw_next_as_bar(graph_screen_region_t *this, float yVal);
+void draw_next_as_bar_q(graph_screen_region_t *this, srn_fix_t yVal);
 
 // Takes a y value and plots a line from the last value to the next incrament to the right.
 // When the screen region is full, the bargraph scrolls to the right.
 // Must use map_autoscroll_bar_window to initialize the screen region.
 void draw_next_as_line(graph_screen_region_t *this, float yVal);
+void draw_next_as_line_q(graph_screen_region_t *this, srn_fix_t yVal);
 
 #endif
@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_port.h"
+#include "draw_sprite.h"
+
+// The icons are generated with tools/sprite_compiler:
+//   sprite_compiler -k -n srn_icon_battery -o icon_battery.h tools/icons/battery.pbm
+//   sprite_compiler -n srn_icon_link -o icon_link.h tools/icons/link.pbm
+//   sprite_compiler -k -n srn_icon_warning -o icon_warning.h tools/icons/warning.pbm
+#include "icon_battery.h"
+#include "icon_link.h"
+#include "icon_warning.h"
+
+// Sprites are drawn straight into the page bytes rather than through
+// bitblt(): the shifted copies already line up with the pages, so each
+// byte is one masked combine, and only the top and bottom page need the
+// rows outside the clip kept.
+
+static void draw_clipped(const srn_sprite_t *sprite, const screen_region_t *bounds, int x, int y) {
+  int x0 = x > bounds->xMin ? x : bounds->xMin;
+  int y0 = y > bounds->yMin ? y : bounds->yMin;
+  int x1 = x + sprite->width - 1;
+  int y1 = y + sprite->height - 1;
+  if (x1 > bounds->xMax) x1 = bounds->xMax;
+  if (y1 > bounds->yMax) y1 = bounds->yMax;
+  if (x0 > x1 || y0 > y1) return;
+
+  // the copy shifted down by y & 7 starts on the page above or at y
+  int width = sprite->width;
+  int top_page = y >> 3;
+  int copy = (y & 7) * sprite->pages * width + (x0 - x);
+  const uint8_t *image = sprite->image + copy;
+  const uint8_t *mask = sprite->mask ? sprite->mask + copy : NULL;
+  int stride = &SRN_PAGE_BYTE(0, 1) - &SRN_PAGE_BYTE(0, 0);
+  int n = x1 - x0 + 1;
+  int last_page = y1 >> 3;
+  for (int page = y0 >> 3; page <= last_page; page++) {
+    uint8_t rows = 0xFF;
+    if (page == y0 >> 3) rows &= 0xFF << (y0 & 7);
+    if (page == last_page) rows &= 0xFF >> (7 - (y1 & 7));
+    int offset = (page - top_page) * width;
+    const uint8_t *ip = image + offset;
+    uint8_t *d = &SRN_PAGE_BYTE(page, x0);
+    if (mask == NULL) {
+      for (int i = 0; i < n; i++, d += stride) *d |= ip[i] & rows;
+    } else if (rows == 0xFF) {
+      const uint8_t *mp = mask + offset;
+      for (int i = 0; i < n; i++, d += stride) *d = (*d & ~mp[i]) | ip[i];
+    } else {
+      const uint8_t *mp = mask + offset;
+      for (int i = 0; i < n; i++, d += stride) {
+        uint8_t m = mp[i] & rows;
+        *d = (*d & ~m) | (ip[i] & m);
+      }
+    }
+    srn_mark_dirty(page, x0, x1);
+  }
+}
+
+void draw_sprite(const srn_sprite_t *sprite, const screen_region_t *clip, int x, int y) {
+  screen_region_t bounds;
+  srn_clip_bounds(clip, &bounds);
+  draw_clipped(sprite, &bounds, x, y);
+}
+
+void draw_sprites(const srn_sprite_at_t *list, int n, const screen_region_t *clip) {
+  screen_region_t bounds;
+  srn_clip_bounds(clip, &bounds);
+  for (int i = 0; i < n; i++) {
+    draw_clipped(list[i].sprite, &bounds, list[i].x, list[i].y);
+  }
+}
@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* draw_sprite.h
+ * Sprites are small images, such as status icons, drawn at any pixel
+ * position.  Each sprite is stored in all 8 vertical shifts within a page,
+ * in the byte layout of srn_display_pixels, so drawing one is a masked
+ * combine of whole bytes with no shifting at run time.  Sprites are made
+ * from PBM images by tools/sprite_compiler.c.
+ *
+ * A sprite with a mask replaces the pixels under its mask and leaves the
+ * rest.  A sprite without one is ORed in, so its unlit pixels are
+ * transparent.
+ */
+
+#ifndef DRAW_SPRITE_H
+#define DRAW_SPRITE_H
+
+#include "pixel_ops.h"
+
+// The image and mask hold 8 copies of the sprite, one for each shift s
+// from 0 to 7 rows below a page boundary.  Copy s is pages page rows of
+// width bytes, starting at byte s * pages * width.
+typedef struct srn_sprite {
+  uint8_t width, height;   // in pixels
+  uint8_t pages;           // page rows in each copy
+  const uint8_t *image;    // lit pixels
+  const uint8_t *mask;     // opaque pixels, NULL to OR the image in
+} srn_sprite_t;
+
+// a sprite and where to draw it, for draw_sprites()
+typedef struct srn_sprite_at {
+  const srn_sprite_t *sprite;
+  int16_t x, y;
+} srn_sprite_at_t;
+
+// built in 8x8 status icons, made with tools/sprite_compiler.c
+extern const srn_sprite_t srn_icon_battery;
+extern const srn_sprite_t srn_icon_link;
+extern const srn_sprite_t srn_icon_warning;
+
+// Draws sprite with its top left corner at x, y.  Only the part inside
+// clip is drawn, or inside the display if clip is NULL.
+void draw_sprite(const srn_sprite_t *sprite, const screen_region_t *clip, int x, int y);
+
+// Draws n sprites in order, so later ones are on top.
+void draw_sprites(const srn_sprite_at_t *list, int n, const screen_region_t *clip);
+
+#endif
@@ -0,0 +1,297 @@
+/* font8x8_2x.h
+ * Generated by tools/font_compiler, do not edit.
+ *   font_compiler -s 2 -n srn_font8x8_2x -o font8x8_2x.h builtin
+ */
+
+static const uint8_t srn_font8x8_2x_glyphs[] = {
+  // 0x20 ( )
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x21 (!)
+  0x00, 0x00, 0x00, 0x00, 0x3C, 0x3C, 0xFF, 0xFF, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x22 (")
+  0x00, 0x00, 0x0F, 0x0F, 0x0F, 0x0F, 0x00, 0x00, 0x0F, 0x0F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x23 (#)
+  0x30, 0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x30, 0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x30, 0x30, 0x00, 0x00,
+  0x03, 0x03, 0x3F, 0x3F, 0x3F, 0x3F, 0x03, 0x03, 0x3F, 0x3F, 0x3F, 0x3F, 0x03, 0x03, 0x00, 0x00,
+  // 0x24 ($)
+  0x30, 0x30, 0xFC, 0xFC, 0xCF, 0xCF, 0xCF, 0xCF, 0xCC, 0xCC, 0x0C, 0x0C, 0x00, 0x00, 0x00, 0x00,
+  0x0C, 0x0C, 0x0C, 0x0C, 0x3C, 0x3C, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00,
+  // 0x25 (%)
+  0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00, 0xC0, 0xC0, 0xF0, 0xF0, 0x3C, 0x3C, 0x0C, 0x0C, 0x00, 0x00,
+  0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00,
+  // 0x26 (&)
+  0x00, 0x00, 0xCC, 0xCC, 0xFF, 0xFF, 0xF3, 0xF3, 0x3F, 0x3F, 0xCC, 0xCC, 0xC0, 0xC0, 0x00, 0x00,
+  0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x33, 0x33, 0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00,
+  // 0x27 (')
+  0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x28 (()
+  0x00, 0x00, 0xF0, 0xF0, 0xFC, 0xFC, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x29 ())
+  0x00, 0x00, 0x03, 0x03, 0x0F, 0x0F, 0xFC, 0xFC, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x2A (*)
+  0xC0, 0xC0, 0xCC, 0xCC, 0xFC, 0xFC, 0xF0, 0xF0, 0xF0, 0xF0, 0xFC, 0xFC, 0xCC, 0xCC, 0xC0, 0xC0,
+  0x00, 0x00, 0x0C, 0x0C, 0x0F, 0x0F, 0x03, 0x03, 0x03, 0x03, 0x0F, 0x0F, 0x0C, 0x0C, 0x00, 0x00,
+  // 0x2B (+)
+  0xC0, 0xC0, 0xC0, 0xC0, 0xFC, 0xFC, 0xFC, 0xFC, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x0F, 0x0F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x2C (,)
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0xC0, 0xC0, 0xFC, 0xFC, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x2D (-)
+  0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x2E (.)
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x2F (/)
+  0x00, 0x00, 0x00, 0x00, 0xC0, 0xC0, 0xF0, 0xF0, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00,
+  0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x30 (0)
+  0xFC, 0xFC, 0xFF, 0xFF, 0x03, 0x03, 0xC3, 0xC3, 0xF3, 0xF3, 0xFF, 0xFF, 0xFC, 0xFC, 0x00, 0x00,
+  0x0F, 0x0F, 0x3F, 0x3F, 0x3F, 0x3F, 0x33, 0x33, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00,
+  // 0x31 (1)
+  0x00, 0x00, 0x0C, 0x0C, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00,
+  // 0x32 (2)
+  0x0C, 0x0C, 0x0F, 0x0F, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00,
+  0x3C, 0x3C, 0x3F, 0x3F, 0x33, 0x33, 0x30, 0x30, 0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00,
+  // 0x33 (3)
+  0x0C, 0x0C, 0x0F, 0x0F, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00,
+  0x0C, 0x0C, 0x3C, 0x3C, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00,
+  // 0x34 (4)
+  0xC0, 0xC0, 0xF0, 0xF0, 0x3C, 0x3C, 0x0F, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00,
+  0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x33, 0x33, 0x3F, 0x3F, 0x3F, 0x3F, 0x33, 0x33, 0x00, 0x00,
+  // 0x35 (5)
+  0x3F, 0x3F, 0x3F, 0x3F, 0x33, 0x33, 0x33, 0x33, 0xF3, 0xF3, 0xC3, 0xC3, 0x00, 0x00, 0x00, 0x00,
+  0x0C, 0x0C, 0x3C, 0x3C, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00,
+  // 0x36 (6)
+  0xF0, 0xF0, 0xFC, 0xFC, 0xCF, 0xCF, 0xC3, 0xC3, 0xC3, 0xC3, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00,
+  // 0x37 (7)
+  0x0F, 0x0F, 0x0F, 0x0F, 0x03, 0x03, 0xC3, 0xC3, 0xFF, 0xFF, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x38 (8)
+  0x3C, 0x3C, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00,
+  0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00,
+  // 0x39 (9)
+  0x3C, 0x3C, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xFC, 0xFC, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x30, 0x30, 0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00,
+  // 0x3A (:)
+  0x00, 0x00, 0x00, 0x00, 0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x3B (;)
+  0x00, 0x00, 0x00, 0x00, 0x3C, 0x3C, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0xC0, 0xC0, 0xFC, 0xFC, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x3C (<)
+  0xC0, 0xC0, 0xF0, 0xF0, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x3D (=)
+  0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00,
+  0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x00, 0x00, 0x00, 0x00,
+  // 0x3E (>)
+  0x00, 0x00, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x3F (?)
+  0x0C, 0x0C, 0x0F, 0x0F, 0x03, 0x03, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x40 (@)
+  0xFC, 0xFC, 0xFF, 0xFF, 0x03, 0x03, 0xF3, 0xF3, 0xF3, 0xF3, 0xFF, 0xFF, 0xFC, 0xFC, 0x00, 0x00,
+  0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x33, 0x33, 0x33, 0x33, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00,
+  // 0x41 (A)
+  0xF0, 0xF0, 0xFC, 0xFC, 0x0F, 0x0F, 0x0F, 0x0F, 0xFC, 0xFC, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00,
+  0x3F, 0x3F, 0x3F, 0x3F, 0x03, 0x03, 0x03, 0x03, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00,
+  // 0x42 (B)
+  0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00,
+  // 0x43 (C)
+  0xF0, 0xF0, 0xFC, 0xFC, 0x0F, 0x0F, 0x03, 0x03, 0x03, 0x03, 0x0F, 0x0F, 0x0C, 0x0C, 0x00, 0x00,
+  0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x30, 0x30, 0x3C, 0x3C, 0x0C, 0x0C, 0x00, 0x00,
+  // 0x44 (D)
+  0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x03, 0x03, 0x0F, 0x0F, 0xFC, 0xFC, 0xF0, 0xF0, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00,
+  // 0x45 (E)
+  0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0xC3, 0xC3, 0xF3, 0xF3, 0x03, 0x03, 0x0F, 0x0F, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x33, 0x33, 0x30, 0x30, 0x3C, 0x3C, 0x00, 0x00,
+  // 0x46 (F)
+  0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0xC3, 0xC3, 0xF3, 0xF3, 0x03, 0x03, 0x0F, 0x0F, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x47 (G)
+  0xF0, 0xF0, 0xFC, 0xFC, 0x0F, 0x0F, 0x03, 0x03, 0x03, 0x03, 0x0F, 0x0F, 0x0C, 0x0C, 0x00, 0x00,
+  0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x33, 0x33, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00,
+  // 0x48 (H)
+  0xFF, 0xFF, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00,
+  0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00,
+  // 0x49 (I)
+  0x00, 0x00, 0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x4A (J)
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x03, 0x03, 0x00, 0x00,
+  0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00,
+  // 0x4B (K)
+  0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0xC0, 0xC0, 0xF0, 0xF0, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x03, 0x03, 0x3F, 0x3F, 0x3C, 0x3C, 0x00, 0x00,
+  // 0x4C (L)
+  0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x3C, 0x3C, 0x3F, 0x3F, 0x00, 0x00,
+  // 0x4D (M)
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFC, 0xFC, 0xF0, 0xF0, 0xFC, 0xFC, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00,
+  0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x03, 0x03, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00,
+  // 0x4E (N)
+  0xFF, 0xFF, 0xFF, 0xFF, 0x3C, 0x3C, 0xF0, 0xF0, 0xC0, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00,
+  0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00,
+  // 0x4F (O)
+  0xF0, 0xF0, 0xFC, 0xFC, 0x0F, 0x0F, 0x03, 0x03, 0x0F, 0x0F, 0xFC, 0xFC, 0xF0, 0xF0, 0x00, 0x00,
+  0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00,
+  // 0x50 (P)
+  0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x51 (Q)
+  0xFC, 0xFC, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, 0xFF, 0xFF, 0xFC, 0xFC, 0x00, 0x00, 0x00, 0x00,
+  0x03, 0x03, 0x0F, 0x0F, 0x0C, 0x0C, 0x3F, 0x3F, 0x3F, 0x3F, 0x33, 0x33, 0x00, 0x00, 0x00, 0x00,
+  // 0x52 (R)
+  0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x3C, 0x3C, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x03, 0x03, 0x3F, 0x3F, 0x3C, 0x3C, 0x00, 0x00,
+  // 0x53 (S)
+  0x3C, 0x3C, 0xFF, 0xFF, 0xF3, 0xF3, 0xC3, 0xC3, 0x0F, 0x0F, 0x0C, 0x0C, 0x00, 0x00, 0x00, 0x00,
+  0x0C, 0x0C, 0x3C, 0x3C, 0x30, 0x30, 0x33, 0x33, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00,
+  // 0x54 (T)
+  0x0F, 0x0F, 0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x03, 0x03, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x55 (U)
+  0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00,
+  0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00,
+  // 0x56 (V)
+  0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00,
+  0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00,
+  // 0x57 (W)
+  0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0xC0, 0xC0, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00,
+  0x3F, 0x3F, 0x3F, 0x3F, 0x0F, 0x0F, 0x03, 0x03, 0x0F, 0x0F, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00,
+  // 0x58 (X)
+  0x0F, 0x0F, 0x3F, 0x3F, 0xF0, 0xF0, 0xC0, 0xC0, 0xF0, 0xF0, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00,
+  0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x00, 0x00,
+  // 0x59 (Y)
+  0x3F, 0x3F, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0xFF, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x5A (Z)
+  0x3F, 0x3F, 0x0F, 0x0F, 0x03, 0x03, 0xC3, 0xC3, 0xF3, 0xF3, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00,
+  0x30, 0x30, 0x3C, 0x3C, 0x3F, 0x3F, 0x33, 0x33, 0x30, 0x30, 0x3C, 0x3C, 0x3F, 0x3F, 0x00, 0x00,
+  // 0x5B ([)
+  0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x5C (\)
+  0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x00, 0x00,
+  // 0x5D (])
+  0x00, 0x00, 0x03, 0x03, 0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x5E (^)
+  0xC0, 0xC0, 0xF0, 0xF0, 0x3C, 0x3C, 0x0F, 0x0F, 0x3C, 0x3C, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x5F (_)
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+  // 0x60 (`)
+  0x00, 0x00, 0x00, 0x00, 0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x61 (a)
+  0x00, 0x00, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+  0x0C, 0x0C, 0x3F, 0x3F, 0x33, 0x33, 0x33, 0x33, 0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00,
+  // 0x62 (b)
+  0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00,
+  // 0x63 (c)
+  0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+  0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x3C, 0x3C, 0x0C, 0x0C, 0x00, 0x00, 0x00, 0x00,
+  // 0x64 (d)
+  0x00, 0x00, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xC3, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00,
+  0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00,
+  // 0x65 (e)
+  0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+  0x0F, 0x0F, 0x3F, 0x3F, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00,
+  // 0x66 (f)
+  0xC0, 0xC0, 0xFC, 0xFC, 0xFF, 0xFF, 0xC3, 0xC3, 0x0F, 0x0F, 0x0C, 0x0C, 0x00, 0x00, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x67 (g)
+  0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x00, 0x00,
+  0xC3, 0xC3, 0xCF, 0xCF, 0xCC, 0xCC, 0xCC, 0xCC, 0xFF, 0xFF, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00,
+  // 0x68 (h)
+  0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0xC0, 0xC0, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00,
+  // 0x69 (i)
+  0x00, 0x00, 0x30, 0x30, 0xF3, 0xF3, 0xF3, 0xF3, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x6A (j)
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF3, 0xF3, 0xF3, 0xF3, 0x00, 0x00, 0x00, 0x00,
+  0x3C, 0x3C, 0xFC, 0xFC, 0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0xFF, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00,
+  // 0x6B (k)
+  0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x00, 0x00,
+  // 0x6C (l)
+  0x00, 0x00, 0x03, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x6D (m)
+  0xF0, 0xF0, 0xF0, 0xF0, 0xC0, 0xC0, 0xC0, 0xC0, 0xF0, 0xF0, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+  0x3F, 0x3F, 0x3F, 0x3F, 0x03, 0x03, 0x0F, 0x0F, 0x03, 0x03, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00,
+  // 0x6E (n)
+  0xF0, 0xF0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+  0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00,
+  // 0x6F (o)
+  0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+  0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00,
+  // 0x70 (p)
+  0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+  0xC0, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xCC, 0xCC, 0x0C, 0x0C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00,
+  // 0x71 (q)
+  0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x00, 0x00,
+  0x03, 0x03, 0x0F, 0x0F, 0x0C, 0x0C, 0xCC, 0xCC, 0xFF, 0xFF, 0xFF, 0xFF, 0xC0, 0xC0, 0x00, 0x00,
+  // 0x72 (r)
+  0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00,
+  0x30, 0x30, 0x3F, 0x3F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00,
+  // 0x73 (s)
+  0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00,
+  0x30, 0x30, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x3F, 0x0C, 0x0C, 0x00, 0x00, 0x00, 0x00,
+  // 0x74 (t)
+  0x00, 0x00, 0x30, 0x30, 0xFC, 0xFC, 0xFF, 0xFF, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x0C, 0x0C, 0x00, 0x00, 0x00, 0x00,
+  // 0x75 (u)
+  0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00,
+  0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00,
+  // 0x76 (v)
+  0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00,
+  0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00,
+  // 0x77 (w)
+  0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00, 0xC0, 0xC0, 0x00, 0x00, 0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00,
+  0x0F, 0x0F, 0x3F, 0x3F, 0x3F, 0x3F, 0x0F, 0x0F, 0x3F, 0x3F, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00,
+  // 0x78 (x)
+  0x30, 0x30, 0xF0, 0xF0, 0xC0, 0xC0, 0x00, 0x00, 0xC0, 0xC0, 0xF0, 0xF0, 0x30, 0x30, 0x00, 0x00,
+  0x30, 0x30, 0x3C, 0x3C, 0x0F, 0x0F, 0x03, 0x03, 0x0F, 0x0F, 0x3C, 0x3C, 0x30, 0x30, 0x00, 0x00,
+  // 0x79 (y)
+  0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00,
+  0xC3, 0xC3, 0xCF, 0xCF, 0xCC, 0xCC, 0xCC, 0xCC, 0xFF, 0xFF, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00,
+  // 0x7A (z)
+  0xF0, 0xF0, 0x30, 0x30, 0x30, 0x30, 0xF0, 0xF0, 0xF0, 0xF0, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00,
+  0x30, 0x30, 0x3C, 0x3C, 0x3F, 0x3F, 0x33, 0x33, 0x30, 0x30, 0x3C, 0x3C, 0x00, 0x00, 0x00, 0x00,
+  // 0x7B ({)
+  0xC0, 0xC0, 0xC0, 0xC0, 0xFC, 0xFC, 0x3F, 0x3F, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x0F, 0x0F, 0x3F, 0x3F, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00,
+  // 0x7C (|)
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x7D (})
+  0x03, 0x03, 0x03, 0x03, 0x3F, 0x3F, 0xFC, 0xFC, 0xC0, 0xC0, 0xC0, 0xC0, 0x00, 0x00, 0x00, 0x00,
+  0x30, 0x30, 0x30, 0x30, 0x3F, 0x3F, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 0x7E (~)
+  0x0C, 0x0C, 0x0F, 0x0F, 0x03, 0x03, 0x0F, 0x0F, 0x0C, 0x0C, 0x0F, 0x0F, 0x03, 0x03, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+const srn_font_t srn_font8x8_2x = {
+  .first = 32, .last = 126, .height = 16, .cell_width = 16, .spacing = 0,
+  .glyphs = srn_font8x8_2x_glyphs, .metrics = NULL,
+};
@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* font8x8_metrics.h
+ * Per glyph metrics of font8x8_basic for proportional text: the first
+ * column with any pixels set and the number of columns from there to the
+ * last one.  The space is given three blank columns.  Generated from
+ * font8x8_basic.h.
+ */
+
+#ifndef FONT8X8_METRICS_H
+#define FONT8X8_METRICS_H
+
+static const srn_glyph_metrics_t font8x8_basic_metrics[128] = {
+  {0, 0},   // U+0000 (nul)
+  {0, 0},   // U+0001
+  {0, 0},   // U+0002
+  {0, 0},   // U+0003
+  {0, 0},   // U+0004
+  {0, 0},   // U+0005
+  {0, 0},   // U+0006
+  {0, 0},   // U+0007
+  {0, 0},   // U+0008
+  {0, 0},   // U+0009
+  {0, 0},   // U+000A
+  {0, 0},   // U+000B
+  {0, 0},   // U+000C
+  {0, 0},   // U+000D
+  {0, 0},   // U+000E
+  {0, 0},   // U+000F
+  {0, 0},   // U+0010
+  {0, 0},   // U+0011
+  {0, 0},   // U+0012
+  {0, 0},   // U+0013
+  {0, 0},   // U+0014
+  {0, 0},   // U+0015
+  {0, 0},   // U+0016
+  {0, 0},   // U+0017
+  {0, 0},   // U+0018
+  {0, 0},   // U+0019
+  {0, 0},   // U+001A
+  {0, 0},   // U+001B
+  {0, 0},   // U+001C
+  {0, 0},   // U+001D
+  {0, 0},   // U+001E
+  {0, 0},   // U+001F
+  {0, 3},   // U+0020 (space)
+  {2, 4},   // U+0021 (!)
+  {1, 5},   // U+0022 (")
+  {0, 7},   // U+0023 (#)
+  {0, 6},   // U+0024 ($)
+  {0, 7},   // U+0025 (%)
+  {0, 7},   // U+0026 (&)
+  {0, 3},   // U+0027 (')
+  {1, 4},   // U+0028 (()
+  {1, 4},   // U+0029 ())
+  {0, 8},   // U+002A (*)
+  {0, 6},   // U+002B (+)
+  {1, 3},   // U+002C (,)
+  {0, 6},   // U+002D (-)
+  {2, 2},   // U+002E (.)
+  {0, 7},   // U+002F (/)
+  {0, 7},   // U+0030 (0)
+  {0, 6},   // U+0031 (1)
+  {0, 6},   // U+0032 (2)
+  {0, 6},   // U+0033 (3)
+  {0, 7},   // U+0034 (4)
+  {0, 6},   // U+0035 (5)
+  {0, 6},   // U+0036 (6)
+  {0, 6},   // U+0037 (7)
+  {0, 6},   // U+0038 (8)
+  {0, 6},   // U+0039 (9)
+  {2, 2},   // U+003A (:)
+  {1, 3},   // U+003B (;)
+  {0, 5},   // U+003C (<)
+  {0, 6},   // U+003D (=)
+  {1, 5},   // U+003E (>)
+  {0, 6},   // U+003F (?)
+  {0, 7},   // U+0040 (@)
+  {0, 6},   // U+0041 (A)
+  {0, 7},   // U+0042 (B)
+  {0, 7},   // U+0043 (C)
+  {0, 7},   // U+0044 (D)
+  {0, 7},   // U+0045 (E)
+  {0, 7},   // U+0046 (F)
+  {0, 7},   // U+0047 (G)
+  {0, 6},   // U+0048 (H)
+  {1, 4},   // U+0049 (I)
+  {0, 7},   // U+004A (J)
+  {0, 7},   // U+004B (K)
+  {0, 7},   // U+004C (L)
+  {0, 7},   // U+004D (M)
+  {0, 7},   // U+004E (N)
+  {0, 7},   // U+004F (O)
+  {0, 7},   // U+0050 (P)
+  {0, 6},   // U+0051 (Q)
+  {0, 7},   // U+0052 (R)
+  {0, 6},   // U+0053 (S)
+  {0, 6},   // U+0054 (T)
+  {0, 6},   // U+0055 (U)
+  {0, 6},   // U+0056 (V)
+  {0, 7},   // U+0057 (W)
+  {0, 7},   // U+0058 (X)
+  {0, 6},   // U+0059 (Y)
+  {0, 7},   // U+005A (Z)
+  {1, 4},   // U+005B ([)
+  {0, 7},   // U+005C (\)
+  {1, 4},   // U+005D (])
+  {0, 7},   // U+005E (^)
+  {0, 8},   // U+005F (_)
+  {2, 3},   // U+0060 (`)
+  {0, 7},   // U+0061 (a)
+  {0, 7},   // U+0062 (b)
+  {0, 6},   // U+0063 (c)
+  {0, 7},   // U+0064 (d)
+  {0, 6},   // U+0065 (e)
+  {0, 6},   // U+0066 (f)
+  {0, 7},   // U+0067 (g)
+  {0, 7},   // U+0068 (h)
+  {1, 4},   // U+0069 (i)
+  {0, 6},   // U+006A (j)
+  {0, 7},   // U+006B (k)
+  {1, 4},   // U+006C (l)
+  {0, 7},   // U+006D (m)
+  {0, 6},   // U+006E (n)
+  {0, 6},   // U+006F (o)
+  {0, 7},   // U+0070 (p)
+  {0, 7},   // U+0071 (q)
+  {0, 7},   // U+0072 (r)
+  {0, 6},   // U+0073 (s)
+  {1, 5},   // U+0074 (t)
+  {0, 7},   // U+0075 (u)
+  {0, 6},   // U+0076 (v)
+  {0, 7},   // U+0077 (w)
+  {0, 7},   // U+0078 (x)
+  {0, 6},   // U+0079 (y)
+  {0, 6},   // U+007A (z)
+  {0, 6},   // U+007B ({)
+  {3, 2},   // U+007C (|)
+  {0, 6},   // U+007D (})
+  {0, 7},   // U+007E (~)
+  {0, 0},   // U+007F
+};
+
+#endif
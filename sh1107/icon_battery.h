@@ -0,0 +1,61 @@
+/* icon_battery.h
+ * Generated by tools/sprite_compiler, do not edit.
+ *   sprite_compiler -k -n srn_icon_battery -o icon_battery.h tools/icons/battery.pbm
+ */
+
+static const uint8_t srn_icon_battery_image[] = {
+  // shift 0
+  0x7E, 0x42, 0x5A, 0x5A, 0x5A, 0x42, 0x7E, 0x18,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // shift 1
+  0xFC, 0x84, 0xB4, 0xB4, 0xB4, 0x84, 0xFC, 0x30,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // shift 2
+  0xF8, 0x08, 0x68, 0x68, 0x68, 0x08, 0xF8, 0x60,
+  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00,
+  // shift 3
+  0xF0, 0x10, 0xD0, 0xD0, 0xD0, 0x10, 0xF0, 0xC0,
+  0x03, 0x02, 0x02, 0x02, 0x02, 0x02, 0x03, 0x00,
+  // shift 4
+  0xE0, 0x20, 0xA0, 0xA0, 0xA0, 0x20, 0xE0, 0x80,
+  0x07, 0x04, 0x05, 0x05, 0x05, 0x04, 0x07, 0x01,
+  // shift 5
+  0xC0, 0x40, 0x40, 0x40, 0x40, 0x40, 0xC0, 0x00,
+  0x0F, 0x08, 0x0B, 0x0B, 0x0B, 0x08, 0x0F, 0x03,
+  // shift 6
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00,
+  0x1F, 0x10, 0x16, 0x16, 0x16, 0x10, 0x1F, 0x06,
+  // shift 7
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x3F, 0x21, 0x2D, 0x2D, 0x2D, 0x21, 0x3F, 0x0C,
+};
+
+static const uint8_t srn_icon_battery_mask[] = {
+  // shift 0
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // shift 1
+  0xFE, 0xFE, 0xFE, 0xFE, 0xFE, 0xFE, 0xFE, 0xFE,
+  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  // shift 2
+  0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC,
+  0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+  // shift 3
+  0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8,
+  0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+  // shift 4
+  0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+  0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+  // shift 5
+  0xE0, 0xE0, 0xE0, 0xE0, 0xE0, 0xE0, 0xE0, 0xE0,
+  0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F,
+  // shift 6
+  0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+  0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F,
+  // shift 7
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F,
+};
+
+const srn_sprite_t srn_icon_battery = {.width = 8, .height = 8, .pages = 2,
+   .image = srn_icon_battery_image, .mask = srn_icon_battery_mask};
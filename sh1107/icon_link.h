@@ -0,0 +1,34 @@
+/* icon_link.h
+ * Generated by tools/sprite_compiler, do not edit.
+ *   sprite_compiler -n srn_icon_link -o icon_link.h tools/icons/link.pbm
+ */
+
+static const uint8_t srn_icon_link_image[] = {
+  // shift 0
+  0x60, 0x90, 0x90, 0x68, 0x16, 0x09, 0x09, 0x06,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // shift 1
+  0xC0, 0x20, 0x20, 0xD0, 0x2C, 0x12, 0x12, 0x0C,
+  0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // shift 2
+  0x80, 0x40, 0x40, 0xA0, 0x58, 0x24, 0x24, 0x18,
+  0x01, 0x02, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00,
+  // shift 3
+  0x00, 0x80, 0x80, 0x40, 0xB0, 0x48, 0x48, 0x30,
+  0x03, 0x04, 0x04, 0x03, 0x00, 0x00, 0x00, 0x00,
+  // shift 4
+  0x00, 0x00, 0x00, 0x80, 0x60, 0x90, 0x90, 0x60,
+  0x06, 0x09, 0x09, 0x06, 0x01, 0x00, 0x00, 0x00,
+  // shift 5
+  0x00, 0x00, 0x00, 0x00, 0xC0, 0x20, 0x20, 0xC0,
+  0x0C, 0x12, 0x12, 0x0D, 0x02, 0x01, 0x01, 0x00,
+  // shift 6
+  0x00, 0x00, 0x00, 0x00, 0x80, 0x40, 0x40, 0x80,
+  0x18, 0x24, 0x24, 0x1A, 0x05, 0x02, 0x02, 0x01,
+  // shift 7
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x80, 0x00,
+  0x30, 0x48, 0x48, 0x34, 0x0B, 0x04, 0x04, 0x03,
+};
+
+const srn_sprite_t srn_icon_link = {.width = 8, .height = 8, .pages = 2,
+   .image = srn_icon_link_image, .mask = NULL};
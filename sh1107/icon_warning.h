@@ -0,0 +1,61 @@
+/* icon_warning.h
+ * Generated by tools/sprite_compiler, do not edit.
+ *   sprite_compiler -k -n srn_icon_warning -o icon_warning.h tools/icons/warning.pbm
+ */
+
+static const uint8_t srn_icon_warning_image[] = {
+  // shift 0
+  0xE0, 0x98, 0x86, 0xDD, 0xDD, 0x86, 0x98, 0xE0,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // shift 1
+  0xC0, 0x30, 0x0C, 0xBA, 0xBA, 0x0C, 0x30, 0xC0,
+  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  // shift 2
+  0x80, 0x60, 0x18, 0x74, 0x74, 0x18, 0x60, 0x80,
+  0x03, 0x02, 0x02, 0x03, 0x03, 0x02, 0x02, 0x03,
+  // shift 3
+  0x00, 0xC0, 0x30, 0xE8, 0xE8, 0x30, 0xC0, 0x00,
+  0x07, 0x04, 0x04, 0x06, 0x06, 0x04, 0x04, 0x07,
+  // shift 4
+  0x00, 0x80, 0x60, 0xD0, 0xD0, 0x60, 0x80, 0x00,
+  0x0E, 0x09, 0x08, 0x0D, 0x0D, 0x08, 0x09, 0x0E,
+  // shift 5
+  0x00, 0x00, 0xC0, 0xA0, 0xA0, 0xC0, 0x00, 0x00,
+  0x1C, 0x13, 0x10, 0x1B, 0x1B, 0x10, 0x13, 0x1C,
+  // shift 6
+  0x00, 0x00, 0x80, 0x40, 0x40, 0x80, 0x00, 0x00,
+  0x38, 0x26, 0x21, 0x37, 0x37, 0x21, 0x26, 0x38,
+  // shift 7
+  0x00, 0x00, 0x00, 0x80, 0x80, 0x00, 0x00, 0x00,
+  0x70, 0x4C, 0x43, 0x6E, 0x6E, 0x43, 0x4C, 0x70,
+};
+
+static const uint8_t srn_icon_warning_mask[] = {
+  // shift 0
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // shift 1
+  0xFE, 0xFE, 0xFE, 0xFE, 0xFE, 0xFE, 0xFE, 0xFE,
+  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  // shift 2
+  0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC,
+  0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+  // shift 3
+  0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8,
+  0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+  // shift 4
+  0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+  0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+  // shift 5
+  0xE0, 0xE0, 0xE0, 0xE0, 0xE0, 0xE0, 0xE0, 0xE0,
+  0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F,
+  // shift 6
+  0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0,
+  0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F,
+  // shift 7
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F,
+};
+
+const srn_sprite_t srn_icon_warning = {.width = 8, .height = 8, .pages = 2,
+   .image = srn_icon_warning_image, .mask = srn_icon_warning_mask};
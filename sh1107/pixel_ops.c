@@ -7,51 +7,76 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include "pico/stdlib.h"
-#include "pico/binary_info.h"
-#include "hardware/spi.h"
+#include "sh1107_port.h"
 #include "pixel_ops.h"
+#include "bitblt.h"
+#include "srn_perf.h"
 
-// PIXEL DATA
-// The display pixel buffer is is a local copy of the display buffer
-// in the SH1107.  All drawing commands make changes to display_pixel array
-// and then call srn_refresh to copy the holw buffer out to the SH1107.
+// SPANS
 
-extern uint8_t srn_display_pixels[16][128];
+// sets or clears the bits of mask in one page byte
+static inline void put_page_bits(int page, int x, uint8_t mask, int b) {
+  if (b) SRN_PAGE_BYTE(page, x) |= mask;
+  else SRN_PAGE_BYTE(page, x) &= ~mask;
+}
+
+// clips the span lo..hi to the display.  Returns false if nothing is left.
+static inline bool clip_span(int *lo, int *hi) {
+  if (*lo < 0) *lo = 0;
+  if (*hi > 127) *hi = 127;
+  return *lo <= *hi;
+}
 
+void fill_vspan(int x, int y0, int y1, int b) {
+  if (x < 0 || x > 127 || !clip_span(&y0, &y1)) return;
+  srn_mark_dirty_rect(x, y0, x, y1);
+  int page = y0 >> 3;
+  int last_page = y1 >> 3;
+  uint8_t head = 0xFF << (y0 & 7);
+  uint8_t tail = 0xFF >> (7 - (y1 & 7));
+  if (page == last_page) {
+    put_page_bits(page, x, head & tail, b);
+    return;
+  }
+  put_page_bits(page, x, head, b);
+  uint8_t val = b ? 0xFF : 0;
+  for (page++; page < last_page; page++) {
+    SRN_PAGE_BYTE(page, x) = val;
+  }
+  put_page_bits(last_page, x, tail, b);
+}
+
+void fill_hspan(int y, int x0, int x1, int b) {
+  if (y < 0 || y > 127 || !clip_span(&x0, &x1)) return;
+  int page = y >> 3;
+  srn_mark_dirty(page, x0, x1);
+  uint8_t mask = 1 << (y & 7);
+  uint8_t *p = &SRN_PAGE_BYTE(page, x0);
+  uint8_t *end = &SRN_PAGE_BYTE(page, x1);
+  int stride = &SRN_PAGE_BYTE(0, 1) - &SRN_PAGE_BYTE(0, 0);
+  if (b) {
+    for (; p <= end; p += stride) *p |= mask;
+  } else {
+    for (; p <= end; p += stride) *p &= ~mask;
+  }
+}
+
+void fill_rect(int x0, int y0, int x1, int y1, int b) {
+  srn_bitmap_t screen;
+  srn_screen_bitmap(&screen);
+  screen_region_t rect = {x0, y0, x1, y1};
+  bitblt_rect(&screen, &rect, b ? SRN_ROP_SET : SRN_ROP_CLEAR);
+}
 
 // Clears a region of the display bounded by min X, min Y, max X, max Y inclusive.
 // Returns false if bound are ouside the the bound are outside the display limits of
 // 0 to 127.  in that case no operation is performed
 static inline bool clear_display(int minX, int minY, int maxX, int maxY) {
+  SRN_PERF_TIME(SRN_PERF_CLEAR);
   if (minX < 0    || minY <    0 ||
       maxX < minX || maxY < minY ||
       maxX > 127  || maxY > 127) return false;
-  int row_part = minY & 0x7;
-  int row = minY >> 3;
-  int last_row = maxY >> 3;
-  int last_row_part = maxY & 0x7;
-  if (row == last_row || row_part != 0) {// top &  possible partial row
-    uint8_t row_mask = 0xFF << row_part;
-    if (row == last_row) {
-      row_mask &= 0xFF >> (7 - last_row_part);
-    }
-    for (int i = minX; i <= maxX; i++) {
-      srn_display_pixels[row][i] &= ~row_mask;
-    }
-    row += 1;
-  }
-  for (; row < last_row; row++) { // full rows
-    for (int i = minX; i <= maxX; i++) {
-      srn_display_pixels[row][i] = 0;
-    }
-  }
-  if (row == last_row) {// bottom partial row
-    uint8_t row_mask = 0xFF >> (7 - last_row_part);
-    for (int i = minX; i <= maxX; i++) {
-      srn_display_pixels[row][i] &= ~row_mask;
-    }
-  }
+  fill_rect(minX, minY, maxX, maxY, 0);
   return true;
 }
 
@@ -72,178 +97,40 @@ bool clear_screen_region(screen_region_t *this) {
   return clear_display(this->xMin, this->yMin, this->xMax, this->yMax);
 }
 
+void invert_screen_region(screen_region_t *this) {
+  srn_bitmap_t screen;
+  srn_screen_bitmap(&screen);
+  bitblt_rect(&screen, this, SRN_ROP_INVERT);
+}
 
 void scroll_screen_region(screen_region_t *this, int xStep, int yStep){
-  if (xStep > 0) { // shift pixels left
-    int row_part = this->yMin & 0x7;
-    int row = this->yMin >> 3;
-    int last_row = this->yMax >> 3;
-    int last_row_part = this->yMax & 0x7;
-    if (row == last_row || row_part != 0) {// top &  possible partial row
-      uint8_t row_mask = 0xFF << row_part;
-      if (row == last_row) {
-	row_mask &= 0xFF >> (7 - last_row_part);
-      }
-      for (int i = this->xMin; i <= this->xMax - xStep; i++) {
-	      srn_display_pixels[row][i] &= ~row_mask;
-	      srn_display_pixels[row][i] |= srn_display_pixels[row][i+xStep] & row_mask; 
-      }
-      for (int i = this->xMax - xStep + 1; i <= this->xMax; i++) {
-	      srn_display_pixels[row][i] &= ~row_mask;
-      }
-      row += 1;
-    }
-    for (; row < last_row; row++) { // full rows
-      for (int i = this->xMin; i <= this->xMax - xStep; i++) {
-	      srn_display_pixels[row][i] = srn_display_pixels[row][i+xStep]; 
-      }
-      for (int i = this->xMax - xStep + 1; i <= this->xMax; i++) {
-	      srn_display_pixels[row][i] = 0;
-      }
-    }
-    if (row == last_row) {// bottom partial row
-      uint8_t row_mask = 0xFF >> (7 - last_row_part);
-      for (int i = this->xMin; i <= this->xMax - xStep; i++) {
-	      srn_display_pixels[row][i] &= ~row_mask;
-	      srn_display_pixels[row][i] |= srn_display_pixels[row][i+xStep] & row_mask; 
-      }
-      for (int i = this->xMax - xStep + 1; i <= this->xMax; i++) {
-	      srn_display_pixels[row][i] &= ~row_mask;
-      }
-    }
-  }
-
-  //*****************************************
-  
-  if (yStep > 0) { // scroll up
-    if (yStep > this->yMax - this->yMin +1 ) {
-      yStep = this->yMax - this->yMin +1;
-    }
-    int row = this->yMin >> 3;
-    int row_part = this->yMin & 0x7;
-    int last_row = this->yMax >> 3;
-    int last_row_part = this->yMax & 0x7;
-    int yStep_row = yStep >> 3;
-    int yStep_part = yStep & 7;
-    uint8_t row_mask = 0xFF << row_part;
-    if (last_row == row) {
-      row_mask &= 0xFF >> (7 - last_row_part);
-    }
-    for (int i = this->xMin; i <= this->xMax; i++) {
-      uint8_t new_val  = srn_display_pixels[row+yStep_row  ][i] >> yStep_part;
-      if (row+yStep_row+1 < 16)
-	      new_val |= srn_display_pixels[row+yStep_row+1][i] << (8 - yStep_part);
-      srn_display_pixels[row][i] &= ~row_mask;
-      srn_display_pixels[row][i] |= new_val & row_mask;
-    }
-    row += 1;
-    for (; row < last_row - yStep_row; row++) {
-      for (int i = this->xMin; i <= this->xMax; i++) {
-      	uint8_t new_val  = srn_display_pixels[row+yStep_row  ][i] >> yStep_part;
-      	if (row+yStep_row+1 < 16)
-	        new_val |= srn_display_pixels[row+yStep_row+1][i] << (8 - yStep_part);
-	      srn_display_pixels[row][i] = new_val;
-      }
-    }
-    if (row == last_row - yStep_row) {
-      row_mask = 0xFF >> (7 - last_row_part);
-      for (int i = this->xMin; i <= this->xMax; i++) {
-        uint8_t new_val =  srn_display_pixels[row+yStep_row  ][i] >> yStep_part;
-        if (row+yStep_row+1 < 16)
-	        new_val |= srn_display_pixels[row+yStep_row+1][i] << (8 - yStep_part);
-	      srn_display_pixels[row][i] &= ~row_mask;
-	      srn_display_pixels[row][i] |= new_val & row_mask;
-      }
-    }
-    clear_display(this->xMin, this->yMax - yStep + 1, this->xMax, this->yMax);
-  }  
-
-  //*****************************************  
-
-  if (xStep < 0) { // shift pixels left
-    int row_part = this->yMin & 0x7;
-    int row = this->yMin >> 3;
-    int last_row = this->yMax >> 3;
-    int last_row_part = this->yMax & 0x7;
-    if (row == last_row || row_part != 0) {// top &  possible partial row
-      uint8_t row_mask = 0xFF << row_part;
-      if (row == last_row) {
-	row_mask &= 0xFF >> (7 - last_row_part);
-      }
-      for (int i = this->xMax; i >= this->xMin - xStep; i--) {
-	      srn_display_pixels[row][i] &= ~row_mask;
-	      srn_display_pixels[row][i] |= srn_display_pixels[row][i+xStep] & row_mask; 
-      }
-      for (int i = this->xMin - xStep - 1; i >= this->xMin; i--) {
-      	srn_display_pixels[row][i] &= ~row_mask;
-      }
-      row += 1;
-    }
-    for (; row < last_row; row++) { // full rows
-      for (int i = this->xMax; i >= this->xMin - xStep; i--) {
-	      srn_display_pixels[row][i] = srn_display_pixels[row][i+xStep]; 
-      }
-      for (int i = this->xMin - xStep - 1; i >= this->xMin; i--) {
-	      srn_display_pixels[row][i] = 0;
-      }
-    }
-    if (row == last_row) {// bottom partial row
-      uint8_t row_mask = 0xFF >> (7 - last_row_part);
-      for (int i = this->xMax; i >= this->xMin - xStep; i--) {
-	      srn_display_pixels[row][i] &= ~row_mask;
-	      srn_display_pixels[row][i] |= srn_display_pixels[row][i+xStep] & row_mask; 
-      }
-      for (int i = this->xMin - xStep - 1; i >= this->xMin; i--) {
-	      srn_display_pixels[row][i] &= ~row_mask;
-      }
-    }
+  SRN_PERF_TIME(SRN_PERF_SCROLL);
+  // a whole screen scroll by full pages moves the display start line
+  if (xStep == 0 && (yStep & 7) == 0 &&
+      this->xMin == 0 && this->yMin == 0 &&
+      this->xMax == 127 && this->yMax == 127 &&
+      srn_hw_scroll_pages(yStep >> 3)) return;
+  if (xStep == 0 && yStep == 0) return;
+  int width = this->xMax - this->xMin + 1;
+  int height = this->yMax - this->yMin + 1;
+  if (xStep > width) xStep = width;
+  if (xStep < -width) xStep = -width;
+  if (yStep > height) yStep = height;
+  if (yStep < -height) yStep = -height;
+  // the part that stays in the region moves onto itself
+  screen_region_t src = *this;
+  if (xStep > 0) src.xMin += xStep;
+  else src.xMax += xStep;
+  if (yStep > 0) src.yMin += yStep;
+  else src.yMax += yStep;
+  srn_bitmap_t screen;
+  srn_screen_bitmap(&screen);
+  if (src.xMin <= src.xMax && src.yMin <= src.yMax) {
+    bitblt(&screen, &src, &screen, src.xMin - xStep, src.yMin - yStep, SRN_ROP_COPY);
   }
-
-  //*****************************************
-  
-  if (yStep < 0) { // scroll down
-    yStep = -yStep;
-    if (yStep > this->yMax - this->yMin +1 ) {
-      yStep = this->yMax - this->yMin +1;
-    }
-    int row = this->yMax >> 3;
-    int row_part = this->yMax & 0x7;
-    int last_row = this->yMin >> 3;
-    int last_row_part = this->yMin & 0x7;
-    int yStep_row = yStep >> 3;
-    int yStep_part = yStep & 7;
-    uint8_t row_mask = 0xFF >> (7 - row_part);
-    if (last_row == row) {
-      row_mask &= 0xFF << last_row_part;
-    }
-    for (int i = this->xMin; i <= this->xMax; i++) {
-      uint8_t new_val  = srn_display_pixels[row-yStep_row  ][i] << yStep_part;
-      if (row+yStep_row > 0)
-	      new_val |= srn_display_pixels[row-yStep_row-1][i] >> (8 - yStep_part);
-      srn_display_pixels[row][i] &= ~row_mask;
-      srn_display_pixels[row][i] |= new_val & row_mask;
-    }
-    row -= 1;
-    for (; row > last_row + yStep_row; row--) {
-      for (int i = this->xMin; i <= this->xMax; i++) {
-	      uint8_t new_val  = srn_display_pixels[row-yStep_row  ][i] << yStep_part;
-	    if (row+yStep_row > 0)
-	        new_val |= srn_display_pixels[row-yStep_row-1][i] >> (8 - yStep_part);
-	    srn_display_pixels[row][i] = new_val;
-      }
-    }
-    if (row == last_row - yStep_row) {
-      row_mask = 0xFF << last_row_part;
-      for (int i = this->xMin; i <= this->xMax; i++) {
-      uint8_t new_val  = srn_display_pixels[row-yStep_row  ][i] << yStep_part;
-      if (row+yStep_row > 0)
-	      new_val |= srn_display_pixels[row-yStep_row-1][i] >> (8 - yStep_part);
-	    srn_display_pixels[row][i] &= ~row_mask;
-	    srn_display_pixels[row][i] |= new_val & row_mask;
-      }
-    }
-    clear_display(this->xMin, this->yMin, this->xMax, this->yMin + yStep - 1);
-  }  
-    
+  // and the columns and rows it leaves are cleared
+  if (xStep > 0) clear_display(this->xMax - xStep + 1, this->yMin, this->xMax, this->yMax);
+  if (xStep < 0) clear_display(this->xMin, this->yMin, this->xMin - xStep - 1, this->yMax);
+  if (yStep > 0) clear_display(this->xMin, this->yMax - yStep + 1, this->xMax, this->yMax);
+  if (yStep < 0) clear_display(this->xMin, this->yMin, this->xMax, this->yMin - yStep - 1);
 }
-
@@ -24,6 +24,9 @@ bool set_screen_region(screen_region_t *this, int xmin, int ymin, int xmax, int
 bool clear_screen_region(screen_region_t *this);
 void scroll_screen_region(screen_region_t *this, int xStep, int yStep);
 
+// inverts every pixel of the region, for example to highlight a menu line
+void invert_screen_region(screen_region_t *this);
+
 static inline bool put_pixel(screen_region_t *this, int x, int y, int b) {
   if (x < this->xMin || y < this->yMin ||
       x > this->xMax || y > this->yMax ) return false;
@@ -31,4 +34,41 @@ static inline bool put_pixel(screen_region_t *this, int x, int y, int b) {
   return true;
 }
 
+// Sets bounds to clip limited to the display, or to the whole display if
+// clip is NULL.  Empty if clip is outside the display.
+static inline void srn_clip_bounds(const screen_region_t *clip, screen_region_t *bounds) {
+  bounds->xMin = 0;
+  bounds->yMin = 0;
+  bounds->xMax = 127;
+  bounds->yMax = 127;
+  if (clip == NULL) return;
+  if (clip->xMin > bounds->xMin) bounds->xMin = clip->xMin;
+  if (clip->yMin > bounds->yMin) bounds->yMin = clip->yMin;
+  if (clip->xMax < bounds->xMax) bounds->xMax = clip->xMax;
+  if (clip->yMax < bounds->yMax) bounds->yMax = clip->yMax;
+}
+
+// SPANS
+// The span functions set (b != 0) or clear (b == 0) a run of pixels a page
+// byte at a time.  They clip to the display and mark the span dirty once,
+// so shapes that are clipped to their screen region up front can be filled
+// without a check per pixel.
+
+// pixels x, y0 to y1 inclusive: whole page bytes with head and tail masks
+void fill_vspan(int x, int y0, int y1, int b);
+
+// pixels x0 to x1 inclusive on row y: one bit mask over a run of bytes
+void fill_hspan(int y, int x0, int x1, int b);
+
+// the rectangle x0, y0 to x1, y1 inclusive
+void fill_rect(int x0, int y0, int x1, int y1, int b);
+
+// Writes one pixel with no bounds check and without marking it dirty.  For
+// use after the caller has clipped a shape and called srn_mark_dirty_rect().
+static inline void put_pixel_unchecked(int x, int y, int b) {
+  uint8_t *p = &SRN_PAGE_BYTE(y >> 3, x);
+  if (b) *p |= 1 << (y & 7);
+  else *p &= ~(1 << (y & 7));
+}
+
 #endif
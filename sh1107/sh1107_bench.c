@@ -0,0 +1,493 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "sh1107_port.h"
+#include "sh1107_transport.h"
+#include "pixel_ops.h"
+#include "draw_char.h"
+#include "draw_graphics.h"
+#include "strip_chart.h"
+#include "srn_fonts.h"
+#include "draw_sprite.h"
+#include "srn_pages.h"
+#include "srn_mirror.h"
+#include "srn_perf.h"
+#ifdef SH1107_HOST
+#include "sh1107_sim.h"
+#endif
+
+/* sh1107_bench.c
+ * Benchmarks for the drawing hot paths.  Every case does its drawing
+ * operation followed by srn_refresh(), so the time spent in the transport
+ * can be separated from the time spent on the pixel buffer.  The bench
+ * wraps the real transport with one that times each write.
+ *
+ * On a host the transport is the SH1107 simulator, so the fb column is the
+ * cost of the drawing code on the host CPU and the wire column is the time
+ * the simulator estimates the bytes would take at BENCH_BAUD.  On the
+ * device the spi column is the measured time in the SPI transport.
+ *
+ * The results are printed as CSV, one line per case after a header line
+ * starting with "bench,", so runs can be compared between releases:
+ *   bench,case,iterations,ns_per_op,fb_ns_per_op,spi_ns_per_op,wire_ns_per_op
+ */
+
+#ifndef BENCH_ITERATIONS
+#ifdef SH1107_HOST
+#define BENCH_ITERATIONS 20000
+#else
+#define BENCH_ITERATIONS 200
+#endif
+#endif
+
+#ifndef BENCH_BAUD
+#define BENCH_BAUD (1000 * 1000)
+#endif
+
+// TIMED TRANSPORT
+// Passes everything on to the real transport and adds up the time spent.
+
+static srn_transport_t *inner;
+static uint64_t spi_ns;
+
+static void timed_write(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  uint64_t t = srn_time_ns();
+  inner->write(inner->ctx, buf, num, cmd);
+  spi_ns += srn_time_ns() - t;
+}
+
+static void timed_start_write(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  uint64_t t = srn_time_ns();
+  inner->start_write(inner->ctx, buf, num, cmd);
+  spi_ns += srn_time_ns() - t;
+}
+
+// a stream is timed until the whole frame is on the wire
+static void timed_start_stream(void *ctx, const uint8_t *stream, int num) {
+  uint64_t t = srn_time_ns();
+  inner->start_stream(inner->ctx, stream, num);
+  srn_refresh_wait();
+  spi_ns += srn_time_ns() - t;
+}
+
+static srn_transport_t timed_transport = {
+  .write = timed_write,
+  .start_write = timed_start_write,
+  .ctx = NULL,
+};
+
+#ifdef SH1107_HOST
+static sh1107_sim_t sim;
+#endif
+
+static uint64_t wire_ns() {
+#ifdef SH1107_HOST
+  return sim.wire_ns;
+#else
+  return 0;
+#endif
+}
+
+// CASES
+// Each case has a setup run once and an operation run BENCH_ITERATIONS
+// times.  The parameters are kept in the globals below.
+
+static screen_region_t sr;
+static char_screen_region_t csr;
+static graph_screen_region_t gsr;
+static int step_x, step_y;
+static float line_dx, line_dy;
+static float sample;
+
+static void fill_random() {
+  for (int r = 0; r < 16; r++) {
+    for (int c = 0; c < 128; c++) {
+      SRN_PAGE_BYTE(r, c) = rand();
+    }
+  }
+  srn_refresh_full();
+}
+
+static void setup_aligned() {
+  fill_random();
+  set_screen_region(&sr, 0, 0, 127, 63);
+}
+
+static void setup_unaligned() {
+  fill_random();
+  set_screen_region(&sr, 5, 3, 122, 60);
+}
+
+static void op_scroll() {
+  scroll_screen_region(&sr, step_x, step_y);
+  srn_refresh();
+}
+
+static void op_clear() {
+  // put something back so every clear has work to do
+  SRN_PAGE_BYTE(sr.yMin >> 3, sr.xMin) = 0xFF;
+  clear_screen_region(&sr);
+  srn_refresh();
+}
+
+static void setup_line() {
+  srn_fast_clear();
+  map_window(&gsr, -1.0, 1.0, 1.0, -1.0, 0, 0, 127, 127);
+}
+
+static void op_line() {
+  draw_line(&gsr, -line_dx, -line_dy, line_dx, line_dy);
+  srn_refresh();
+}
+
+static void op_line_q() {
+  srn_fix_t dx = SRN_FLOAT_TO_FIX(line_dx);
+  srn_fix_t dy = SRN_FLOAT_TO_FIX(line_dy);
+  draw_line_q(&gsr, -dx, -dy, dx, dy);
+  srn_refresh();
+}
+
+static void setup_full_graph() {
+  srn_fast_clear();
+  map_autoscroll_bar_window(&gsr, 1.0, -1.0, 0, 0, 127, 63);
+}
+
+static void setup_partial_graph() {
+  srn_fast_clear();
+  map_autoscroll_bar_window(&gsr, 1.0, -1.0, 32, 0, 95, 63);
+}
+
+// a mirror at every refresh, with the frames thrown away, for the cost of
+// the encoding
+static srn_mirror_t mirror;
+
+static int discard_write(void *ctx, const uint8_t *buf, int num) {
+  return num;
+}
+
+static void setup_mirrored_graph() {
+  setup_full_graph();
+  srn_mirror_start(&mirror, srn_display, discard_write, NULL, 0);
+}
+
+// the same samples as op_graph_line() on a strip chart over the same region
+static srn_strip_chart_t chart;
+
+static void setup_strip_sweep() {
+  srn_fast_clear();
+  srn_strip_init(&chart, 0, 0, 127, 63, SRN_STRIP_SWEEP, SRN_STRIP_LINE);
+  srn_strip_set_range(&chart, -1.0, 1.0);
+}
+
+static void setup_strip_scroll() {
+  srn_fast_clear();
+  srn_strip_init(&chart, 0, 0, 127, 63, SRN_STRIP_SCROLL, SRN_STRIP_LINE);
+  srn_strip_set_range(&chart, -1.0, 1.0);
+}
+
+static void op_strip() {
+  sample = sample > 0.9 ? -1.0 : sample + 0.05;
+  srn_strip_add(&chart, sample);
+  srn_strip_present(&chart);
+  srn_refresh();
+}
+
+static void op_bar() {
+  sample = sample > 0.9 ? -1.0 : sample + 0.05;
+  draw_next_as_bar(&gsr, sample);
+  srn_refresh();
+}
+
+static void op_graph_line() {
+  sample = sample > 0.9 ? -1.0 : sample + 0.05;
+  draw_next_as_line(&gsr, sample);
+  srn_refresh();
+}
+
+static void op_bar_q() {
+  sample = sample > 0.9 ? -1.0 : sample + 0.05;
+  draw_next_as_bar_q(&gsr, SRN_FLOAT_TO_FIX(sample));
+  srn_refresh();
+}
+
+static void op_graph_line_q() {
+  sample = sample > 0.9 ? -1.0 : sample + 0.05;
+  draw_next_as_line_q(&gsr, SRN_FLOAT_TO_FIX(sample));
+  srn_refresh();
+}
+
+static void setup_text() {
+  srn_fast_clear();
+  init_char_screen_region(&csr, 0, 8, 15, 15);
+}
+
+static void op_write_char() {
+  // stay on the first line so there is never a scroll
+  if (csr.ccol > csr.ccol_rgt) start_char_at(&csr, 0, 0);
+  write_char_next(&csr, 'A' + (csr.ccol & 0xF));
+  srn_refresh();
+}
+
+static void op_draw_text() {
+  // pixel positioned, so every glyph column is split across two pages
+  draw_text(&srn_font8x8_prop, &csr.sr, 3, 69, "value 0.1234");
+  srn_refresh();
+}
+
+static void setup_digits() {
+  srn_fast_clear();
+  init_char_screen_region(&csr, 0, 8, 15, 10);
+  set_char_font(&csr, &srn_font8x8_3x_digits);
+}
+
+static uint16_t shadow[16 * 16];
+
+static void setup_text_shadow() {
+  setup_text();
+  set_char_shadow(&csr, shadow, 16 * 16);
+}
+
+static void setup_digits_shadow() {
+  setup_digits();
+  set_char_shadow(&csr, shadow, 16 * 16);
+}
+
+static void op_print_digits() {
+  // a large readout redrawn in place
+  start_char_at(&csr, 0, 0);
+  srn_print(&csr, "-12.34");
+}
+
+static void op_readout() {
+  // five cells fit the region, only the last digit changes
+  static char text[] = "-12.3";
+  text[4] = text[4] == '9' ? '0' : text[4] + 1;
+  start_char_at(&csr, 0, 0);
+  srn_print(&csr, text);
+}
+
+static void op_sprintf_value() {
+  char val_str[16];
+  sample = sample > 0.9 ? -1.0 : sample + 0.05;
+  start_char_at(&csr, 0, 0);
+  sprintf(val_str, "% 6.4f", sample);
+  srn_print(&csr, val_str);
+}
+
+static void op_print_value() {
+  sample = sample > 0.9 ? -1.0 : sample + 0.05;
+  start_char_at(&csr, 0, 0);
+  srn_print_float(&csr, sample, 4, 6, SRN_FMT_SPACE);
+}
+
+static void op_print_scroll() {
+  srn_print(&csr, "\nvalue 0.1234");
+}
+
+static srn_sprite_at_t icons[12];
+
+static void setup_sprites() {
+  fill_random();
+  const srn_sprite_t *kinds[] = {&srn_icon_battery, &srn_icon_link, &srn_icon_warning};
+  for (int i = 0; i < 12; i++) {
+    icons[i].sprite = kinds[i % 3];
+    icons[i].x = i * 10;
+    icons[i].y = i * 3;
+  }
+  set_screen_region(&sr, 0, 0, 127, 127);
+}
+
+static void op_sprites() {
+  // a dozen icons each moved down a row, so every shift is drawn
+  for (int i = 0; i < 12; i++) {
+    icons[i].y = icons[i].y >= 119 ? 0 : icons[i].y + 1;
+  }
+  draw_sprites(icons, 12, NULL);
+  srn_refresh();
+}
+
+static void op_put_pixel_icons() {
+  // the same icons drawn a pixel at a time, for comparison
+  for (int i = 0; i < 12; i++) {
+    icons[i].y = icons[i].y >= 119 ? 0 : icons[i].y + 1;
+    const srn_sprite_t *s = icons[i].sprite;
+    for (int c = 0; c < s->width; c++) {
+      for (int r = 0; r < s->height; r++) {
+        put_pixel(&sr, icons[i].x + c, icons[i].y + r, (s->image[(r >> 3) * s->width + c] >> (r & 7)) & 1);
+      }
+    }
+  }
+  srn_refresh();
+}
+
+// a status screen redrawn in full, from a display list a page at a time
+// and through the pixel buffer
+static srn_pages_t pages;
+static char status_value[8];
+static const srn_item_t status_screen[] = {
+  SRN_RECT(0, 0, 127, 11, SRN_ROP_SET),
+  SRN_TEXT(2, 2, &srn_font8x8_prop, "Status"),
+  SRN_SPRITE(104, 2, &srn_icon_battery),
+  SRN_SPRITE(116, 2, &srn_icon_link),
+  SRN_TEXT(8, 40, &srn_font8x8, status_value),
+  SRN_LINE(0, 127, 127, 64, SRN_ROP_SET),
+  SRN_RECT(0, 100, 63, 107, SRN_ROP_INVERT),
+};
+
+static void setup_status() {
+  srn_fast_clear();
+  srn_pages_init(&pages, srn_display);
+  strcpy(status_value, "0");
+}
+
+static void next_status_value() {
+  status_value[0] = status_value[0] == '9' ? '0' : status_value[0] + 1;
+}
+
+static void op_status_pages() {
+  next_status_value();
+  srn_pages_render(&pages, status_screen, sizeof(status_screen) / sizeof(status_screen[0]));
+  srn_refresh_wait();
+}
+
+static void op_status_pixels() {
+  next_status_value();
+  fill_rect(0, 0, 127, 127, 0);
+  fill_rect(0, 0, 127, 11, 1);
+  draw_text(&srn_font8x8_prop, NULL, 2, 2, "Status");
+  draw_sprite(&srn_icon_battery, NULL, 104, 2);
+  draw_sprite(&srn_icon_link, NULL, 116, 2);
+  draw_text(&srn_font8x8, NULL, 8, 40, status_value);
+  for (int x = 0; x <= 127; x++) {
+    int y = 127 - (x * 63 + 63) / 127;
+    put_pixel_unchecked(x, y, 1);
+  }
+  screen_region_t bar = {0, 100, 63, 107};
+  invert_screen_region(&bar);
+  srn_refresh();
+}
+
+typedef struct bench_case {
+  const char *name;
+  void (*setup)();
+  void (*op)();
+  int x, y;         // scroll steps
+  float dx, dy;     // line half extents
+} bench_case_t;
+
+static const bench_case_t cases[] = {
+  {"scroll_left_aligned_1",    setup_aligned,   op_scroll,  1,  0},
+  {"scroll_left_aligned_3",    setup_aligned,   op_scroll,  3,  0},
+  {"scroll_left_aligned_8",    setup_aligned,   op_scroll,  8,  0},
+  {"scroll_left_unaligned_1",  setup_unaligned, op_scroll,  1,  0},
+  {"scroll_left_unaligned_3",  setup_unaligned, op_scroll,  3,  0},
+  {"scroll_left_unaligned_8",  setup_unaligned, op_scroll,  8,  0},
+  {"scroll_right_aligned_1",   setup_aligned,   op_scroll, -1,  0},
+  {"scroll_right_aligned_3",   setup_aligned,   op_scroll, -3,  0},
+  {"scroll_right_aligned_8",   setup_aligned,   op_scroll, -8,  0},
+  {"scroll_right_unaligned_1", setup_unaligned, op_scroll, -1,  0},
+  {"scroll_right_unaligned_3", setup_unaligned, op_scroll, -3,  0},
+  {"scroll_right_unaligned_8", setup_unaligned, op_scroll, -8,  0},
+  {"scroll_up_aligned_1",      setup_aligned,   op_scroll,  0,  1},
+  {"scroll_up_aligned_3",      setup_aligned,   op_scroll,  0,  3},
+  {"scroll_up_aligned_8",      setup_aligned,   op_scroll,  0,  8},
+  {"scroll_up_unaligned_1",    setup_unaligned, op_scroll,  0,  1},
+  {"scroll_up_unaligned_3",    setup_unaligned, op_scroll,  0,  3},
+  {"scroll_up_unaligned_8",    setup_unaligned, op_scroll,  0,  8},
+  {"scroll_down_aligned_1",    setup_aligned,   op_scroll,  0, -1},
+  {"scroll_down_aligned_3",    setup_aligned,   op_scroll,  0, -3},
+  {"scroll_down_aligned_8",    setup_aligned,   op_scroll,  0, -8},
+  {"scroll_down_unaligned_1",  setup_unaligned, op_scroll,  0, -1},
+  {"scroll_down_unaligned_3",  setup_unaligned, op_scroll,  0, -3},
+  {"scroll_down_unaligned_8",  setup_unaligned, op_scroll,  0, -8},
+  {"clear_aligned",            setup_aligned,   op_clear},
+  {"clear_unaligned",          setup_unaligned, op_clear},
+  {"line_horizontal",          setup_line,      op_line, 0, 0, 0.9, 0.0},
+  {"line_shallow",             setup_line,      op_line, 0, 0, 0.9, 0.3},
+  {"line_diagonal",            setup_line,      op_line, 0, 0, 0.9, 0.9},
+  {"line_steep",               setup_line,      op_line, 0, 0, 0.3, 0.9},
+  {"line_vertical",            setup_line,      op_line, 0, 0, 0.0, 0.9},
+  {"line_diagonal_q",          setup_line,      op_line_q, 0, 0, 0.9, 0.9},
+  {"bar_full_width",           setup_full_graph,    op_bar},
+  {"bar_partial_width",        setup_partial_graph, op_bar},
+  {"graph_line_full_width",    setup_full_graph,    op_graph_line},
+  {"graph_line_partial_width", setup_partial_graph, op_graph_line},
+  {"bar_full_width_q",         setup_full_graph,    op_bar_q},
+  {"graph_line_full_width_q",  setup_full_graph,    op_graph_line_q},
+  {"strip_chart_sweep",        setup_strip_sweep,  op_strip},
+  {"strip_chart_scroll",       setup_strip_scroll, op_strip},
+  {"graph_line_mirrored",      setup_mirrored_graph, op_graph_line},
+  {"write_char_next",          setup_text,      op_write_char},
+  {"draw_text_prop",           setup_text,      op_draw_text},
+  {"print_3x_digits",          setup_digits,    op_print_digits},
+  {"srn_print_scroll",         setup_text,      op_print_scroll},
+  {"sprintf_value",            setup_text,      op_sprintf_value},
+  {"srn_print_float",          setup_text,      op_print_value},
+  {"readout_3x",               setup_digits,    op_readout},
+  {"readout_3x_shadow",        setup_digits_shadow, op_readout},
+  {"srn_print_scroll_shadow",  setup_text_shadow, op_print_scroll},
+  {"sprites_12",               setup_sprites,   op_sprites},
+  {"put_pixel_icons_12",       setup_sprites,   op_put_pixel_icons},
+  {"status_screen_pages",      setup_status,    op_status_pages},
+  {"status_screen_pixels",     setup_status,    op_status_pixels},
+};
+
+static void run_case(const bench_case_t *c) {
+  step_x = c->x;
+  step_y = c->y;
+  line_dx = c->dx;
+  line_dy = c->dy;
+  sample = 0.0;
+  c->setup();
+  spi_ns = 0;
+  uint64_t wire_start = wire_ns();
+  uint64_t t = srn_time_ns();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    c->op();
+  }
+  uint64_t total = srn_time_ns() - t;
+  uint64_t wire = wire_ns() - wire_start;
+  if (srn_display->mirror) srn_mirror_stop(srn_display->mirror);
+  printf("bench,%s,%d,%llu,%llu,%llu,%llu\n", c->name, BENCH_ITERATIONS,
+         (unsigned long long)(total / BENCH_ITERATIONS),
+         (unsigned long long)((total - spi_ns) / BENCH_ITERATIONS),
+         (unsigned long long)(spi_ns / BENCH_ITERATIONS),
+         (unsigned long long)(wire / BENCH_ITERATIONS));
+}
+
+static void run_all() {
+  inner = srn_get_transport();
+  timed_transport.start_stream = inner->start_stream ? timed_start_stream : NULL;
+  srn_set_transport(&timed_transport);
+  printf("bench,case,iterations,ns_per_op,fb_ns_per_op,spi_ns_per_op,wire_ns_per_op\n");
+  srn_perf_reset();
+  for (int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    run_case(&cases[i]);
+  }
+  // the counters of all the cases together, with SRN_PERF
+  srn_perf_print();
+  srn_set_transport(inner);
+}
+
+int main() {
+#ifdef SH1107_HOST
+  sh1107_sim_init(&sim, BENCH_BAUD);
+  srn_set_transport(sh1107_sim_transport(&sim));
+  run_all();
+#else
+  stdio_init_all();
+  init_sh1107_SPI();
+  while (1) {
+    // give the USB serial port time to be opened
+    sleep_ms(5000);
+    run_all();
+  }
+#endif
+  return 0;
+}
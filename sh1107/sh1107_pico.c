@@ -0,0 +1,269 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "pico/binary_info.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "sh1107_spi.h"
+#include "sh1107_transport.h"
+#include "sh1107_pico.h"
+#include "srn_stream.h"
+#include "srn_bus.h"
+
+/*  SPI transport to a sh1107 display controler for pimoroni 1.2" 128x128 monochrome display.
+
+
+   GPIO 0 (pin 12) D/C
+   GPIO 1 (pin 15) Chip select -> CSB/!CS on bme280 board
+   GPIO 2 (pin 14) SCK/spi0_sclk -> SCL/SCK on bme280 board
+   GPIO 3 (pin 13) MOSI/spi0_tx -> MOSI on SH1107
+
+   Note: The SPI0 on the Tiny2040 defined GPIO 0 as the RX pin.  But
+   the SH1107 display controller does not have an MISO pin that would
+   normally be connected to the RX pin.  So that pin is repurposed to
+   be the D/C pin required by the SH1107.
+
+*/
+
+// The tiny2040 SPI0 pins are in SH1107_TINY2040_SPI_CONFIG (sh1107_pico.h).
+// Other wiring is passed to sh1107_spi_init().
+
+// the turns of the transports on each SPI port.  A transfer holds its
+// port until the SPI has sent the last byte.
+static srn_bus_t port_bus[2];
+
+static inline srn_bus_t *bus_of(sh1107_spi_t *this) {
+  return &port_bus[spi_get_index(this->config.spi)];
+}
+
+// the next 5 functions are low lever SPI operations that
+// are used to write commands or data to the SH1107
+
+static inline void cs_select(sh1107_spi_t *this) {
+  asm volatile("nop \n nop \n nop");
+  gpio_put(this->config.cs_pin, 0);  // Active low
+  asm volatile("nop \n nop \n nop");
+}
+
+static inline void cs_deselect(sh1107_spi_t *this) {
+  asm volatile("nop \n nop \n nop");
+  gpio_put(this->config.cs_pin, 1);
+  asm volatile("nop \n nop \n nop");
+}
+
+static inline void cmd_select(sh1107_spi_t *this) {
+  asm volatile("nop \n nop \n nop");
+  gpio_put(this->config.dc_pin, 0);  // CMD = 1
+  asm volatile("nop \n nop \n nop");
+}
+
+static inline void data_select(sh1107_spi_t *this) {
+  asm volatile("nop \n nop \n nop");
+  gpio_put(this->config.dc_pin, 1); // DATA = 0
+  asm volatile("nop \n nop \n nop");
+}
+
+static void write_blocking(sh1107_spi_t *this, const uint8_t *buf, int num, bool data_cmd) {
+  if (data_cmd) cmd_select(this); else data_select(this);
+  cs_select(this);
+  spi_write_blocking(this->config.spi, buf, num);
+  cs_deselect(this);
+  //sleep_ms(1);
+}
+
+// Waits for another panel on the same port to finish sending, which is
+// only done outside interrupt handlers.
+static void write_spi(void *ctx, const uint8_t *buf, int num, bool data_cmd) {
+  sh1107_spi_t *this = (sh1107_spi_t *)ctx;
+  while (!srn_bus_try_claim(bus_of(this), &this->client)) {
+    tight_loop_contents();
+  }
+  write_blocking(this, buf, num, data_cmd);
+  srn_bus_release(bus_of(this));
+}
+
+// DMA
+// Every segment of a stream, and every start_write, goes by a DMA channel
+// paced by the SPI TX DREQ.  The channel finishes while the last bytes are
+// still in the SPI FIFO, and D/C and CS can only change once the SPI is
+// idle.  Rather than wait for that in the interrupt handler, it sets an
+// alarm for when the FIFO will have drained, which looks again a byte
+// later if the SPI is still busy.  The alarm then starts the next segment
+// with CS still low, or releases CS and the port and tells the driver.
+// One shared handler serves the channels of every transport.
+//
+// A start_write or start_stream that finds the port held by another panel
+// is queued on the port (see srn_bus.h) and started when that transfer
+// finishes, so nothing waits for the port in an interrupt handler or the
+// alarm, from where sh1107_transfer_done() may start the next transfer.
+
+static sh1107_spi_t *dma_transports[SH1107_SPI_MAX];
+static int num_dma_transports;
+
+static void start_dma(sh1107_spi_t *this, const uint8_t *buf, int num, bool data_cmd) {
+  if (data_cmd) cmd_select(this); else data_select(this);
+  this->num = num;
+  dma_channel_set_read_addr(this->dma_chan, buf, false);
+  dma_channel_set_trans_count(this->dma_chan, num, true);
+}
+
+static void finish(sh1107_spi_t *this) {
+  cs_deselect(this);
+  srn_bus_release(bus_of(this));
+  sh1107_transfer_done(this->transport.display);
+}
+
+// Starts the DMA for the segment at the head of the stream.  At the frame
+// end it releases CS and the port.
+static void next_stream_segment(sh1107_spi_t *this) {
+  bool data;
+  int num = srn_stream_segment(this->stream, &data);
+  if (num < 0) {
+    this->stream = NULL;
+    finish(this);
+    return;
+  }
+  const uint8_t *buf = this->stream + SRN_STREAM_HEADER;
+  this->stream = buf + num;
+  start_dma(this, buf, num, !data);
+}
+
+static int64_t spi_drained(alarm_id_t id, void *ctx) {
+  sh1107_spi_t *this = (sh1107_spi_t *)ctx;
+  spi_inst_t *spi = this->config.spi;
+  if (spi_is_busy(spi)) return -(int64_t)this->byte_us;
+  // the RX FIFO filled up with junk while the DMA was running.
+  while (spi_is_readable(spi)) {
+    (void)spi_get_hw(spi)->dr;
+  }
+  spi_get_hw(spi)->icr = SPI_SSPICR_RORIC_BITS;
+  if (this->stream != NULL) {
+    next_stream_segment(this);
+  } else {
+    finish(this);
+  }
+  return 0;
+}
+
+static void dma_done(sh1107_spi_t *this) {
+  dma_channel_acknowledge_irq0(this->dma_chan);
+  // the 8 byte FIFO and the byte being shifted out, or all of a shorter
+  // segment
+  int fifo_bytes = this->num < 9 ? this->num : 9;
+  alarm_id_t alarm = add_alarm_in_us(fifo_bytes * this->byte_us, spi_drained, this, true);
+  hard_assert(alarm >= 0);
+}
+
+static void dma_irq_handler() {
+  for (int i = 0; i < num_dma_transports; i++) {
+    if (dma_channel_get_irq0_status(dma_transports[i]->dma_chan)) dma_done(dma_transports[i]);
+  }
+}
+
+// called by the port once this holds it
+static void start_transfer(srn_bus_client_t *client) {
+  sh1107_spi_t *this = (sh1107_spi_t *)client->ctx;
+  cs_select(this);
+  if (this->stream != NULL) {
+    next_stream_segment(this);
+  } else {
+    start_dma(this, this->write_buf, this->num, this->write_cmd);
+  }
+}
+
+static void start_write_spi(void *ctx, const uint8_t *buf, int num, bool data_cmd) {
+  sh1107_spi_t *this = (sh1107_spi_t *)ctx;
+  this->stream = NULL;
+  this->write_buf = buf;
+  this->num = num;
+  this->write_cmd = data_cmd;
+  srn_bus_start(bus_of(this), &this->client);
+}
+
+static void start_stream_spi(void *ctx, const uint8_t *stream, int num) {
+  sh1107_spi_t *this = (sh1107_spi_t *)ctx;
+  this->stream = stream;
+  srn_bus_start(bus_of(this), &this->client);
+}
+
+static void init_spi_dma(sh1107_spi_t *this) {
+  this->dma_chan = dma_claim_unused_channel(true);
+  dma_channel_config c = dma_channel_get_default_config(this->dma_chan);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, spi_get_dreq(this->config.spi, true));
+  dma_channel_configure(this->dma_chan, &c, &spi_get_hw(this->config.spi)->dr,
+                        NULL, 0, false);
+  dma_channel_set_irq0_enabled(this->dma_chan, true);
+  if (num_dma_transports == 0) {
+    srn_bus_init(&port_bus[0]);
+    srn_bus_init(&port_bus[1]);
+    irq_add_shared_handler(DMA_IRQ_0, dma_irq_handler,
+                           PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+  }
+  dma_transports[num_dma_transports++] = this;
+}
+
+void sh1107_spi_init(sh1107_spi_t *this, sh1107_t *display, const sh1107_spi_config_t *config) {
+  hard_assert(num_dma_transports < SH1107_SPI_MAX);
+  this->config = *config;
+  uint baud = spi_init(config->spi, config->baud);
+  this->byte_us = (8 * 1000 * 1000 + baud - 1) / baud;
+  gpio_set_function(config->sck_pin, GPIO_FUNC_SPI);
+  gpio_set_function(config->tx_pin, GPIO_FUNC_SPI);
+
+  // Chip select is active-low, so we'll initialise it to a driven-high state
+  gpio_init(config->cs_pin);
+  gpio_set_dir(config->cs_pin, GPIO_OUT);
+  gpio_put(config->cs_pin, 1);
+  gpio_init(config->dc_pin);
+  gpio_set_dir(config->dc_pin, GPIO_OUT);
+  gpio_put(config->dc_pin, 1);
+
+  this->stream = NULL;
+  this->client.start = start_transfer;
+  this->client.ctx = this;
+  init_spi_dma(this);
+  this->transport.write = write_spi;
+  this->transport.start_write = start_write_spi;
+  this->transport.start_stream = start_stream_spi;
+  this->transport.ctx = this;
+  sh1107_set_transport(display, &this->transport);
+}
+
+// inits the SPI interface and clears the display
+void init_sh1107_SPI() {
+  static sh1107_spi_t tiny2040_spi;
+  const sh1107_spi_config_t tiny2040_config = SH1107_TINY2040_SPI_CONFIG;
+  // Make the SPI pins available to picotool
+  bi_decl(bi_2pins_with_func(3, 2, GPIO_FUNC_SPI));
+  // Make the CS and DATA_CMD pins available to picotool
+  bi_decl(bi_1pin_with_name(1, "SPI CS"));
+  bi_decl(bi_1pin_with_name(0, "SPI D/C"));
+
+  // the SPI port is only set up once, a second call just resets the panel
+  if (tiny2040_spi.transport.write == NULL) {
+    sh1107_spi_init(&tiny2040_spi, srn_display, &tiny2040_config);
+  } else {
+    sh1107_set_transport(srn_display, &tiny2040_spi.transport);
+  }
+
+  srn_turn_display_on(true);
+  srn_turn_entire_disp_on(true);
+  sleep_ms(1000);
+  srn_turn_entire_disp_on(false);
+  sleep_ms(500);
+
+  srn_fast_clear();
+
+}
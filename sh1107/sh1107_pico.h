@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* sh1107_pico.h
+ * The SPI transport for the RP2040.  Each panel has a sh1107_spi_t with
+ * its SPI port, pins and DMA channel, so a second SH1107 can be driven on
+ * the other SPI port or on the same port with its own CS pin:
+ *
+ *   static sh1107_t right;
+ *   static sh1107_buffers_t right_buffers;
+ *   static sh1107_spi_t right_spi;
+ *   sh1107_spi_config_t config = {spi1, 10, 11, 9, 8, 1000 * 1000};
+ *   sh1107_init(&right, &right_buffers);
+ *   sh1107_spi_init(&right_spi, &right, &config);
+ *
+ * Panels on separate ports can refresh at the same time.  Panels that share
+ * a port take turns (see srn_bus.h): a blocking write waits for the
+ * transfer of the other panel to finish, and the second of two
+ * asynchronous refreshes on one port is queued and starts once the first
+ * is done.
+ *
+ * A refresh is sent as one stream (see srn_stream.h), with CS held low
+ * from the first command to the last pixel byte.  Commands and pixel data
+ * both go by DMA.  The transport uses an alarm of the default alarm pool
+ * while the SPI finishes each segment.
+ */
+
+#ifndef SH1107_PICO_H
+#define SH1107_PICO_H
+
+#include "hardware/spi.h"
+#include "sh1107_spi.h"
+#include "sh1107_transport.h"
+#include "srn_bus.h"
+
+typedef struct sh1107_spi_config {
+  spi_inst_t *spi;
+  uint sck_pin;
+  uint tx_pin;
+  uint cs_pin;
+  uint dc_pin;
+  uint baud;
+} sh1107_spi_config_t;
+
+// the Tiny2040 wiring used by init_sh1107_SPI()
+#define SH1107_TINY2040_SPI_CONFIG {spi0, 2, 3, 1, 0, 1000 * 1000}
+
+// up to this many transports can be set up with sh1107_spi_init()
+#ifndef SH1107_SPI_MAX
+#define SH1107_SPI_MAX 4
+#endif
+
+typedef struct sh1107_spi {
+  sh1107_spi_config_t config;
+  int dma_chan;
+  const uint8_t *volatile stream;  // the rest of the stream being sent, or NULL
+  const uint8_t *write_buf;        // the bytes of a start_write
+  bool write_cmd;
+  int num;                         // bytes in the DMA, or of the start_write
+  uint32_t byte_us;                // time to send a byte, rounded up
+  srn_bus_client_t client;         // its turns on the SPI port
+  srn_transport_t transport;
+} sh1107_spi_t;
+
+// Sets up the SPI port and pins of config, claims a DMA channel and makes
+// this the transport of display.  Nothing is sent to the panel.
+void sh1107_spi_init(sh1107_spi_t *this, sh1107_t *display, const sh1107_spi_config_t *config);
+
+#endif
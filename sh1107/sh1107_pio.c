@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "sh1107_spi.h"
+#include "sh1107_transport.h"
+#include "sh1107_pio.h"
+#include "srn_stream.h"
+#include "sh1107_tx.pio.h"
+
+/*  PIO transport to a sh1107 display controler.
+
+   Every transfer is a stream of tagged segments ending with a frame end
+   (see srn_stream.h).  The state machine raises its interrupt flag when it
+   has sent the frame end and released CS, which is when the transfer is
+   done.  Blocking writes are turned into a one segment stream on the fly.
+*/
+
+static sh1107_pio_t *pio_transports[SH1107_PIO_MAX];
+static int num_pio_transports;
+static int program_offset[2] = {-1, -1};
+static bool handler_added[2];
+
+// the bytes of a stream go in the top byte of a FIFO word, as the OSR
+// shifts left
+static inline void put_byte(sh1107_pio_t *this, uint8_t b) {
+  pio_sm_put_blocking(this->config.pio, this->sm, (uint32_t)b << 24);
+}
+
+static void wait_idle(sh1107_pio_t *this) {
+  while (this->busy) {
+    tight_loop_contents();
+  }
+}
+
+static void write_pio(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  sh1107_pio_t *this = (sh1107_pio_t *)ctx;
+  wait_idle(this);
+  this->busy = true;
+  this->async = false;
+  while (num > 0) {
+    int n = num < SRN_STREAM_MAX_SEGMENT ? num : SRN_STREAM_MAX_SEGMENT;
+    int header = (cmd ? 0 : 0x8000) | (n * 8 - 1);
+    put_byte(this, header >> 8);
+    put_byte(this, header & 0xFF);
+    for (int i = 0; i < n; i++) put_byte(this, buf[i]);
+    buf += n;
+    num -= n;
+  }
+  put_byte(this, 0);
+  put_byte(this, 0);
+  wait_idle(this);
+}
+
+static void start_write_pio(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  // single segments are short, so they are sent straight away
+  sh1107_pio_t *this = (sh1107_pio_t *)ctx;
+  write_pio(ctx, buf, num, cmd);
+  sh1107_transfer_done(this->transport.display);
+}
+
+static void start_stream_pio(void *ctx, const uint8_t *stream, int num) {
+  sh1107_pio_t *this = (sh1107_pio_t *)ctx;
+  wait_idle(this);
+  this->busy = true;
+  this->async = true;
+  dma_channel_transfer_from_buffer_now(this->dma_chan, stream, num);
+}
+
+// INTERRUPTS
+// One shared handler per PIO block serves the state machines of every
+// transport.
+
+static void pio_irq_handler() {
+  for (int i = 0; i < num_pio_transports; i++) {
+    sh1107_pio_t *this = pio_transports[i];
+    if (!pio_interrupt_get(this->config.pio, this->sm)) continue;
+    pio_interrupt_clear(this->config.pio, this->sm);
+    bool async = this->async;
+    this->async = false;
+    this->busy = false;
+    if (async) sh1107_transfer_done(this->transport.display);
+  }
+}
+
+void sh1107_pio_init(sh1107_pio_t *this, sh1107_t *display, const sh1107_pio_config_t *config) {
+  hard_assert(num_pio_transports < SH1107_PIO_MAX);
+  PIO pio = config->pio;
+  int index = pio_get_index(pio);
+  this->config = *config;
+  this->busy = false;
+  this->async = false;
+  if (program_offset[index] < 0) {
+    program_offset[index] = pio_add_program(pio, &sh1107_tx_program);
+  }
+  this->sm = pio_claim_unused_sm(pio, true);
+  sh1107_tx_program_init(pio, this->sm, program_offset[index], config->sck_pin,
+                         config->tx_pin, config->dc_pin, config->baud);
+
+  // the stream is fed a byte at a time, paced by the TX FIFO
+  this->dma_chan = dma_claim_unused_channel(true);
+  dma_channel_config c = dma_channel_get_default_config(this->dma_chan);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, pio_get_dreq(pio, this->sm, true));
+  dma_channel_configure(this->dma_chan, &c, &pio->txf[this->sm], NULL, 0, false);
+
+  // IRQ 0 rel in the program sets the flag numbered after the state machine
+  uint irq = index == 0 ? PIO0_IRQ_0 : PIO1_IRQ_0;
+  pio_set_irq0_source_enabled(pio, pis_interrupt0 + this->sm, true);
+  if (!handler_added[index]) {
+    irq_add_shared_handler(irq, pio_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(irq, true);
+    handler_added[index] = true;
+  }
+  pio_transports[num_pio_transports++] = this;
+
+  this->transport.write = write_pio;
+  this->transport.start_write = start_write_pio;
+  this->transport.start_stream = start_stream_pio;
+  this->transport.ctx = this;
+  sh1107_set_transport(display, &this->transport);
+}
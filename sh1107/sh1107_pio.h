@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* sh1107_pio.h
+ * A transport for the RP2040 that sends to the SH1107 with the PIO
+ * program in sh1107_tx.pio instead of the SPI block.  The program drives
+ * SCK, MOSI, D/C and CS itself from a tagged stream (see srn_stream.h), so
+ * srn_refresh_async() hands over a whole frame, commands included, as one
+ * DMA transfer with CS held low throughout, and SCK is not tied to the
+ * SPI block's dividers.
+ *
+ *   static sh1107_pio_t pio_tx;
+ *   sh1107_pio_config_t config = SH1107_TINY2040_PIO_CONFIG;
+ *   sh1107_pio_init(&pio_tx, srn_display, &config);
+ *
+ * The pins are the same as for SPI; CS must be the pin after D/C, as it is
+ * on the Tiny2040.  Blocking writes push the bytes through the FIFO and
+ * wait for the end of the frame.
+ */
+
+#ifndef SH1107_PIO_H
+#define SH1107_PIO_H
+
+#include "hardware/pio.h"
+#include "sh1107_spi.h"
+#include "sh1107_transport.h"
+
+typedef struct sh1107_pio_config {
+  PIO pio;
+  uint sck_pin;
+  uint tx_pin;
+  uint dc_pin;      // CS is dc_pin + 1
+  uint baud;
+} sh1107_pio_config_t;
+
+// the Tiny2040 wiring with a 4 MHz clock
+#define SH1107_TINY2040_PIO_CONFIG {pio0, 2, 3, 0, 4000 * 1000}
+
+// up to this many transports can be set up with sh1107_pio_init()
+#ifndef SH1107_PIO_MAX
+#define SH1107_PIO_MAX 4
+#endif
+
+typedef struct sh1107_pio {
+  sh1107_pio_config_t config;
+  uint sm;
+  int dma_chan;
+  volatile bool busy;        // a frame is on the wire
+  volatile bool async;       // and the driver is waiting for it
+  srn_transport_t transport;
+} sh1107_pio_t;
+
+// Loads the program if needed, claims a state machine and a DMA channel
+// and makes this the transport of display.  Nothing is sent to the panel.
+void sh1107_pio_init(sh1107_pio_t *this, sh1107_t *display, const sh1107_pio_config_t *config);
+
+#endif
@@ -0,0 +1,46 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* sh1107_port.h
+ * The portable parts of the driver (pixel_ops, draw_char, draw_graphics,
+ * sh1107_spi and srn_pump) include this instead of pico/stdlib.h so they
+ * can also be built on a Linux host with SH1107_HOST defined.  On the
+ * host the display is the simulator in sh1107_sim.c.
+ */
+
+#ifndef SH1107_PORT_H
+#define SH1107_PORT_H
+
+#ifdef SH1107_HOST
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <time.h>
+
+static inline void tight_loop_contents() {}
+
+// monotonic time used for benchmarks and instrumentation
+static inline uint64_t srn_time_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#else
+
+#include "pico/stdlib.h"
+
+// monotonic time used for benchmarks and instrumentation.  The RP2040
+// timer counts microseconds.
+static inline uint64_t srn_time_ns() {
+  return time_us_64() * 1000;
+}
+
+#endif
+
+#endif
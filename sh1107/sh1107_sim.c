@@ -0,0 +1,234 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_port.h"
+#include "sh1107_sim.h"
+#include "srn_stream.h"
+
+// Command decoding follows the Commands chapter (page 23) of the SH1107
+// spec sheet.  Commands that only affect the analog side of the panel are
+// accepted and ignored.
+
+static void sim_write(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  sh1107_sim_write((sh1107_sim_t *)ctx, buf, num, cmd);
+}
+
+static void sim_start_stream(void *ctx, const uint8_t *stream, int num) {
+  sh1107_sim_t *this = (sh1107_sim_t *)ctx;
+  sh1107_sim_write_stream(this, stream, num);
+  sh1107_transfer_done(this->transport.display);
+}
+
+static void sim_start_write(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  sh1107_sim_t *this = (sh1107_sim_t *)ctx;
+  sh1107_sim_write(this, buf, num, cmd);
+  sh1107_transfer_done(this->transport.display);
+}
+
+// SHARED PORT
+// Transfers are queued on the bus and fed to the model when they complete.
+
+static void bus_start(srn_bus_client_t *client) {
+  ((sh1107_sim_t *)client->ctx)->sending = true;
+}
+
+static void bus_write(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  sh1107_sim_t *this = (sh1107_sim_t *)ctx;
+  // every client of the bus is a model
+  while (!srn_bus_try_claim(this->bus, &this->client)) {
+    sh1107_sim_complete((sh1107_sim_t *)this->bus->owner->ctx);
+  }
+  sh1107_sim_write(this, buf, num, cmd);
+  srn_bus_release(this->bus);
+}
+
+static void bus_start_stream(void *ctx, const uint8_t *stream, int num) {
+  sh1107_sim_t *this = (sh1107_sim_t *)ctx;
+  this->queued = stream;
+  this->queued_num = num;
+  this->queued_stream = true;
+  srn_bus_start(this->bus, &this->client);
+}
+
+static void bus_start_write(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  sh1107_sim_t *this = (sh1107_sim_t *)ctx;
+  this->queued = buf;
+  this->queued_num = num;
+  this->queued_cmd = cmd;
+  this->queued_stream = false;
+  srn_bus_start(this->bus, &this->client);
+}
+
+void sh1107_sim_share_bus(sh1107_sim_t *this, srn_bus_t *bus) {
+  this->bus = bus;
+  this->client.start = bus_start;
+  this->client.ctx = this;
+  this->transport.write = bus_write;
+  this->transport.start_write = bus_start_write;
+  if (this->transport.start_stream) this->transport.start_stream = bus_start_stream;
+}
+
+bool sh1107_sim_complete(sh1107_sim_t *this) {
+  if (!this->sending) return false;
+  if (this->queued_stream) {
+    sh1107_sim_write_stream(this, this->queued, this->queued_num);
+  } else {
+    sh1107_sim_write(this, this->queued, this->queued_num, this->queued_cmd);
+  }
+  this->sending = false;
+  srn_bus_release(this->bus);
+  sh1107_transfer_done(this->transport.display);
+  return true;
+}
+
+void sh1107_sim_init(sh1107_sim_t *this, uint32_t baud) {
+  memset(this, 0, sizeof(*this));
+  this->contrast = 0x80;
+  this->dc_data = true;
+  this->baud = baud;
+  this->cs_ns = 100;
+  this->dc_ns = 50;
+  this->transport.write = sim_write;
+  this->transport.start_write = sim_start_write;
+  this->transport.start_stream = sim_start_stream;
+  this->transport.ctx = this;
+}
+
+void sh1107_sim_enable_streams(sh1107_sim_t *this, bool enable) {
+  if (!enable) this->transport.start_stream = NULL;
+  else this->transport.start_stream = this->bus ? bus_start_stream : sim_start_stream;
+}
+
+srn_transport_t *sh1107_sim_transport(sh1107_sim_t *this) {
+  return &this->transport;
+}
+
+void sh1107_sim_reset_counters(sh1107_sim_t *this) {
+  this->cmd_bytes = 0;
+  this->data_bytes = 0;
+  this->transfers = 0;
+  this->cs_toggles = 0;
+  this->dc_switches = 0;
+  this->wire_ns = 0;
+}
+
+// second byte of a two byte command
+static void finish_cmd(sh1107_sim_t *this, uint8_t c) {
+  switch (this->pending_cmd) {
+  case 0x81: this->contrast = c; break;
+  case 0xD3: this->display_offset = c & 0x7F; break;
+  case 0xDC: this->start_line = c & 0x7F; break;
+  default: break; // 0xA8, 0xAD, 0xD5, 0xD9, 0xDB: analog settings
+  }
+  this->pending_cmd = 0;
+}
+
+static void decode_cmd(sh1107_sim_t *this, uint8_t c) {
+  if (this->pending_cmd) {
+    finish_cmd(this, c);
+  } else if (c <= 0x0F) {
+    this->col = (this->col & 0x70) | c;
+  } else if (c <= 0x17) {
+    this->col = ((c & 0x7) << 4) | (this->col & 0x0F);
+  } else if (c == 0x20 || c == 0x21) {
+    this->vertical_mode = c & 1;
+  } else if (c == 0x81 || c == 0xA8 || c == 0xAD || c == 0xD3 ||
+             c == 0xD5 || c == 0xD9 || c == 0xDB || c == 0xDC) {
+    this->pending_cmd = c;
+  } else if (c == 0xA0 || c == 0xA1) {
+    this->seg_remap = c & 1;
+  } else if (c == 0xA4 || c == 0xA5) {
+    this->entire_on = c & 1;
+  } else if (c == 0xA6 || c == 0xA7) {
+    this->reverse = c & 1;
+  } else if (c == 0xAE || c == 0xAF) {
+    this->display_on = c & 1;
+  } else if ((c & 0xF0) == 0xB0) {
+    this->page = c & 0xF;
+  } else if ((c & 0xF0) == 0xC0) {
+    this->com_reverse = (c & 0x8) != 0;
+  } else if (c == 0xE0 || c == 0xE3 || c == 0xEE) {
+    // read-modify-write, nop, end: nothing to model
+  } else {
+    this->unknown_cmds++;
+  }
+}
+
+static void write_data(sh1107_sim_t *this, uint8_t d) {
+  this->gddram[this->page][this->col] = d;
+  if (this->vertical_mode) {
+    this->page = (this->page + 1) & 0xF;
+    if (this->page == 0) this->col = (this->col + 1) & 0x7F;
+  } else {
+    this->col = (this->col + 1) & 0x7F;
+  }
+}
+
+// bytes clocked out while CS is asserted
+static void feed(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  sh1107_sim_t *this = (sh1107_sim_t *)ctx;
+  bool data = !cmd;
+  if (data != this->dc_data) {
+    this->dc_switches++;
+    this->dc_data = data;
+    this->wire_ns += this->dc_ns;
+  }
+  this->wire_ns += (uint64_t)num * 8 * 1000000000 / this->baud;
+  for (int i = 0; i < num; i++) {
+    if (cmd) decode_cmd(this, buf[i]);
+    else write_data(this, buf[i]);
+  }
+  if (cmd) this->cmd_bytes += num;
+  else this->data_bytes += num;
+}
+
+// one assertion of CS
+static void transfer(void *ctx) {
+  sh1107_sim_t *this = (sh1107_sim_t *)ctx;
+  this->transfers++;
+  this->cs_toggles += 2;
+  this->wire_ns += this->cs_ns;
+}
+
+void sh1107_sim_write(sh1107_sim_t *this, const uint8_t *buf, int num, bool cmd) {
+  transfer(this);
+  feed(this, buf, num, cmd);
+}
+
+int sh1107_sim_write_stream(sh1107_sim_t *this, const uint8_t *stream, int num) {
+  return srn_stream_decode(stream, num, feed, transfer, this);
+}
+
+bool sh1107_sim_pixel(const sh1107_sim_t *this, int x, int y) {
+  if (!this->display_on) return false;
+  if (this->entire_on) return true;
+  int row = (y + this->start_line + this->display_offset) & 0x7F;
+  bool on = (this->gddram[row >> 3][x] >> (row & 7)) & 1;
+  return on != this->reverse;
+}
+
+bool sh1107_sim_write_pbm(const sh1107_sim_t *this, const char *path) {
+  FILE *f = fopen(path, "w");
+  if (f == NULL) return false;
+  fprintf(f, "P1\n128 128\n");
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 128; x++) {
+      fputc(sh1107_sim_pixel(this, x, y) ? '1' : '0', f);
+    }
+    fputc('\n', f);
+  }
+  return fclose(f) == 0;
+}
+
+void sh1107_sim_print_counters(const sh1107_sim_t *this) {
+  printf("transfers %u cmd_bytes %llu data_bytes %llu cs_toggles %u "
+         "dc_switches %u wire_us %llu\n",
+         this->transfers, (unsigned long long)this->cmd_bytes,
+         (unsigned long long)this->data_bytes, this->cs_toggles,
+         this->dc_switches, (unsigned long long)(this->wire_ns / 1000));
+}
@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* sh1107_sim.h
+ * A software model of the SH1107 for host builds.  It plugs in as the
+ * transport (see sh1107_transport.h), decodes the commands the driver
+ * sends, keeps its own copy of the 128x128 GDDRAM and counts what went
+ * over the wire.  Frames can be written out as PBM images to compare
+ * against golden images.
+ *
+ *   sh1107_sim_t sim;
+ *   sh1107_sim_init(&sim, 1000 * 1000);
+ *   srn_set_transport(sh1107_sim_transport(&sim));
+ */
+
+#ifndef SH1107_SIM_H
+#define SH1107_SIM_H
+
+#include "sh1107_port.h"
+#include "sh1107_transport.h"
+#include "srn_bus.h"
+
+typedef struct sh1107_sim {
+  // controller state
+  uint8_t gddram[16][128];
+  int col;
+  int page;
+  bool vertical_mode;     // 0x21 vertical addressing, else page addressing
+  int start_line;         // 0xDC display start line
+  int display_offset;     // 0xD3 display offset
+  int contrast;
+  bool display_on;
+  bool entire_on;
+  bool reverse;
+  bool seg_remap;
+  bool com_reverse;
+  uint8_t pending_cmd;    // first byte of a two byte command, or 0
+  int unknown_cmds;
+
+  // wire cost
+  uint32_t baud;          // SPI clock in Hz
+  uint32_t cs_ns;         // time to assert and release CS around a transfer
+  uint32_t dc_ns;         // time to switch D/C
+  uint64_t cmd_bytes;
+  uint64_t data_bytes;
+  uint32_t transfers;     // one per CS assertion
+  uint32_t cs_toggles;
+  uint32_t dc_switches;
+  bool dc_data;           // current level of D/C
+  uint64_t wire_ns;       // estimated time on the wire
+
+  // a shared SPI port, see sh1107_sim_share_bus()
+  srn_bus_t *bus;
+  srn_bus_client_t client;
+  const uint8_t *queued;  // the transfer waiting for or holding the port
+  int queued_num;
+  bool queued_cmd;
+  bool queued_stream;
+  bool sending;           // holds the port until sh1107_sim_complete()
+
+  srn_transport_t transport;
+} sh1107_sim_t;
+
+// Sets the model to its power on state with a blank GDDRAM.  baud is the
+// SPI clock used for the wire time estimate.
+void sh1107_sim_init(sh1107_sim_t *this, uint32_t baud);
+
+// The transport that feeds this model.  Pass it to srn_set_transport() or
+// sh1107_set_transport().
+srn_transport_t *sh1107_sim_transport(sh1107_sim_t *this);
+
+// Makes the transport take whole frames as streams (see srn_stream.h), as
+// the SPI and PIO transports do, so each refresh is sent in one CS
+// assertion.  On by default.  Turned off, the driver sends a frame one
+// segment at a time, as it does for a transport without streams.
+void sh1107_sim_enable_streams(sh1107_sim_t *this, bool enable);
+
+// Puts the model on an SPI port shared with other models, as panels with
+// their own CS pins on one RP2040 SPI port.  Its transfers then take turns
+// on bus as the RP2040 transport does, and each stays on the wire until
+// sh1107_sim_complete() is called for it, which stands in for the DMA
+// interrupt.  A blocking write completes the transfer holding the port
+// first.  Nothing else completes a transfer, so only asynchronous
+// refreshes can be sent.
+void sh1107_sim_share_bus(sh1107_sim_t *this, srn_bus_t *bus);
+
+// Feeds the transfer on the wire to the model, releases the port, which
+// starts the next transfer waiting for it, and tells the driver.  Returns
+// false if the model is not sending.
+bool sh1107_sim_complete(sh1107_sim_t *this);
+
+// Clears the byte, toggle and wire time counters.
+void sh1107_sim_reset_counters(sh1107_sim_t *this);
+
+// Feeds bytes to the model as if they came over SPI.
+void sh1107_sim_write(sh1107_sim_t *this, const uint8_t *buf, int num, bool cmd);
+
+// Feeds a stream as the PIO transmitter would put it on the wire, one CS
+// assertion per frame.  Returns the number of frames, or -1 if the stream
+// is malformed.
+int sh1107_sim_write_stream(sh1107_sim_t *this, const uint8_t *stream, int num);
+
+// Returns the state of the pixel shown at x, y on the glass.  It takes the
+// display start line and offset into account.
+bool sh1107_sim_pixel(const sh1107_sim_t *this, int x, int y);
+
+// Writes what is shown on the glass as a plain (P1) PBM image, lit pixels
+// black.  Returns false if the file could not be written.
+bool sh1107_sim_write_pbm(const sh1107_sim_t *this, const char *path);
+
+// Prints the counters to stdout.
+void sh1107_sim_print_counters(const sh1107_sim_t *this);
+
+#endif
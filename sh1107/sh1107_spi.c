@@ -7,66 +7,107 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include "pico/stdlib.h"
-#include "pico/binary_info.h"
-#include "hardware/spi.h"
-
-/*  code to talk to a sh1107 display controler for pimoroni 1.2" 128x128 monochrome display.
+#include "sh1107_port.h"
 
+#include "sh1107_spi.h"
+#include "sh1107_transport.h"
+#include "srn_pump.h"
+#include "srn_stream.h"
+#include "srn_encode.h"
+#include "srn_mirror.h"
+#include "srn_perf.h"
 
-   GPIO 0 (pin 12) D/C 
-   GPIO 1 (pin 15) Chip select -> CSB/!CS on bme280 board
-   GPIO 2 (pin 14) SCK/spi0_sclk -> SCL/SCK on bme280 board
-   GPIO 3 (pin 13) MOSI/spi0_tx -> MOSI on SH1107
-
-   Note: The SPI0 on the Tiny2040 defined GPIO 0 as the RX pin.  But
-   the SH1107 display controller does not have an MISO pin that would
-   normally be connected to the RX pin.  So that pin is repurposed to
-   be the D/C pin required by the SH1107.
+/*  code to talk to a sh1107 display controler for pimoroni 1.2" 128x128 monochrome display.
 
+   This file builds the commands and pixel data for the SH1107 and hands them
+   to the transport of the display, set with sh1107_set_transport().  The SPI
+   and GPIO code for the Tiny2040 is in sh1107_pico.c.
 */
 
-// this is the list of GPIO pins for the tiny2040 SPI0
-#define SPI_CSN_PIN 1 
-#define DATA_CMD_PIN 0
-//#define SPI_RX_PIN 0
-#define SPI_SCK_PIN 2
-#define SPI_TX_PIN 3
-#define spi_display spi0
-
-// the next 5 functions are low lever SPI operations that
-// are used to write commands or data to the SH1107
+// DISPLAYS
+
+#ifndef SRN_NO_DEFAULT_FRAMEBUFFER
+static sh1107_buffers_t default_buffers;
+
+sh1107_t srn_default_display = {
+  .pixels = &default_buffers.pixels[0],
+#if SRN_NUM_LAYERS > 1
+  .output = &default_buffers.pixels[SRN_NUM_LAYERS],
+  .layer_pixels = default_buffers.pixels,
+  .layers = {[0 ... SRN_NUM_LAYERS - 1] = {true, SRN_LAYER_OR}},
+#else
+  .output = &default_buffers.pixels[0],
+#endif
+  .hw_scroll_enabled = true,
+  .stream = default_buffers.stream,
+};
+
+srn_pixels_t *srn_draw_pixels = &default_buffers.pixels[0];
+#else
+// no pixel buffers, see srn_pages.h
+sh1107_t srn_default_display = {
+  .dirty_min = {[0 ... 15] = 0xFF},
+};
+
+srn_pixels_t *srn_draw_pixels = NULL;
+#endif
+
+sh1107_t *srn_display = &srn_default_display;
+
+void sh1107_init(sh1107_t *this, sh1107_buffers_t *buffers) {
+  memset(this, 0, sizeof(*this));
+  this->hw_scroll_enabled = true;
+  if (buffers == NULL) {
+    for (int j = 0; j < 16; j++) {
+      this->dirty_min[j] = 0xFF;
+      this->dirty_max[j] = 0;
+    }
+    return;
+  }
+  memset(buffers->pixels, 0, sizeof(buffers->pixels));
+  this->pixels = &buffers->pixels[0];
+#if SRN_NUM_LAYERS > 1
+  this->output = &buffers->pixels[SRN_NUM_LAYERS];
+  this->layer_pixels = buffers->pixels;
+  for (int l = 0; l < SRN_NUM_LAYERS; l++) {
+    this->layers[l].enabled = true;
+    this->layers[l].op = SRN_LAYER_OR;
+  }
+#else
+  this->output = &buffers->pixels[0];
+#endif
+  this->stream = buffers->stream;
+  for (int j = 0; j < 16; j++) {
+    this->dirty_min[j] = 0;
+    this->dirty_max[j] = 127;
+  }
+}
 
-static inline void cs_select() {
-  asm volatile("nop \n nop \n nop");
-  gpio_put(SPI_CSN_PIN, 0);  // Active low
-  asm volatile("nop \n nop \n nop");
+sh1107_t *sh1107_select(sh1107_t *this) {
+  sh1107_t *old = srn_display;
+  srn_display = this;
+  srn_draw_pixels = this->pixels;
+  return old;
 }
 
-static inline void cs_deselect() {
-  asm volatile("nop \n nop \n nop");
-  gpio_put(SPI_CSN_PIN, 1);
-  asm volatile("nop \n nop \n nop");
+void sh1107_set_transport(sh1107_t *this, srn_transport_t *transport) {
+  this->transport = transport;
+  if (transport) transport->display = this;
 }
 
-static inline void cmd_select() {
-  asm volatile("nop \n nop \n nop");
-  gpio_put(DATA_CMD_PIN, 0);  // CMD = 1
-  asm volatile("nop \n nop \n nop");
+void srn_set_transport(srn_transport_t *transport) {
+  sh1107_set_transport(srn_display, transport);
 }
 
-static inline void data_select() {
-  asm volatile("nop \n nop \n nop");
-  gpio_put(DATA_CMD_PIN, 1); // DATA = 0
-  asm volatile("nop \n nop \n nop");
+srn_transport_t *srn_get_transport() {
+  return srn_display->transport;
 }
 
-static void write_spi(uint8_t *buf, int num, bool data_cmd) {
-  if (data_cmd) cmd_select(); else data_select();
-  cs_select();
-  spi_write_blocking(spi_display, buf, num);
-  cs_deselect();
-  //sleep_ms(1);
+// All commands go through write_spi.  An asynchronous refresh may still
+// be using the transport, so wait for it first to keep the order.
+static void write_spi(sh1107_t *this, uint8_t *buf, int num, bool data_cmd) {
+  sh1107_refresh_wait(this);
+  this->transport->write(this->transport->ctx, buf, num, data_cmd);
 }
 
 // SH1107 COMMANDS
@@ -79,125 +120,427 @@ void srn_set_col_page(int col, int page) {
   buf[0] = 0x10 | ((col >> 4) & 0x7);
   buf[1] = 0x00 | col & 0xF;
   buf[2] = 0xB0 | page & 0xf;
-  write_spi(buf, 3, true);
+  write_spi(srn_display, buf, 3, true);
 }
 
 void srn_set_mem_adr_mode(int p_v) {
   uint8_t buf[1];
   buf[0] = 0x20 | p_v & 11;
-  write_spi(buf, 1, true);
+  write_spi(srn_display, buf, 1, true);
+  // the frame encoder only sends the mode when it changes
+  srn_display->vertical_mode = p_v & 1;
 }
 
 void srn_set_contrast(int contrast) {
   uint8_t buf[2];
   buf[0] = 0x81;
   buf[1] = contrast & 0xFF;
-  write_spi(buf, 2, true);
+  write_spi(srn_display, buf, 2, true);
 }
 
 void srn_set_seg_rot(int p_v) {
   uint8_t buf[1];
   buf[0] = 0xa0 | p_v & 1;
-  write_spi(buf, 1, true);
+  write_spi(srn_display, buf, 1, true);
 }
 
 void srn_turn_entire_disp_on(bool on) {
   uint8_t buf[1];
   buf[0] = 0xA4;
   if (on) buf[0] |= 1;
-  write_spi(buf, 1, true);
+  write_spi(srn_display, buf, 1, true);
 }
 
 void srn_set_reverse_display(bool reverse) {
   uint8_t buf[1];
   buf[0] = 0xA6;
   if (reverse) buf[0] |= 1;
-  write_spi(buf, 1, true);
+  write_spi(srn_display, buf, 1, true);
 }
 
 void srn_set_display_offset(int offset) {
   uint8_t buf[2];
-  buf[0] = 0x81;
+  buf[0] = 0xD3;
   buf[1] = offset & 0x7F;
-  write_spi(buf, 2, true);
+  write_spi(srn_display, buf, 2, true);
 }
 
 void srn_turn_display_on(bool on) {
   uint8_t buf[1];
   buf[0] = 0xAE;
   if (on) buf[0] |= 1;
-  write_spi(buf, 1, true);
+  write_spi(srn_display, buf, 1, true);
 }
 
 void srn_reverse_disp_on(bool reverse) {
   uint8_t buf[1];
   buf[0] = 0xC0;
   if (reverse) buf[0] |= 8;
-  write_spi(buf, 1, true);
+  write_spi(srn_display, buf, 1, true);
 }
 
 void srn_set_display_start(int start_line) {
   uint8_t buf[2];
-  buf[0] = 0xDB;
+  buf[0] = 0xDC;
   buf[1] = start_line & 0x7F;
-  write_spi(buf, 2, true);
+  write_spi(srn_display, buf, 2, true);
 }
 
-// PIXEL DATA
-// The display pixel buffer is is a local copy of the display buffer
-// in the SH1107.  All drawing commands make changes to display_pixel array
-// and then call refresh to copy the holw buffer out to the SH1107.
+// LAYERS
 
-uint8_t srn_display_pixels[16][128];
+#if SRN_NUM_LAYERS > 1
 
-void srn_refresh() {
+void srn_select_layer(int layer) {
+  if (layer < 0 || layer >= SRN_NUM_LAYERS) return;
+  srn_display->pixels = &srn_display->layer_pixels[layer];
+  srn_draw_pixels = srn_display->pixels;
+}
+
+void srn_set_layer(int layer, bool enabled, srn_layer_op_t op) {
+  if (layer < 0 || layer >= SRN_NUM_LAYERS) return;
+  srn_display->layers[layer].enabled = enabled;
+  srn_display->layers[layer].op = op;
+  srn_mark_all_dirty();
+}
+
+// Composites words first to last, stride apart, of every layer into out.
+static void composite_words(sh1107_t *this, uint32_t *out, int offset, int first, int last,
+                            int stride) {
+  for (int w = first; w <= last; w += stride) out[w] = 0;
+  for (int l = 0; l < SRN_NUM_LAYERS; l++) {
+    if (!this->layers[l].enabled) continue;
+    const uint32_t *in = (const uint32_t *)this->layer_pixels[l] + offset;
+    switch (l == 0 ? SRN_LAYER_OR : this->layers[l].op) {
+    case SRN_LAYER_OR:
+      for (int w = first; w <= last; w += stride) out[w] |= in[w];
+      break;
+    case SRN_LAYER_ANDNOT:
+      for (int w = first; w <= last; w += stride) out[w] &= ~in[w];
+      break;
+    case SRN_LAYER_XOR:
+      for (int w = first; w <= last; w += stride) out[w] ^= in[w];
+      break;
+    }
+  }
+}
+
+void sh1107_composite_dirty(sh1107_t *this) {
   for (int j = 0; j < 16; j++) {
-    srn_set_col_page(0, j);
-    write_spi(srn_display_pixels[j], 128, false);
+    int col_min = this->dirty_min[j];
+    int col_max = this->dirty_max[j];
+    if (col_min > col_max) continue;
+#ifdef SRN_COLUMN_MAJOR
+    // page j of column c is in word c * 4 + j / 4, so the columns of the
+    // span are every fourth word.  The other pages of those words are
+    // composited along with it, which does no harm.
+    int offset = j >> 2;
+    composite_words(this, (uint32_t *)*this->output + offset, offset,
+                    col_min * 4, col_max * 4, 4);
+#else
+    // the span is widened to whole words
+    int offset = j * 32;
+    composite_words(this, (uint32_t *)*this->output + offset, offset,
+                    col_min >> 2, col_max >> 2, 1);
+#endif
   }
 }
 
-void srn_fast_clear() {
+#else
+
+void srn_select_layer(int layer) {
+}
+
+void srn_set_layer(int layer, bool enabled, srn_layer_op_t op) {
+}
+
+void sh1107_composite_dirty(sh1107_t *this) {
+}
+
+#endif
+
+void srn_composite_dirty() {
+  sh1107_composite_dirty(srn_display);
+}
+
+// HARDWARE SCROLL
+// srn_display_pixels is always kept in screen order.  Page p of it is
+// stored in GDDRAM page (p + page_offset) & 15 and the display start line
+// is page_offset * 8, so the panel still shows the pages in order.  Moving
+// the offset scrolls the whole screen without resending it.
+
+void srn_mark_all_dirty() {
   for (int j = 0; j < 16; j++) {
-    for (int i = 0; i < 128; i++) {
-      srn_display_pixels[j][i] = 0;
+    srn_dirty_min[j] = 0;
+    srn_dirty_max[j] = 127;
+  }
+}
+
+// FRAMES
+// Every refresh encodes its frame into the display's stream (see
+// srn_encode.h).  A transport that takes streams sends it as one transfer
+// with CS held low.  Any other is given it a segment at a time, with write
+// or, for an asynchronous refresh, with start_write.
+
+static void write_segment(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  srn_transport_t *transport = ((sh1107_t *)ctx)->transport;
+  transport->write(transport->ctx, buf, num, cmd);
+}
+
+static void add_segment(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  sh1107_t *this = (sh1107_t *)ctx;
+  srn_segment_t *segment = &this->segments[this->num_segments++];
+  segment->buf = buf;
+  segment->num = num;
+  segment->cmd = cmd;
+}
+
+static void start_segment(sh1107_t *this, int s);
+
+void sh1107_send_stream(sh1107_t *this, const uint8_t *stream, int num, bool async) {
+  sh1107_refresh_wait(this);
+  SRN_PERF_STREAM(stream, num);
+  SRN_PERF_START(this->perf_send_ns);
+  srn_transport_t *transport = this->transport;
+  if (transport->start_stream) {
+    this->num_segments = 0;
+    this->next_segment = 0;
+    this->async_busy = true;
+    transport->start_stream(transport->ctx, stream, num);
+    if (!async) sh1107_refresh_wait(this);
+  } else if (async) {
+    this->num_segments = 0;
+    srn_stream_decode(stream, num, add_segment, NULL, this);
+    this->next_segment = 1;
+    this->async_busy = true;
+    start_segment(this, 0);
+  } else {
+    srn_stream_decode(stream, num, write_segment, NULL, this);
+    SRN_PERF_STOP(SRN_PERF_SPI, this->perf_send_ns);
+  }
+}
+
+// Encodes the changed spans of pixels and sends them, and gives the frame
+// to the display's mirror if it has one.  With async it returns as soon as
+// the transfer has started.
+static bool send_frame(sh1107_t *this, srn_pixels_t pixels, uint8_t dirty_min[16],
+                       uint8_t dirty_max[16], bool async) {
+  sh1107_refresh_wait(this);
+  srn_stream_t stream;
+  srn_stream_init(&stream, this->stream, SRN_STREAM_FRAME_BYTES);
+  srn_plan_t plan;
+  if (!sh1107_encode_frame(this, pixels, dirty_min, dirty_max, &stream, &plan)) return false;
+  SRN_PERF_PAGES(plan.pages);
+  sh1107_send_stream(this, this->stream, stream.len, async);
+  if (this->mirror) srn_mirror_frame(this->mirror, pixels);
+  return true;
+}
+
+void sh1107_send_spans(sh1107_t *this, srn_pixels_t pixels,
+                       uint8_t dirty_min[16], uint8_t dirty_max[16]) {
+  send_frame(this, pixels, dirty_min, dirty_max, false);
+}
+
+void srn_send_spans(srn_pixels_t pixels, uint8_t dirty_min[16], uint8_t dirty_max[16]) {
+  sh1107_send_spans(srn_display, pixels, dirty_min, dirty_max);
+}
+
+void sh1107_refresh(sh1107_t *this) {
+  SRN_PERF_TIME(SRN_PERF_REFRESH);
+  if (this->pumped) { // core1 owns the SPI link
+    srn_pump_publish();
+    return;
+  }
+  if (this->stream == NULL) return; // no pixel buffers
+  sh1107_refresh_wait(this);
+  sh1107_composite_dirty(this);
+  send_frame(this, *this->output, this->dirty_min, this->dirty_max, false);
+}
+
+bool sh1107_refresh_spans(sh1107_t *this, const uint8_t span_min[16],
+                          const uint8_t span_max[16]) {
+  // a pending start line goes out as a command ahead of the spans, the
+  // pages it moves are already in place on the panel
+  if (this->pumped) {
+    sh1107_refresh(this);
+    return true;
+  }
+  SRN_PERF_TIME(SRN_PERF_REFRESH);
+  if (this->stream == NULL) return false; // no pixel buffers
+  sh1107_refresh_wait(this);
+  sh1107_composite_dirty(this);
+  uint8_t *dirty_min = this->dirty_min;
+  uint8_t *dirty_max = this->dirty_max;
+  uint8_t send_min[16];
+  uint8_t send_max[16];
+  for (int j = 0; j < 16; j++) {
+    send_min[j] = 0xFF;
+    send_max[j] = 0;
+    int col_min = dirty_min[j] > span_min[j] ? dirty_min[j] : span_min[j];
+    int col_max = dirty_max[j] < span_max[j] ? dirty_max[j] : span_max[j];
+    if (col_min > col_max) continue;
+    send_min[j] = col_min;
+    send_max[j] = col_max;
+    // what is left of the page span is still owed.  If the span sent was
+    // in the middle of it, the whole span is kept.
+    if (col_min == dirty_min[j] && col_max == dirty_max[j]) {
+      dirty_min[j] = 0xFF;
+      dirty_max[j] = 0;
+    } else if (col_min == dirty_min[j]) {
+      dirty_min[j] = col_max + 1;
+    } else if (col_max == dirty_max[j]) {
+      dirty_max[j] = col_min - 1;
     }
   }
-  srn_refresh();
+  return send_frame(this, *this->output, send_min, send_max, false);
 }
 
+void sh1107_refresh_region(sh1107_t *this, int minX, int minY, int maxX, int maxY) {
+  uint8_t span_min[16];
+  uint8_t span_max[16];
+  if (minX < 0) minX = 0;
+  if (maxX > 127) maxX = 127;
+  for (int j = 0; j < 16; j++) {
+    bool in = j >= minY >> 3 && j <= maxY >> 3 && minX <= maxX;
+    span_min[j] = in ? minX : 0xFF;
+    span_max[j] = in ? maxX : 0;
+  }
+  sh1107_refresh_spans(this, span_min, span_max);
+}
 
-// inits the SPI interface and clears the display
-void init_sh1107_SPI() {
-  // This example will use SPI0 at 0.5MHz.
-  spi_init(spi_display, 1000 * 1000);
-  gpio_set_function(SPI_SCK_PIN, GPIO_FUNC_SPI);
-  gpio_set_function(SPI_TX_PIN, GPIO_FUNC_SPI);
-  // Make the SPI pins available to picotool
-  bi_decl(bi_2pins_with_func( SPI_TX_PIN, SPI_SCK_PIN, GPIO_FUNC_SPI));
-  
-  // Chip select is active-low, so we'll initialise it to a driven-high state
-  gpio_init(SPI_CSN_PIN);
-  gpio_set_dir(SPI_CSN_PIN, GPIO_OUT);
-  gpio_put(SPI_CSN_PIN, 1);
-  // Make the CS pin available to picotool
-  bi_decl(bi_1pin_with_name(SPI_CSN_PIN, "SPI CS"));
-  gpio_init(DATA_CMD_PIN);
-  gpio_set_dir(DATA_CMD_PIN, GPIO_OUT);
-  gpio_put(DATA_CMD_PIN, 1);
-  // Make the DATA_CMD pin available to picotool
-  bi_decl(bi_1pin_with_name(DATA_CMD_PIN, "SPI CS"));
+void sh1107_refresh_full(sh1107_t *this) {
+  for (int j = 0; j < 16; j++) {
+    this->dirty_min[j] = 0;
+    this->dirty_max[j] = 127;
+  }
+  sh1107_refresh(this);
+}
 
-  srn_turn_display_on(true);
-  srn_turn_entire_disp_on(true);
-  sleep_ms(1000);
-  srn_turn_entire_disp_on(false);
-  sleep_ms(500);
-  
-  srn_fast_clear();
-  
+void srn_refresh() {
+  sh1107_refresh(srn_display);
 }
 
+void srn_refresh_region(int minX, int minY, int maxX, int maxY) {
+  sh1107_refresh_region(srn_display, minX, minY, maxX, maxY);
+}
 
+void srn_refresh_full() {
+  sh1107_refresh_full(srn_display);
+}
+
+static void move_page(int to, int from) {
+  for (int i = 0; i < 128; i++) {
+    SRN_PAGE_BYTE(to, i) = SRN_PAGE_BYTE(from, i);
+  }
+  srn_dirty_min[to] = srn_dirty_min[from];
+  srn_dirty_max[to] = srn_dirty_max[from];
+}
+
+static void clear_page(int j) {
+  for (int i = 0; i < 128; i++) {
+    SRN_PAGE_BYTE(j, i) = 0;
+  }
+  srn_dirty_min[j] = 0;
+  srn_dirty_max[j] = 127;
+}
+
+bool srn_hw_scroll_pages(int n) {
+  sh1107_t *this = srn_display;
+  // the pump sends frames on core1 with the offset it started with,
+  // moving the pages of one layer would not move the others, and a display
+  // without pixel buffers has no pages to move
+  if (!this->hw_scroll_enabled || this->pumped || SRN_NUM_LAYERS > 1 ||
+      this->stream == NULL) return false;
+  if (n == 0 || n >= 16 || n <= -16) return false;
+  if (n > 0) { // scroll up
+    for (int j = 0; j < 16 - n; j++) move_page(j, j + n);
+    for (int j = 16 - n; j < 16; j++) clear_page(j);
+  } else { // scroll down
+    for (int j = 15; j >= -n; j--) move_page(j, j + n);
+    for (int j = 0; j < -n; j++) clear_page(j);
+  }
+  this->page_offset = (this->page_offset + n) & 15;
+  this->start_line_pending = true;
+  return true;
+}
 
+void srn_enable_hw_scroll(bool enable) {
+  srn_display->hw_scroll_enabled = enable;
+}
 
+void srn_fast_clear() {
+  if (srn_draw_pixels == NULL) { // no pixel buffers, blank the panel itself
+    static const uint8_t blank[128];
+    if (srn_display->vertical_mode) srn_set_mem_adr_mode(0);
+    for (int j = 0; j < 16; j++) {
+      srn_set_col_page(0, j);
+      write_spi(srn_display, (uint8_t *)blank, 128, false);
+    }
+    return;
+  }
+  memset(srn_display_pixels, 0, sizeof(srn_display_pixels));
+  srn_refresh_full();
+}
+
+// ASYNCHRONOUS REFRESH
+// sh1107_refresh_async() encodes the frame like any other refresh.  The
+// stream holds a copy of the pixels, so the drawing code is free to change
+// the pixel buffers as soon as sh1107_refresh_async() returns.  A
+// transport that takes streams sends it in one go.  For any other, its
+// segments are sent one after the other: each time one finishes,
+// sh1107_transfer_done() starts the next.  Each display has its own
+// stream, so displays on different transports can be sending at the same
+// time.
+
+static void start_segment(sh1107_t *this, int s) {
+  this->transport->start_write(this->transport->ctx, this->segments[s].buf,
+                               this->segments[s].num, this->segments[s].cmd);
+}
+
+void sh1107_transfer_done(sh1107_t *this) {
+  int s = this->next_segment;
+  if (s < this->num_segments) {
+    this->next_segment = s + 1;
+    start_segment(this, s);
+  } else {
+    SRN_PERF_STOP(SRN_PERF_SPI, this->perf_send_ns);
+    this->async_busy = false;
+  }
+}
+
+void srn_transfer_done() {
+  sh1107_transfer_done(&srn_default_display);
+}
+
+bool sh1107_refresh_async(sh1107_t *this) {
+  SRN_PERF_TIME(SRN_PERF_REFRESH);
+  if (this->pumped) { // core1 owns the SPI link
+    srn_pump_publish();
+    return true;
+  }
+  if (this->stream == NULL) return false; // no pixel buffers
+  sh1107_refresh_wait(this);
+  sh1107_composite_dirty(this);
+  return send_frame(this, *this->output, this->dirty_min, this->dirty_max, true);
+}
+
+bool sh1107_refresh_busy(sh1107_t *this) {
+  return this->async_busy;
+}
+
+void sh1107_refresh_wait(sh1107_t *this) {
+  while (this->async_busy) {
+    tight_loop_contents();
+  }
+}
+
+bool srn_refresh_async() {
+  return sh1107_refresh_async(srn_display);
+}
+
+bool srn_refresh_busy() {
+  return sh1107_refresh_busy(srn_display);
+}
+
+void srn_refresh_wait() {
+  sh1107_refresh_wait(srn_display);
+}
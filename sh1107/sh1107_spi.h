@@ -5,7 +5,10 @@
  */
 
 #ifndef SH1107_SPI_H
-#define SH1007_SPI_H
+#define SH1107_SPI_H
+
+#include "sh1107_port.h"
+#include "srn_stream.h"
 
 // SH1107 COMMANDS
 // The next set of functions are used to send commands to the
@@ -27,24 +30,271 @@ void srn_set_display_start(int start_line);
 // The display pixel buffer is is a local copy of the display buffer
 // in the SH1107.  All drawing commands make changes to display_pixel array
 // and then call refresh to copy the holw buffer out to the SH1107.
-extern uint8_t srn_display_pixels[16][128];
+//
+// By default the buffer is page-major, srn_display_pixels[page][col], with
+// each byte holding 8 vertical pixels as the SH1107 does.  With
+// SRN_COLUMN_MAJOR defined at compile time it is column-major,
+// srn_display_pixels[col][page].  Each 128 pixel column is then 16
+// contiguous bytes that are handled as four 32 bit words, bit y of the
+// column in bit (y & 31) of word y >> 5, which turns vertical scrolls into
+// a few word shifts per column.  The refresh converts back to pages.  Use
+// SRN_PAGE_BYTE() to access the buffer independent of the layout.
+#ifdef SRN_COLUMN_MAJOR
+typedef uint8_t srn_pixels_t[128][16];
+#define SRN_FB_BYTE(_FB, _PAGE, _COL) ((_FB)[(_COL)][(_PAGE)])
+#else
+typedef uint8_t srn_pixels_t[16][128];
+#define SRN_FB_BYTE(_FB, _PAGE, _COL) ((_FB)[(_PAGE)][(_COL)])
+#endif
+
+// LAYERS
+// With SRN_NUM_LAYERS above 1 there is one pixel buffer per layer and
+// srn_display_pixels names the layer picked with srn_select_layer(), so
+// every drawing function works on any layer.  The refresh composites the
+// enabled layers, in order, into the buffer that is sent: layer 0 is the
+// base and each later layer is combined with what is below it by its
+// srn_layer_op_t.  Only the dirty spans are composited, 32 bits at a time.
+// So a static background can be drawn once on layer 0 while a graph is
+// cleared and redrawn on layer 1.  The dirty spans are shared, so drawing
+// on any layer marks the screen dirty as usual.  Hardware scrolling is
+// not used with layers.
+#ifndef SRN_NUM_LAYERS
+#define SRN_NUM_LAYERS 1
+#endif
+
+typedef enum srn_layer_op {
+  SRN_LAYER_OR,       // pixels set in the layer are set
+  SRN_LAYER_ANDNOT,   // pixels set in the layer are cleared
+  SRN_LAYER_XOR,      // pixels set in the layer are inverted
+} srn_layer_op_t;
+
+// DISPLAYS
+// Everything the driver keeps for one panel is in a sh1107_t: its
+// transport, its pixel buffers, the dirty spans, the hardware scroll
+// offset and the state of an asynchronous refresh.  srn_default_display is
+// selected at start up and init_sh1107_SPI() wires it to the Tiny2040 pins.
+// A second panel gets a sh1107_t of its own from sh1107_init() and its own
+// transport, for example on SPI1 or a second CS line (see sh1107_pico.h).
+//
+// The drawing functions (pixel_ops, bitblt, draw_char, draw_graphics,
+// draw_sprite) and the srn_ functions in this file work on the display
+// picked with sh1107_select().  The sh1107_ refresh functions take the
+// display, so two panels on separate transports can both have a refresh
+// on the wire at once:
+//
+//   sh1107_select(&left);  ... draw ...
+//   sh1107_select(&right); ... draw ...
+//   sh1107_refresh_async(&left);
+//   sh1107_refresh_async(&right);
+//
+// A display without pixel buffers, from sh1107_init(this, NULL), takes
+// commands and is drawn a page at a time by srn_pages.c.  Building with
+// SRN_NO_DEFAULT_FRAMEBUFFER makes srn_default_display such a display, so
+// firmware that only renders pages has no 2 KB buffer at all.
+
+struct srn_transport;
+struct srn_mirror;
+
+// one command or data transfer of an asynchronous refresh
+typedef struct srn_segment {
+  const uint8_t *buf;
+  int num;
+  bool cmd;
+} srn_segment_t;
+
+typedef struct srn_layer {
+  bool enabled;
+  srn_layer_op_t op;
+} srn_layer_t;
+
+typedef struct sh1107 {
+  struct srn_transport *transport;
+  srn_pixels_t *pixels;          // the buffer drawn into, a layer with layers
+  srn_pixels_t *output;          // the buffer sent to the panel
+#if SRN_NUM_LAYERS > 1
+  srn_pixels_t *layer_pixels;    // SRN_NUM_LAYERS buffers
+  srn_layer_t layers[SRN_NUM_LAYERS];
+#endif
+  // per page span of changed columns, see DIRTY TRACKING
+  uint8_t dirty_min[16];
+  uint8_t dirty_max[16];
+  // hardware scroll, see srn_hw_scroll_pages()
+  int page_offset;
+  bool start_line_pending;
+  bool hw_scroll_enabled;
+  bool pumped;                   // the core1 pump sends the frames, see srn_pump.h
+  bool vertical_mode;            // the panel is in vertical addressing mode
+  struct srn_mirror *mirror;     // the frames also go to a host, see srn_mirror.h
+  // SRN_STREAM_FRAME_BYTES for the frame being sent, encoded by
+  // srn_encode.c.  It is a copy, so the pixel buffers can change during an
+  // asynchronous refresh.  NULL without pixel buffers.
+  uint8_t *stream;
+  // asynchronous refresh on a transport without streams, see
+  // srn_refresh_async()
+  srn_segment_t segments[33];
+  int num_segments;
+  volatile int next_segment;
+  volatile bool async_busy;
+#ifdef SRN_PERF
+  uint64_t perf_send_ns;         // when the transfer in flight started
+#endif
+} sh1107_t;
+
+// pixel buffers a display needs: one per layer plus the composite
+#if SRN_NUM_LAYERS > 1
+#define SRN_DISPLAY_BUFFERS (SRN_NUM_LAYERS + 1)
+#else
+#define SRN_DISPLAY_BUFFERS 1
+#endif
+
+// the memory of a display with pixel buffers, owned by the caller of
+// sh1107_init().  The pixels are aligned so the columns can be used as
+// words in the column-major layout.
+typedef struct sh1107_buffers {
+  srn_pixels_t pixels[SRN_DISPLAY_BUFFERS] __attribute__((aligned(4)));
+  uint8_t stream[SRN_STREAM_FRAME_BYTES];
+} sh1107_buffers_t;
+
+extern sh1107_t srn_default_display;
+
+// the display the drawing functions work on
+extern sh1107_t *srn_display;
+
+// srn_display->pixels, kept in its own variable so a pixel access is one
+// load away
+extern srn_pixels_t *srn_draw_pixels;
+
+// Sets up a display over buffers owned by the caller.  The pixel buffers
+// are cleared and the whole screen is marked dirty.  With buffers NULL the
+// display has no pixel buffers: the drawing and refresh functions must
+// not be used on it, only the commands and srn_pages.h.  The display has
+// no transport until sh1107_set_transport().
+void sh1107_init(sh1107_t *this, sh1107_buffers_t *buffers);
 
-//send the current display_pixels to the display.
+// Makes this the display the drawing functions work on.  Returns the
+// display selected before.
+sh1107_t *sh1107_select(sh1107_t *this);
+
+// Sets the transport of a display (see sh1107_transport.h).
+void sh1107_set_transport(sh1107_t *this, struct srn_transport *transport);
+
+// The refresh functions below for any display, selected or not.
+void sh1107_refresh(sh1107_t *this);
+void sh1107_refresh_region(sh1107_t *this, int minX, int minY, int maxX, int maxY);
+void sh1107_refresh_full(sh1107_t *this);
+// Like sh1107_refresh_region() for a span of columns in each page, from
+// span_min[j] to span_max[j], in one transfer.  Returns false if nothing
+// was sent.
+bool sh1107_refresh_spans(sh1107_t *this, const uint8_t span_min[16],
+                          const uint8_t span_max[16]);
+bool sh1107_refresh_async(sh1107_t *this);
+bool sh1107_refresh_busy(sh1107_t *this);
+void sh1107_refresh_wait(sh1107_t *this);
+void sh1107_composite_dirty(sh1107_t *this);
+
+// LAYERS
+// The pixel buffer drawn into.  With layers, the layer picked with
+// srn_select_layer().
+#define srn_display_pixels (*srn_draw_pixels)
+
+// Picks the layer of the selected display drawn into, 0 by default.
+void srn_select_layer(int layer);
+
+// Enables or disables a layer and sets how it is combined.  All layers
+// start enabled with SRN_LAYER_OR.  The whole screen is marked dirty.
+void srn_set_layer(int layer, bool enabled, srn_layer_op_t op);
+
+// Composites the dirty spans into the buffer that is sent.  The refresh
+// functions call it; it does nothing with one layer.
+void srn_composite_dirty();
+
+// the buffer the refresh sends, the composited layers or the only layer
+#define SRN_OUTPUT_PIXELS (*srn_display->output)
+
+// the byte holding rows page*8 to page*8+7 of column col
+#define SRN_PAGE_BYTE(_PAGE, _COL) SRN_FB_BYTE(srn_display_pixels, _PAGE, _COL)
+
+// DIRTY TRACKING
+// Every function that writes to srn_display_pixels records the span of 
+// columns it changed in each page.  srn_refresh() only sends those spans
+// to the SH1107.  A page is clean when srn_dirty_min[page] > srn_dirty_max[page].
+// Code that writes to srn_display_pixels directly must call one of the
+// mark functions below or use srn_refresh_full().  The spans are those of
+// the selected display.
+#define srn_dirty_min (srn_display->dirty_min)
+#define srn_dirty_max (srn_display->dirty_max)
+
+// marks columns col_min to col_max inclusive of one page as changed.
+static inline void srn_mark_dirty(int page, int col_min, int col_max) {
+  if (col_min < srn_dirty_min[page]) srn_dirty_min[page] = col_min;
+  if (col_max > srn_dirty_max[page]) srn_dirty_max[page] = col_max;
+}
+
+// marks every page touched by the pixel rectangle as changed.  Bounds are
+// inclusive and must be inside the display.
+static inline void srn_mark_dirty_rect(int minX, int minY, int maxX, int maxY) {
+  for (int page = minY >> 3; page <= maxY >> 3; page++) {
+    srn_mark_dirty(page, minX, maxX);
+  }
+}
+
+// marks the whole display as changed
+void srn_mark_all_dirty();
+
+//send the changed parts of display_pixels to the display.
 void srn_refresh();
 
-// full screen fast clear
+// sends only the changed parts of display_pixels inside the rectangle
+// minX, minY to maxX, maxY inclusive.  Changes elsewhere are kept for a
+// later refresh.  Used by the refresh scheduler in srn_sched.h.
+void srn_refresh_region(int minX, int minY, int maxX, int maxY);
+
+// send all of display_pixels to the display regardless of what changed.
+// Use this to recover if the display and the pixel buffer get out of sync.
+void srn_refresh_full();
+
+// ASYNCHRONOUS REFRESH
+// srn_refresh_async() takes a snapshot of the changed parts of display_pixels
+// and starts sending them in the background, so the next frame can be drawn
+// while this one is on the wire.  It returns false if nothing had changed.
+// Only one refresh is in flight at a time; a new one first waits for the
+// last.  srn_refresh_busy() tells if it is still sending and
+// srn_refresh_wait() waits for it to finish.  All other srn_ functions
+// that talk to the SH1107 wait as well.
+bool srn_refresh_async();
+bool srn_refresh_busy();
+void srn_refresh_wait();
+
+// HARDWARE SCROLL
+// Scrolls the whole screen up (n > 0) or down (n < 0) by n pages of 8 rows
+// by moving the SH1107 display start line instead of resending the screen.
+// srn_display_pixels is moved to match and the exposed pages are cleared,
+// so only those pages are sent by the next refresh.  Returns false without
+// changing anything if hardware scrolling is disabled, the core1 pump is
+// running or there is more than one layer; the caller then has to scroll
+// in software.
+// scroll_screen_region() and scroll_text() use it for full screen regions.
+bool srn_hw_scroll_pages(int n);
+
+// Hardware scrolling is enabled by default.
+void srn_enable_hw_scroll(bool enable);
+
+// full screen fast clear of the layer drawn into
 void srn_fast_clear();
 
-// This function inits the SPI interface, turns the entire dislay white
+// This function inits the SPI interface on the Tiny2040 pins and selects it
+// as the transport of the selected display (see sh1107_transport.h and
+// sh1107_pico.h for other wiring), turns the entire dislay white
 // and then clears the display.  Turning the display wall white is used
 // as an indicator that the interface is working and can be remove if desired.
 void init_sh1107_SPI();
 
 // this is a macro that can be used to write to any pixel on the screen.
 #define PUT_PIXEL(_X, _Y, _B) 				\
-  srn_display_pixels[(_Y)>>3][(_X)] =  ((_B) == 0) ?	\
-  srn_display_pixels[(_Y)>>3][(_X)] & ~(1 << ((_Y) & 7)) :	\
-  srn_display_pixels[(_Y)>>3][(_X)] |  (1 << ((_Y) & 7))
+  (srn_mark_dirty((_Y)>>3, (_X), (_X)),			\
+  SRN_PAGE_BYTE((_Y)>>3, (_X)) =  ((_B) == 0) ?		\
+  SRN_PAGE_BYTE((_Y)>>3, (_X)) & ~(1 << ((_Y) & 7)) :	\
+  SRN_PAGE_BYTE((_Y)>>3, (_X)) |  (1 << ((_Y) & 7)))
 
 
 
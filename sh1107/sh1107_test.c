@@ -33,11 +33,11 @@ void randomize() {
   int lower = 0;
   for (int r = 0;  r < 16; r++) {
     for(int c = 0; c < 128; c++) {
-      srn_display_pixels[r][c] = (rand() % (upper - lower + 1)) + lower;
-      srn_display_pixels[r][c] |= 0x1;
+      SRN_PAGE_BYTE(r, c) = (rand() % (upper - lower + 1)) + lower;
+      SRN_PAGE_BYTE(r, c) |= 0x1;
     }
   }
-  srn_refresh();
+  srn_refresh_full();
 }
 
 
@@ -153,16 +153,18 @@ while (1) {
     srn_fast_clear();  // clear the whole screen
     l = 0;
     while (l < 64) {
-      char pl[256];
       // measure the time to print a line to the screen
       t1 = to_us_since_boot(get_absolute_time());
-      sprintf(pl, "\n%s %d",test, l);
-      srn_print(&csr1, pl);
+      write_char_next(&csr1, '\n');
+      srn_print(&csr1, test);
+      write_char_next(&csr1, ' ');
+      srn_print_int(&csr1, l, 0, 0);
       srn_refresh();
       t2 = to_us_since_boot(get_absolute_time());
       start_blinking(true, false, false, 1);
-      sprintf(pl, "ref: %d\n", t2 - t1);
-      srn_print(&csr2, pl);
+      srn_print(&csr2, "ref: ");
+      srn_print_int(&csr2, t2 - t1, 0, 0);
+      write_char_next(&csr2, '\n');
       if (l % 16 == 15) {
         srn_refresh();
         start_blinking(true, true, true, 5);      
@@ -174,18 +176,19 @@ while (1) {
     srn_fast_clear();  // clear the whole screen
     l = 0;
     while (l < 64) {
-      char pl[256];
       // measure the time to print a line to the screen
       t1 = to_us_since_boot(get_absolute_time());
-      sprintf(pl, "%s %d",test, l);
       scroll_text(&csr1,-1);
       start_char_at(&csr1,0,0);
-      srn_print(&csr1, pl);
+      srn_print(&csr1, test);
+      write_char_next(&csr1, ' ');
+      srn_print_int(&csr1, l, 0, 0);
       srn_refresh();
       t2 = to_us_since_boot(get_absolute_time());
       start_blinking(true, false, false, 1);
-      sprintf(pl, "ref: %d\n", t2 - t1);
-      srn_print(&csr2, pl);
+      srn_print(&csr2, "ref: ");
+      srn_print_int(&csr2, t2 - t1, 0, 0);
+      write_char_next(&csr2, '\n');
       if (l % 16 == 15) {
         srn_refresh();
         start_blinking(true, true, true, 5);      
@@ -279,23 +282,21 @@ while (1) {
     map_autoscroll_bar_window(&gsras, 1.0, -1.0, 0, 0, 127, 63);
     srn_refresh(); 
 
-    char val_str[32];
-
     t1 = to_us_since_boot(get_absolute_time());
 
     l = 0;
     set_leds(false, false, true);
     while(l < 500) {
       draw_next_as_line(&gsras, sint[(l) & 0x3F][1]);
-      sprintf(val_str, "\n% 6.4f", sint[(l) & 0x3F][1]);
-      srn_print(&csr1, val_str);
+      write_char_next(&csr1, '\n');
+      srn_print_float(&csr1, sint[(l) & 0x3F][1], 4, 6, SRN_FMT_SPACE);
       if (0 == (l & 0xF)) {
         t2 = to_us_since_boot(get_absolute_time());
-        sprintf(val_str, "\n%d", t2 - t1);
-        srn_print(&csr2, val_str);
+        write_char_next(&csr2, '\n');
+        srn_print_int(&csr2, t2 - t1, 0, 0);
         t1 = t2;
       }
-      srn_refresh();
+      srn_refresh_async();
       if (0 == (l & 0xFF)) {
         clear_window(&gsras);
       }
@@ -306,15 +307,15 @@ while (1) {
     set_leds(false, false, true);
     while(l < 500) {
       draw_next_as_bar(&gsras, sint[(l) & 0x3F][1]);
-      sprintf(val_str, "\n% 6.4f", sint[(l) & 0x3F][1]);
-      srn_print(&csr1, val_str);
+      write_char_next(&csr1, '\n');
+      srn_print_float(&csr1, sint[(l) & 0x3F][1], 4, 6, SRN_FMT_SPACE);
       if (0 == (l & 0xF)) {
         t2 = to_us_since_boot(get_absolute_time());
-        sprintf(val_str, "\n%d", t2 - t1);
-        srn_print(&csr2, val_str);
+        write_char_next(&csr2, '\n');
+        srn_print_int(&csr2, t2 - t1, 0, 0);
         t1 = t2;
       }
-      srn_refresh();
+      srn_refresh_async();
       if (0 == (l & 0xFF)) {
         clear_window(&gsras);
       }
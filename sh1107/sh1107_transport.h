@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* sh1107_transport.h
+ * The transport is the only path from the driver to the SH1107.  sh1107_spi.c
+ * builds the command and data bytes and hands them to the transport, which
+ * owns the SPI port, the D/C and CS pins and any DMA channels.  The RP2040
+ * transport is in sh1107_pico.c.  Any other implementation, such as a fake
+ * on a Linux host, only has to fill in this structure and pass it to
+ * sh1107_set_transport(), or srn_set_transport() for the selected display.
+ * Each display has its own transport.
+ */
+
+#ifndef SH1107_TRANSPORT_H
+#define SH1107_TRANSPORT_H
+
+#include "sh1107_spi.h"
+
+typedef struct srn_transport {
+  // Sends num bytes and returns when they are on the wire.  cmd selects
+  // command bytes (D/C low) or pixel data (D/C high).
+  void (*write)(void *ctx, const uint8_t *buf, int num, bool cmd);
+  // Starts sending num bytes and returns without waiting.  The transport
+  // must call sh1107_transfer_done(display) once the last byte is on the
+  // wire.  It may call it before returning if the transfer finished
+  // immediately.  buf stays valid until then.
+  void (*start_write)(void *ctx, const uint8_t *buf, int num, bool cmd);
+  // Optional, NULL if the transport can not take streams.  Starts sending
+  // a stream of tagged command and data segments that ends with one frame
+  // end (see srn_stream.h) and returns without waiting.  The transport
+  // drives D/C and CS from the tags and calls sh1107_transfer_done() once
+  // the frame is on the wire.  Every refresh is then sent as one transfer
+  // (see srn_encode.h).
+  void (*start_stream)(void *ctx, const uint8_t *stream, int num);
+  // passed back as the first parameter of write and start_write
+  void *ctx;
+  // the display using this transport, set by sh1107_set_transport()
+  sh1107_t *display;
+} srn_transport_t;
+
+// Selects the transport of the selected display.
+void srn_set_transport(srn_transport_t *transport);
+
+// Returns the transport of the selected display.
+srn_transport_t *srn_get_transport();
+
+// Called by the transport, usually from an interrupt handler, when the
+// transfer started with start_write has finished.
+void sh1107_transfer_done(sh1107_t *display);
+
+// sh1107_transfer_done() for srn_default_display
+void srn_transfer_done();
+
+// Sends the changed spans of a pixel buffer to a display as one frame,
+// waits for it to go and marks them clean.  The refresh uses it for the output buffer
+// and the core1 pump in srn_pump.c for its own copies of the frame.
+void sh1107_send_spans(sh1107_t *this, srn_pixels_t pixels,
+                       uint8_t dirty_min[16], uint8_t dirty_max[16]);
+
+// Sends a stream that ends with one frame end (see srn_stream.h) to a
+// display, in one transfer if the transport takes streams.  With async it
+// returns once the transfer has started and stream must stay unchanged
+// until sh1107_refresh_busy() is false.  srn_pages.c sends its pages
+// with it.
+void sh1107_send_stream(sh1107_t *this, const uint8_t *stream, int num, bool async);
+
+// sh1107_send_spans() to the selected display
+void srn_send_spans(srn_pixels_t pixels, uint8_t dirty_min[16], uint8_t dirty_max[16]);
+
+#endif
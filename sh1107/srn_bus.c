@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_port.h"
+#include "srn_bus.h"
+
+// PLATFORM
+// lock_bus() and unlock_bus() guard the owner and the queue of every bus.
+// They are held for a few instructions and never across a start().
+
+#if PICO_ON_DEVICE
+
+#include "hardware/sync.h"
+
+// a hardware spin lock, which also masks interrupts on the core holding it
+static spin_lock_t *bus_lock;
+
+static void init_lock() {
+  if (bus_lock == NULL) {
+    bus_lock = spin_lock_instance(spin_lock_claim_unused(true));
+  }
+}
+
+static uint32_t lock_bus() {
+  return spin_lock_blocking(bus_lock);
+}
+
+static void unlock_bus(uint32_t save) {
+  spin_unlock(bus_lock, save);
+}
+
+#else // host build
+
+#include <pthread.h>
+
+static pthread_mutex_t bus_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void init_lock() {}
+
+static uint32_t lock_bus() {
+  pthread_mutex_lock(&bus_mutex);
+  return 0;
+}
+
+static void unlock_bus(uint32_t save) {
+  (void)save;
+  pthread_mutex_unlock(&bus_mutex);
+}
+
+#endif
+
+// TURNS
+// The port is handed straight from one client to the next, so it is only
+// free while nobody is waiting.
+
+void srn_bus_init(srn_bus_t *bus) {
+  init_lock();
+  memset(bus, 0, sizeof(*bus));
+}
+
+void srn_bus_start(srn_bus_t *bus, srn_bus_client_t *client) {
+  uint32_t save = lock_bus();
+  bool free = bus->owner == NULL;
+  if (free) {
+    bus->owner = client;
+  } else {
+    client->next = NULL;
+    if (bus->tail) bus->tail->next = client;
+    else bus->head = client;
+    bus->tail = client;
+  }
+  unlock_bus(save);
+  if (free) client->start(client);
+}
+
+bool srn_bus_try_claim(srn_bus_t *bus, srn_bus_client_t *client) {
+  uint32_t save = lock_bus();
+  bool free = bus->owner == NULL;
+  if (free) bus->owner = client;
+  unlock_bus(save);
+  return free;
+}
+
+void srn_bus_release(srn_bus_t *bus) {
+  uint32_t save = lock_bus();
+  srn_bus_client_t *next = bus->head;
+  if (next) {
+    bus->head = next->next;
+    if (bus->head == NULL) bus->tail = NULL;
+  }
+  bus->owner = next;
+  unlock_bus(save);
+  if (next) next->start(next);
+}
@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* srn_bus.h
+ * Takes turns on one SPI port shared by the transports of several panels,
+ * each with its own CS pin.  A transfer started while another panel holds
+ * the port is queued instead of waited for, and starts from
+ * srn_bus_release() when the port comes free, so a transfer can be
+ * started from an interrupt handler or alarm, such as from
+ * sh1107_transfer_done().  The port changes hands under a spin lock (a
+ * mutex on the host), so both cores and interrupt handlers can start
+ * transfers at once.
+ *
+ *   srn_bus_client_t client = {start_transfer, this};
+ *   srn_bus_start(&bus, &client);   // start_transfer() now or later
+ *   ...
+ *   srn_bus_release(&bus);          // when the transfer is on the wire
+ */
+
+#ifndef SRN_BUS_H
+#define SRN_BUS_H
+
+#include "sh1107_port.h"
+
+typedef struct srn_bus_client {
+  // starts the transfer of the client, which holds the port until it
+  // calls srn_bus_release()
+  void (*start)(struct srn_bus_client *client);
+  void *ctx;
+  struct srn_bus_client *next;  // the next client waiting for the port
+} srn_bus_client_t;
+
+typedef struct srn_bus {
+  srn_bus_client_t *volatile owner;  // the client holding the port, or NULL
+  srn_bus_client_t *head;            // clients waiting for the port, in order
+  srn_bus_client_t *tail;
+} srn_bus_t;
+
+// Sets up an idle bus, and the lock the buses share the first time.
+void srn_bus_init(srn_bus_t *bus);
+
+// Starts the transfer of client now if the port is free, or once the
+// clients ahead of it have released it.  A client can only wait once.
+void srn_bus_start(srn_bus_t *bus, srn_bus_client_t *client);
+
+// Takes the port for client if nobody holds it, for a transfer that is
+// sent in place.  Returns false if it is held.
+bool srn_bus_try_claim(srn_bus_t *bus, srn_bus_client_t *client);
+
+// Gives up the port and starts the first client waiting for it, if any.
+void srn_bus_release(srn_bus_t *bus);
+
+#endif
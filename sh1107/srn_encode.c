@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_port.h"
+#include "sh1107_spi.h"
+#include "srn_stream.h"
+#include "srn_encode.h"
+
+// PLANS
+
+bool sh1107_plan_frame(const sh1107_t *this, const uint8_t dirty_min[16],
+                       const uint8_t dirty_max[16], srn_plan_t *plan) {
+  memset(plan, 0, sizeof(*plan));
+  // the vertical run as column * 16 + page on the panel
+  int first = 16 * 128;
+  int last = -1;
+  int page_bytes = 0;
+  for (int j = 0; j < 16; j++) {
+    if (dirty_min[j] > dirty_max[j]) continue; // nothing changed in this page
+    int p = (j + this->page_offset) & 15;
+    plan->pages++;
+    page_bytes += 3 + dirty_max[j] - dirty_min[j] + 1;
+    if (dirty_min[j] * 16 + p < first) first = dirty_min[j] * 16 + p;
+    if (dirty_max[j] * 16 + p > last) last = dirty_max[j] * 16 + p;
+  }
+  plan->cmd_bytes = this->start_line_pending ? 2 : 0;
+  if (plan->pages == 0) return this->start_line_pending;
+
+  int run_bytes = last - first + 1;
+  int page_cost = page_bytes + (2 * plan->pages - 1) * SRN_ENCODE_SWITCH_COST;
+  int run_cost = 3 + run_bytes + SRN_ENCODE_SWITCH_COST;
+  // switching the addressing mode costs a command byte
+  if (this->vertical_mode) page_cost++; else run_cost++;
+
+  plan->vertical = run_cost < page_cost;
+  if (plan->vertical) {
+    plan->start_col = first >> 4;
+    plan->start_page = first & 15;
+    plan->cmd_bytes += 3;
+    plan->data_bytes = run_bytes;
+    plan->dc_switches = 1;
+  } else {
+    plan->cmd_bytes += 3 * plan->pages;
+    plan->data_bytes = page_bytes - 3 * plan->pages;
+    plan->dc_switches = 2 * plan->pages - 1;
+  }
+  if (plan->vertical != this->vertical_mode) plan->cmd_bytes++;
+  return true;
+}
+
+// ENCODING
+
+static void put_col_page(srn_stream_t *stream, int col, int page) {
+  uint8_t cmd[3];
+  cmd[0] = 0x10 | ((col >> 4) & 0x7);
+  cmd[1] = 0x00 | (col & 0xF);
+  cmd[2] = 0xB0 | (page & 0xF);
+  srn_stream_cmd(stream, cmd, 3);
+}
+
+// the changed span of each changed page, in page addressing mode
+static void encode_pages(sh1107_t *this, srn_pixels_t pixels, const uint8_t dirty_min[16],
+                         const uint8_t dirty_max[16], srn_stream_t *stream) {
+  for (int j = 0; j < 16; j++) {
+    int col_min = dirty_min[j];
+    int col_max = dirty_max[j];
+    if (col_min > col_max) continue;
+    int num = col_max - col_min + 1;
+    put_col_page(stream, col_min, j + this->page_offset);
+    uint8_t *dst = srn_stream_data_space(stream, num);
+    if (dst == NULL) return;
+#ifdef SRN_COLUMN_MAJOR
+    for (int i = 0; i < num; i++) {
+      dst[i] = SRN_FB_BYTE(pixels, j, col_min + i);
+    }
+#else
+    memcpy(dst, &pixels[j][col_min], num);
+#endif
+  }
+}
+
+// one run in vertical addressing mode, down the pages of each column on
+// the panel.  Panel page p shows page p - page_offset of the buffer.
+static void encode_run(sh1107_t *this, srn_pixels_t pixels, const srn_plan_t *plan,
+                       srn_stream_t *stream) {
+  put_col_page(stream, plan->start_col, plan->start_page);
+  uint8_t *dst = srn_stream_data_space(stream, plan->data_bytes);
+  if (dst == NULL) return;
+  int col = plan->start_col;
+  int p = plan->start_page;
+  for (int i = 0; i < plan->data_bytes; i++) {
+    *dst++ = SRN_FB_BYTE(pixels, (p - this->page_offset) & 15, col);
+    if (++p == 16) {
+      p = 0;
+      col++;
+    }
+  }
+}
+
+bool sh1107_encode_frame(sh1107_t *this, srn_pixels_t pixels, uint8_t dirty_min[16],
+                         uint8_t dirty_max[16], srn_stream_t *stream, srn_plan_t *plan) {
+  srn_plan_t own_plan;
+  if (plan == NULL) plan = &own_plan;
+  if (!sh1107_plan_frame(this, dirty_min, dirty_max, plan)) return false;
+
+  // commands in a row share one segment
+  if (this->start_line_pending) {
+    uint8_t cmd[2] = {0xDC, (this->page_offset * 8) & 0x7F};
+    srn_stream_cmd(stream, cmd, 2);
+    this->start_line_pending = false;
+  }
+  if (plan->pages > 0) {
+    if (plan->vertical != this->vertical_mode) {
+      uint8_t cmd = plan->vertical ? 0x21 : 0x20;
+      srn_stream_cmd(stream, &cmd, 1);
+      this->vertical_mode = plan->vertical;
+    }
+    if (plan->vertical) {
+      encode_run(this, pixels, plan, stream);
+    } else {
+      encode_pages(this, pixels, dirty_min, dirty_max, stream);
+    }
+  }
+  srn_stream_end(stream);
+  for (int j = 0; j < 16; j++) {
+    dirty_min[j] = 0xFF;
+    dirty_max[j] = 0;
+  }
+  return true;
+}
@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* srn_encode.h
+ * The frame encoder.  Every refresh turns the changed spans of a display
+ * into one stream of command and data segments (see srn_stream.h), which
+ * the transport sends as one transfer with CS held low.  Commands that
+ * follow each other share a segment, so D/C only changes between commands
+ * and pixel data.
+ *
+ * The encoder picks one of two plans:
+ *   page      a set column and page command and the changed span of each
+ *             changed page, in page addressing mode.
+ *   vertical  one set column and page command and a single run of pixel
+ *             data in vertical addressing mode, where the SH1107 steps
+ *             down the pages of a column and then on to the next column.
+ *             The run covers every changed byte and any unchanged ones
+ *             between them, so a full frame is one command and 2 KB of
+ *             data.
+ * It takes the plan with fewer bytes on the wire, counting each D/C change
+ * as SRN_ENCODE_SWITCH_COST bytes.  The addressing mode is only sent when
+ * it changes, and the display keeps track of it.
+ *
+ * The plan can be looked at without sending anything:
+ *
+ *   srn_plan_t plan;
+ *   sh1107_plan_frame(srn_display, srn_display->dirty_min,
+ *                     srn_display->dirty_max, &plan);
+ *   printf("%d bytes\n", plan.cmd_bytes + plan.data_bytes);
+ *
+ * and srn_stream_decode() plays the encoded stream back as the exact wire
+ * sequence.
+ */
+
+#ifndef SRN_ENCODE_H
+#define SRN_ENCODE_H
+
+#include "sh1107_spi.h"
+#include "srn_stream.h"
+
+// the cost of a D/C change in bytes of wire time.  The SPI transport has
+// to let the FIFO drain before it moves the pin, and a stream segment
+// takes a two byte header.
+#ifndef SRN_ENCODE_SWITCH_COST
+#define SRN_ENCODE_SWITCH_COST 4
+#endif
+
+typedef struct srn_plan {
+  bool vertical;        // one run in vertical addressing mode, else by page
+  int start_col;        // where the vertical run starts
+  int start_page;       // on the panel, after the hardware scroll offset
+  int pages;            // pages sent by the page plan
+  int cmd_bytes;        // on the wire
+  int data_bytes;
+  int dc_switches;      // changes of D/C within the frame
+} srn_plan_t;
+
+// Plans the frame for the given changed spans of a display without
+// changing anything.  Returns false if there is nothing to send.
+bool sh1107_plan_frame(const sh1107_t *this, const uint8_t dirty_min[16],
+                       const uint8_t dirty_max[16], srn_plan_t *plan);
+
+// Encodes the changed spans of pixels as one frame in stream, including a
+// pending start line command, and marks the spans clean.  plan may be NULL.
+// Returns false if there was nothing to send.  The stream must have room
+// for SRN_STREAM_FRAME_BYTES.
+bool sh1107_encode_frame(sh1107_t *this, srn_pixels_t pixels, uint8_t dirty_min[16],
+                         uint8_t dirty_max[16], srn_stream_t *stream, srn_plan_t *plan);
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_port.h"
+#include "srn_fonts.h"
+
+// The packs are generated with tools/font_compiler:
+//   font_compiler -s 2 -n srn_font8x8_2x -o font8x8_2x.h builtin
+//   font_compiler -s 3 -r 32-58 -n srn_font8x8_3x_digits -o font8x8_3x_digits.h builtin
+#include "font8x8_2x.h"
+#include "font8x8_3x_digits.h"
+
+typedef struct font_entry {
+  const char *name;
+  const srn_font_t *font;
+} font_entry_t;
+
+static const font_entry_t builtin_fonts[] = {
+  {"8x8", &srn_font8x8},
+  {"8x8_prop", &srn_font8x8_prop},
+  {"16x16", &srn_font8x8_2x},
+  {"24x24_digits", &srn_font8x8_3x_digits},
+};
+
+static font_entry_t registered_fonts[SRN_FONTS_MAX_REGISTERED];
+
+bool srn_font_register(const char *name, const srn_font_t *font) {
+  for (int i = 0; i < SRN_FONTS_MAX_REGISTERED; i++) {
+    if (registered_fonts[i].name == NULL ||
+        strcmp(registered_fonts[i].name, name) == 0) {
+      registered_fonts[i].name = name;
+      registered_fonts[i].font = font;
+      return true;
+    }
+  }
+  return false;
+}
+
+const srn_font_t *srn_font_find(const char *name) {
+  // registered fonts first, so a built in one can be replaced
+  for (int i = 0; i < SRN_FONTS_MAX_REGISTERED; i++) {
+    if (registered_fonts[i].name != NULL &&
+        strcmp(registered_fonts[i].name, name) == 0) {
+      return registered_fonts[i].font;
+    }
+  }
+  for (int i = 0; i < sizeof(builtin_fonts) / sizeof(builtin_fonts[0]); i++) {
+    if (strcmp(builtin_fonts[i].name, name) == 0) return builtin_fonts[i].font;
+  }
+  return NULL;
+}
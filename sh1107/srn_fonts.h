@@ -0,0 +1,44 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* srn_fonts.h
+ * Font packs and a registry to find them by name.  The packs are made
+ * from BDF or PSF fonts, or from the 8x8 font scaled up, by
+ * tools/font_compiler.c.  Their glyphs are kept in flash in the page
+ * layout of srn_display_pixels, so text of any size is drawn by copying
+ * page bytes, never by scaling at run time.
+ *
+ * Built in fonts:
+ *   "8x8"         srn_font8x8
+ *   "8x8_prop"    srn_font8x8_prop
+ *   "16x16"       srn_font8x8_2x, the 8x8 font at twice the size
+ *   "24x24_digits" srn_font8x8_3x_digits, space to ':' at three times
+ *
+ * A char_screen_region_t uses a font with set_char_font() (see
+ * draw_char.h).  draw_text() takes any of them.
+ */
+
+#ifndef SRN_FONTS_H
+#define SRN_FONTS_H
+
+#include "draw_char.h"
+
+// number of fonts that can be added with srn_font_register()
+#ifndef SRN_FONTS_MAX_REGISTERED
+#define SRN_FONTS_MAX_REGISTERED 4
+#endif
+
+extern const srn_font_t srn_font8x8_2x;
+extern const srn_font_t srn_font8x8_3x_digits;
+
+// Adds a font made with tools/font_compiler under name.  The name is not
+// copied.  Returns false if the registry is full.
+bool srn_font_register(const char *name, const srn_font_t *font);
+
+// Returns the font called name, or NULL.
+const srn_font_t *srn_font_find(const char *name);
+
+#endif
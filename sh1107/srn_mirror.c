@@ -0,0 +1,337 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_port.h"
+#include "sh1107_spi.h"
+#include "srn_mirror.h"
+
+#ifndef SH1107_HOST
+#if LIB_PICO_STDIO_USB
+#include "tusb.h"
+#else
+#include "hardware/uart.h"
+#endif
+#endif
+
+// while the screen is still, the last frame goes again as a key frame
+// this often, for a viewer that has just started
+#define IDLE_KEY_NS 1000000000ull
+
+// CODEC
+
+int srn_mirror_encode(const uint8_t *delta, int num, uint8_t *out) {
+  uint8_t *o = out;
+  int lit = -1; // the control byte of the open literal run
+  int i = 0;
+  while (i < num) {
+    uint8_t b = delta[i];
+    int max = b == 0 ? 128 : 66;
+    int n = 1;
+    while (i + n < num && n < max && delta[i + n] == b) n++;
+    bool lit_open = lit >= 0 && out[lit] != 0xFF;
+    if (b == 0 && (n > 1 || !lit_open)) {
+      // a lone zero is cheaper inside an open literal run
+      *o++ = n - 1;
+      lit = -1;
+    } else if (b != 0 && n >= 3) {
+      *o++ = 0x80 | (n - 3);
+      *o++ = b;
+      lit = -1;
+    } else {
+      n = 1;
+      if (lit_open) {
+        out[lit]++;
+      } else {
+        lit = o - out;
+        *o++ = 0xC0;
+      }
+      *o++ = b;
+    }
+    i += n;
+  }
+  return o - out;
+}
+
+bool srn_mirror_decode(const uint8_t *code, int len, uint8_t *frame, int num) {
+  const uint8_t *end = code + len;
+  int i = 0;
+  while (code < end) {
+    uint8_t c = *code++;
+    int n;
+    if ((c & 0x80) == 0) {
+      n = c + 1;
+      if (i + n > num) return false;
+      i += n;
+    } else if ((c & 0x40) == 0) {
+      n = (c & 0x3F) + 3;
+      if (code == end || i + n > num) return false;
+      uint8_t b = *code++;
+      while (n--) frame[i++] ^= b;
+    } else {
+      n = (c & 0x3F) + 1;
+      if (end - code < n || i + n > num) return false;
+      while (n--) frame[i++] ^= *code++;
+    }
+  }
+  return i == num;
+}
+
+// Fletcher-16, with the sums reduced every 256 bytes rather than every byte
+uint16_t srn_mirror_check(const uint8_t *frame, int num) {
+  uint32_t sum1 = 0, sum2 = 0;
+  while (num > 0) {
+    int n = num < 256 ? num : 256;
+    num -= n;
+    while (n--) {
+      sum1 += *frame++;
+      sum2 += sum1;
+    }
+    sum1 %= 255;
+    sum2 %= 255;
+  }
+  return (sum2 << 8) | sum1;
+}
+
+// MIRROR
+
+void srn_mirror_start(srn_mirror_t *this, sh1107_t *display, srn_mirror_write_t write,
+                      void *ctx, int hz) {
+  memset(this, 0, sizeof(*this));
+  this->display = display;
+  this->write = write;
+  this->ctx = ctx;
+  this->interval_ns = hz > 0 ? 1000000000ull / hz : 0;
+  this->key_interval = SRN_MIRROR_KEY_INTERVAL;
+  this->key_pending = true;
+  display->mirror = this;
+}
+
+void srn_mirror_stop(srn_mirror_t *this) {
+  if (this->display->mirror == this) this->display->mirror = NULL;
+  this->out_len = this->out_pos = 0;
+}
+
+void srn_mirror_key(srn_mirror_t *this) {
+  this->key_pending = true;
+}
+
+static void copy_frame(srn_mirror_t *this, srn_pixels_t pixels) {
+#ifdef SRN_COLUMN_MAJOR
+  for (int j = 0; j < 16; j++) {
+    for (int c = 0; c < 128; c++) this->last[j][c] = SRN_FB_BYTE(pixels, j, c);
+  }
+#else
+  memcpy(this->last, pixels, sizeof(this->last));
+#endif
+}
+
+// Codes last, which holds the XOR for a delta or the frame for a key
+// frame, into out.  The caller puts the frame back in last first if it
+// needs the check.
+static void queue(srn_mirror_t *this, bool key) {
+  uint8_t *out = this->out;
+  int len = srn_mirror_encode(&this->last[0][0], SRN_MIRROR_FRAME, out + SRN_MIRROR_HEADER);
+  out[0] = SRN_MIRROR_SYNC0;
+  out[1] = SRN_MIRROR_SYNC1;
+  out[2] = ++this->seq;
+  out[3] = key ? SRN_MIRROR_KEY : 0;
+  out[4] = len & 0xFF;
+  out[5] = len >> 8;
+  this->out_len = SRN_MIRROR_HEADER + len + SRN_MIRROR_CHECK;
+  this->out_pos = 0;
+  if (key) {
+    this->key_pending = false;
+    this->since_key = 0;
+    this->stats.keys++;
+  } else {
+    this->since_key++;
+  }
+  this->stats.frames++;
+  this->stats.bytes += this->out_len;
+  this->last_ns = srn_time_ns();
+}
+
+static void put_check(srn_mirror_t *this) {
+  uint16_t check = srn_mirror_check(&this->last[0][0], SRN_MIRROR_FRAME);
+  this->out[this->out_len - 2] = check & 0xFF;
+  this->out[this->out_len - 1] = check >> 8;
+}
+
+static bool drain(srn_mirror_t *this) {
+  while (this->out_pos < this->out_len) {
+    int n = this->write(this->ctx, this->out + this->out_pos, this->out_len - this->out_pos);
+    if (n <= 0) return false;
+    this->out_pos += n;
+  }
+  return true;
+}
+
+bool srn_mirror_frame(srn_mirror_t *this, srn_pixels_t pixels) {
+  if (!drain(this) || srn_time_ns() - this->last_ns < this->interval_ns) {
+    this->stats.skipped++;
+    return false;
+  }
+  bool key = this->key_pending || this->since_key >= this->key_interval;
+  if (key) {
+    copy_frame(this, pixels);
+    queue(this, true);
+  } else {
+    // the XOR goes in place of the last frame, which is not needed again
+    uint8_t changed = 0;
+    for (int j = 0; j < 16; j++) {
+      for (int c = 0; c < 128; c++) {
+        uint8_t d = this->last[j][c] ^ SRN_FB_BYTE(pixels, j, c);
+        this->last[j][c] = d;
+        changed |= d;
+      }
+    }
+    if (changed) queue(this, false);
+    copy_frame(this, pixels);
+    if (!changed) return false;
+  }
+  put_check(this);
+  drain(this);
+  return true;
+}
+
+bool srn_mirror_poll(srn_mirror_t *this) {
+  if (!drain(this)) return false;
+  // the last frame again, with nothing to XOR against
+  if (this->stats.frames > 0 && srn_time_ns() - this->last_ns >= IDLE_KEY_NS) {
+    queue(this, true);
+    put_check(this);
+    return drain(this);
+  }
+  return true;
+}
+
+void srn_mirror_get_stats(const srn_mirror_t *this, srn_mirror_stats_t *stats) {
+  *stats = this->stats;
+}
+
+#ifdef SH1107_HOST
+
+int srn_mirror_stdio_write(void *ctx, const uint8_t *buf, int num) {
+  FILE *f = ctx ? (FILE *)ctx : stdout;
+  int n = fwrite(buf, 1, num, f);
+  fflush(f);
+  return n;
+}
+
+#elif LIB_PICO_STDIO_USB
+
+int srn_mirror_stdio_write(void *ctx, const uint8_t *buf, int num) {
+  // with nobody listening the frames are dropped, and a viewer that
+  // connects later picks up at the next key frame
+  if (!tud_cdc_connected()) return num;
+  int n = tud_cdc_write_available();
+  if (n > num) n = num;
+  if (n > 0) {
+    tud_cdc_write(buf, n);
+    tud_cdc_write_flush();
+  }
+  return n;
+}
+
+#else
+
+// as much as the UART FIFO takes
+int srn_mirror_stdio_write(void *ctx, const uint8_t *buf, int num) {
+  int n = 0;
+  while (n < num && uart_is_writable(uart_default)) uart_putc_raw(uart_default, buf[n++]);
+  return n;
+}
+
+#endif
+
+// VIEWER
+
+void srn_mirror_view_init(srn_mirror_view_t *this) {
+  memset(this, 0, sizeof(*this));
+}
+
+// Bytes before the sync go out as text.
+static void skip(srn_mirror_view_t *this, int num) {
+  for (int i = 0; i < num; i++) {
+    if (this->text) this->text(this->ctx, this->buf[i]);
+  }
+  this->len -= num;
+  memmove(this->buf, this->buf + num, this->len);
+}
+
+// Looks at the start of buf.  Returns 1 if a frame was applied, 2 if one
+// was taken but could not be applied, 0 if more bytes are needed and -1
+// if the start of buf is not a frame.
+static int take_frame(srn_mirror_view_t *this) {
+  const uint8_t *p = this->buf;
+  if (this->len >= 1 && p[0] != SRN_MIRROR_SYNC0) return -1;
+  if (this->len >= 2 && p[1] != SRN_MIRROR_SYNC1) return -1;
+  if (this->len < SRN_MIRROR_HEADER) return 0;
+  int len = p[4] | (p[5] << 8);
+  if (len > SRN_MIRROR_MAX_BODY) return -1;
+  int total = SRN_MIRROR_HEADER + len + SRN_MIRROR_CHECK;
+  if (this->len < total) return 0;
+
+  bool key = p[3] & SRN_MIRROR_KEY;
+  if (key) {
+    memset(this->scratch, 0, SRN_MIRROR_FRAME);
+  } else {
+    memcpy(this->scratch, this->frame, SRN_MIRROR_FRAME);
+  }
+  if (!srn_mirror_decode(p + SRN_MIRROR_HEADER, len, this->scratch, SRN_MIRROR_FRAME)) return -1;
+  uint16_t check = p[total - 2] | (p[total - 1] << 8);
+  if (srn_mirror_check(this->scratch, SRN_MIRROR_FRAME) != check) return -1;
+
+  // a good frame, but a delta only applies to the frame before it
+  bool follows = this->synced && p[2] == (uint8_t)(this->seq + 1);
+  this->seq = p[2];
+  this->len -= total;
+  memmove(this->buf, this->buf + total, this->len);
+  if (!key && !follows) {
+    this->synced = false;
+    this->errors++;
+    return 2;
+  }
+  memcpy(this->frame, this->scratch, SRN_MIRROR_FRAME);
+  this->synced = true;
+  this->frames++;
+  return 1;
+}
+
+int srn_mirror_view_feed(srn_mirror_view_t *this, const uint8_t *bytes, int num,
+                         void (*frame_done)(void *ctx, const uint8_t *frame), void *ctx) {
+  int frames = 0;
+  while (num > 0) {
+    int n = (int)sizeof(this->buf) - this->len;
+    if (n > num) n = num;
+    memcpy(this->buf + this->len, bytes, n);
+    this->len += n;
+    bytes += n;
+    num -= n;
+    while (this->len > 0) {
+      // text up to the next sync byte
+      uint8_t *sync = memchr(this->buf, SRN_MIRROR_SYNC0, this->len);
+      if (sync != this->buf) {
+        skip(this, sync ? sync - this->buf : this->len);
+        continue;
+      }
+      int r = take_frame(this);
+      if (r == 0) break;
+      if (r < 0) {
+        // not a frame after all, or a damaged one
+        if (this->len >= SRN_MIRROR_HEADER && this->buf[1] == SRN_MIRROR_SYNC1) this->errors++;
+        skip(this, 1);
+        continue;
+      }
+      if (r == 2) continue;
+      frames++;
+      if (frame_done) frame_done(ctx, this->frame);
+    }
+  }
+  return frames;
+}
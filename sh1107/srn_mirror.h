@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* srn_mirror.h
+ * Mirrors what a display shows to a host, for screenshots, recordings and
+ * remote debugging.  Once a mirror is started, every refresh of the
+ * display also encodes the frame as the XOR against the last frame
+ * mirrored, run-length coded, and queues it for the host.  The queue is
+ * drained through a write function that takes only what fits without
+ * waiting, so the render loop never blocks on the host.  While a frame is
+ * still going out, later refreshes are not mirrored and their changes go
+ * with the next frame that is.
+ *
+ *   static srn_mirror_t mirror;
+ *   stdio_init_all();
+ *   srn_mirror_start(&mirror, srn_display, srn_mirror_stdio_write, NULL, 30);
+ *   ...
+ *   srn_refresh();            // also mirrors the frame
+ *   srn_mirror_poll(&mirror); // any time, to keep the queue moving
+ *
+ * On the Pico srn_mirror_stdio_write() writes to USB CDC when the program
+ * is built with pico_enable_stdio_usb, else to the stdio UART.  On the
+ * host it writes to the FILE * in ctx, stdout if NULL.  tools/mirror_view
+ * shows the frames on the host.
+ *
+ * A frame on the wire:
+ *   0xA5 0x5A    sync
+ *   seq          frame number, one more than the last frame's
+ *   flags        SRN_MIRROR_KEY if the frame is XORed against a blank one
+ *   len          2 bytes, little endian: the length of the body
+ *   body         the run-length coded XOR
+ *   check        2 bytes, little endian: Fletcher-16 of the whole frame
+ *                after decoding, 16 pages of 128 bytes as srn_display_pixels
+ *                holds them in the default layout
+ *
+ * The body is a sequence of runs, each starting with a control byte:
+ *   0nnnnnnn             n + 1 zero bytes, which is everything unchanged
+ *   10nnnnnn b           n + 3 copies of the byte b
+ *   11nnnnnn b0 ... bn   n + 1 bytes as they are
+ * The runs cover the 2048 bytes of the frame exactly.  An unchanged frame
+ * is not sent.  Every key_interval frames one goes as a key frame, so a
+ * viewer that starts late, or loses a frame, picks up again.  Text printed
+ * to stdio goes between the frames and the viewer passes it on; text in
+ * the middle of a frame costs the frames up to the next key frame.
+ */
+
+#ifndef SRN_MIRROR_H
+#define SRN_MIRROR_H
+
+#include "sh1107_spi.h"
+
+#define SRN_MIRROR_SYNC0 0xA5
+#define SRN_MIRROR_SYNC1 0x5A
+#define SRN_MIRROR_KEY 0x01
+
+#define SRN_MIRROR_FRAME 2048
+#define SRN_MIRROR_HEADER 6
+#define SRN_MIRROR_CHECK 2
+// the longest body: nearly every byte in a literal run of 64
+#define SRN_MIRROR_MAX_BODY (SRN_MIRROR_FRAME + SRN_MIRROR_FRAME / 64 + 2)
+#define SRN_MIRROR_MAX_BYTES (SRN_MIRROR_HEADER + SRN_MIRROR_MAX_BODY + SRN_MIRROR_CHECK)
+
+// a key frame at least this often
+#ifndef SRN_MIRROR_KEY_INTERVAL
+#define SRN_MIRROR_KEY_INTERVAL 32
+#endif
+
+// Takes up to num bytes without waiting.  Returns how many it took.
+typedef int (*srn_mirror_write_t)(void *ctx, const uint8_t *buf, int num);
+
+typedef struct srn_mirror_stats {
+  uint32_t frames;     // frames queued, key frames included
+  uint32_t keys;       // key frames queued
+  uint32_t skipped;    // refreshes not mirrored, the queue was busy or too soon
+  uint32_t bytes;      // bytes queued
+} srn_mirror_stats_t;
+
+typedef struct srn_mirror {
+  sh1107_t *display;
+  srn_mirror_write_t write;
+  void *ctx;
+  uint64_t interval_ns;        // at most one frame per interval
+  uint64_t last_ns;
+  int key_interval;
+  int since_key;               // frames since the last key frame
+  bool key_pending;
+  uint8_t seq;
+  srn_mirror_stats_t stats;
+  int out_len;                 // the frame in out still going
+  int out_pos;
+  uint8_t last[16][128];       // the frame the host has, page by page
+  uint8_t out[SRN_MIRROR_MAX_BYTES];
+} srn_mirror_t;
+
+// Mirrors the refreshes of display to write, at most hz frames a second,
+// or every refresh if hz is 0.  The first frame is a key frame.
+void srn_mirror_start(srn_mirror_t *this, sh1107_t *display, srn_mirror_write_t write,
+                      void *ctx, int hz);
+
+// Stops mirroring.  Any frame still queued is dropped.
+void srn_mirror_stop(srn_mirror_t *this);
+
+// Called by every refresh of the display with the frame it sends.
+// Returns true if the frame was queued.
+bool srn_mirror_frame(srn_mirror_t *this, srn_pixels_t pixels);
+
+// Makes the next frame a key frame, for example when a viewer asks for one.
+void srn_mirror_key(srn_mirror_t *this);
+
+// Writes what it can of the queued frame.  It is called at each refresh as
+// well, so it only needs calling while the display is idle.  Call it on
+// the core that refreshes the display: core1 when srn_pump.h sends the
+// frames.  Returns true if the queue is empty.
+bool srn_mirror_poll(srn_mirror_t *this);
+
+void srn_mirror_get_stats(const srn_mirror_t *this, srn_mirror_stats_t *stats);
+
+// The default write function, see above.
+int srn_mirror_stdio_write(void *ctx, const uint8_t *buf, int num);
+
+// CODEC
+// The run-length code on its own, shared with the host tools.
+
+// Codes the num bytes of delta as runs into out, which has room for
+// num + num / 64 + 2 bytes.  Returns the length of the code.
+int srn_mirror_encode(const uint8_t *delta, int num, uint8_t *out);
+
+// XORs the runs in code into the num bytes of frame.  Returns false if the
+// code is damaged or does not cover frame exactly, and frame is then
+// partly changed.
+bool srn_mirror_decode(const uint8_t *code, int len, uint8_t *frame, int num);
+
+uint16_t srn_mirror_check(const uint8_t *frame, int num);
+
+// VIEWER
+// Finds the frames in a byte stream from a mirror and keeps the frame it
+// shows.  Bytes outside frames are text printed by the program.
+
+typedef struct srn_mirror_view {
+  uint8_t frame[SRN_MIRROR_FRAME];   // 16 pages of 128 bytes
+  bool synced;                       // frame is good, deltas can apply
+  uint8_t seq;
+  uint32_t frames;                   // frames applied
+  uint32_t errors;                   // damaged frames and missed deltas
+  void (*text)(void *ctx, uint8_t c); // bytes outside frames, may be NULL
+  void *ctx;
+  int len;
+  uint8_t buf[SRN_MIRROR_MAX_BYTES];
+  uint8_t scratch[SRN_MIRROR_FRAME];
+} srn_mirror_view_t;
+
+void srn_mirror_view_init(srn_mirror_view_t *this);
+
+// Feeds num bytes of the stream.  Returns how many frames were applied,
+// after each of which frame held a whole screen.  frame_done, if not
+// NULL, is called after each one.
+int srn_mirror_view_feed(srn_mirror_view_t *this, const uint8_t *bytes, int num,
+                         void (*frame_done)(void *ctx, const uint8_t *frame), void *ctx);
+
+#endif
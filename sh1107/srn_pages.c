@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "sh1107_port.h"
+#include "sh1107_spi.h"
+#include "sh1107_transport.h"
+#include "srn_stream.h"
+#include "srn_pages.h"
+#include "srn_perf.h"
+
+// BANDS
+// A band is the 128 bytes of one page, each byte 8 vertical pixels with
+// bit 0 at the top, as the SH1107 takes them.  Every item is clipped to
+// the rows top to top + 7 of the page and to the 128 columns.
+
+static inline void apply(uint8_t *d, uint8_t bits, int rop) {
+  switch (rop) {
+  case SRN_ROP_CLEAR: *d &= ~bits; break;
+  case SRN_ROP_INVERT: *d ^= bits; break;
+  default: *d |= bits; break;
+  }
+}
+
+static void band_rect(uint8_t *band, int top, const srn_item_t *item) {
+  int y0 = item->y0 > top ? item->y0 : top;
+  int y1 = item->y1 < top + 7 ? item->y1 : top + 7;
+  int x0 = item->x0 > 0 ? item->x0 : 0;
+  int x1 = item->x1 < 127 ? item->x1 : 127;
+  if (y0 > y1 || x0 > x1) return;
+  uint8_t rows = (0xFF << (y0 - top)) & (0xFF >> (7 - (y1 - top)));
+  for (int x = x0; x <= x1; x++) apply(&band[x], rows, item->rop);
+}
+
+// Bresenham over the whole line, plotting the pixels in the band.  The
+// same pixels are plotted whichever page is drawn, so a line split across
+// pages has no seams.
+static void band_line(uint8_t *band, int top, const srn_item_t *item) {
+  int x0 = item->x0, y0 = item->y0;
+  int x1 = item->x1, y1 = item->y1;
+  if ((y0 < top && y1 < top) || (y0 > top + 7 && y1 > top + 7)) return;
+  int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+  int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+  int err = dx + dy;
+  while (true) {
+    if (y0 >= top && y0 <= top + 7 && x0 >= 0 && x0 <= 127) {
+      apply(&band[x0], 1 << (y0 - top), item->rop);
+    }
+    if (x0 == x1 && y0 == y1) break;
+    int e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      x0 += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y0 += sy;
+    }
+  }
+}
+
+// draw_text() for one page: the glyph page above the band is shifted down
+// into it and the one in it is shifted down by the rest.  The text cell
+// is opaque as with draw_text().
+static void band_text(uint8_t *band, int top, const srn_item_t *item) {
+  const srn_font_t *font = item->text.font;
+  int y = item->y0;
+  if (y + font->height - 1 < top || y > top + 7) return;
+  int pages = (font->height + 7) >> 3;
+  int shift = y & 7;
+  int page = top >> 3;
+  int upper = page - (y >> 3);     // glyph page whose top rows are here
+  int lower = upper - 1;           // and the one whose bottom rows are
+  uint8_t last_rows = 0xFF >> (pages * 8 - font->height);
+  int x = item->x0;
+  for (const char *str = item->text.str; *str && x <= 127; str++) {
+    uint8_t chr = *str;
+    int left;
+    int advance = srn_glyph_advance(font, chr, &left);
+    if (advance == 0) continue;
+    const uint8_t *glyph = font->glyphs + (chr - font->first) * font->cell_width * pages;
+    for (int c = 0; c < advance; c++, x++) {
+      if (x < 0 || x > 127) continue;
+      int col = left + c;
+      uint8_t bits = 0;
+      uint8_t rows = 0;
+      if (upper >= 0 && upper < pages) {
+        bits |= (col < font->cell_width ? glyph[upper * font->cell_width + col] : 0) << shift;
+        rows |= (upper == pages - 1 ? last_rows : 0xFF) << shift;
+      }
+      if (shift != 0 && lower >= 0 && lower < pages) {
+        bits |= (col < font->cell_width ? glyph[lower * font->cell_width + col] : 0) >> (8 - shift);
+        rows |= (lower == pages - 1 ? last_rows : 0xFF) >> (8 - shift);
+      }
+      band[x] = (band[x] & ~rows) | (bits & rows);
+    }
+  }
+}
+
+// the sprite copy shifted by y & 7 has one page row per band
+static void band_sprite(uint8_t *band, int top, const srn_item_t *item) {
+  const srn_sprite_t *sprite = item->sprite;
+  int row = (top >> 3) - (item->y0 >> 3);
+  if (row < 0 || row >= sprite->pages) return;
+  int width = sprite->width;
+  int copy = (item->y0 & 7) * sprite->pages * width + row * width;
+  const uint8_t *image = sprite->image + copy;
+  const uint8_t *mask = sprite->mask ? sprite->mask + copy : NULL;
+  int x0 = item->x0 > 0 ? item->x0 : 0;
+  int x1 = item->x0 + width - 1 < 127 ? item->x0 + width - 1 : 127;
+  for (int x = x0; x <= x1; x++) {
+    int i = x - item->x0;
+    if (mask) band[x] = (band[x] & ~mask[i]) | image[i];
+    else band[x] |= image[i];
+  }
+}
+
+static void render_band(uint8_t *band, int page, const srn_item_t *items, int num) {
+  int top = page * 8;
+  srn_bitmap_t bm;
+  srn_bitmap_init(&bm, band, 128, 8);
+  memset(band, 0, 128);
+  for (int i = 0; i < num; i++) {
+    const srn_item_t *item = &items[i];
+    switch (item->kind) {
+    case SRN_ITEM_RECT:
+      band_rect(band, top, item);
+      break;
+    case SRN_ITEM_LINE:
+      band_line(band, top, item);
+      break;
+    case SRN_ITEM_TEXT:
+      band_text(band, top, item);
+      break;
+    case SRN_ITEM_SPRITE:
+      band_sprite(band, top, item);
+      break;
+    case SRN_ITEM_BITMAP: {
+      const srn_bitmap_t *src = item->bitmap;
+      if (item->y0 + src->height - 1 < top || item->y0 > top + 7) break;
+      screen_region_t all = {0, 0, src->width - 1, src->height - 1};
+      bitblt(src, &all, &bm, item->x0, item->y0 - top, item->rop);
+      break;
+    }
+    case SRN_ITEM_CALL:
+      item->call.draw(item->call.ctx, &bm, page);
+      break;
+    }
+  }
+}
+
+// RENDERING
+
+void srn_pages_init(srn_pages_t *this, sh1107_t *display) {
+  this->display = display;
+  this->next = 0;
+}
+
+void srn_pages_render_range(srn_pages_t *this, const srn_item_t *items, int num,
+                            int first, int last) {
+  sh1107_t *display = this->display;
+  for (int page = first; page <= last; page++) {
+    // the buffers take turns, so this one went two sends ago and is free:
+    // sh1107_send_stream() waits for each send before starting the next
+    uint8_t *buf = this->buffers[this->next];
+    this->next ^= 1;
+    srn_stream_t stream;
+    srn_stream_init(&stream, buf, SRN_PAGE_STREAM_BYTES);
+    if (display->start_line_pending) {
+      uint8_t cmd[2] = {0xDC, (display->page_offset * 8) & 0x7F};
+      srn_stream_cmd(&stream, cmd, 2);
+      display->start_line_pending = false;
+    }
+    if (display->vertical_mode) {
+      uint8_t cmd = 0x20;
+      srn_stream_cmd(&stream, &cmd, 1);
+      display->vertical_mode = false;
+    }
+    int p = (page + display->page_offset) & 15;
+    uint8_t cmd[3] = {0x10, 0x00, 0xB0 | p};
+    srn_stream_cmd(&stream, cmd, 3);
+    render_band(srn_stream_data_space(&stream, 128), page, items, num);
+    srn_stream_end(&stream);
+    SRN_PERF_PAGES(1);
+    sh1107_send_stream(display, buf, stream.len, true);
+  }
+}
+
+void srn_pages_render(srn_pages_t *this, const srn_item_t *items, int num) {
+  srn_pages_render_range(this, items, num, 0, 15);
+}
@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* srn_pages.h
+ * A renderer for firmware that can not spare a 2 KB pixel buffer per
+ * panel.  The screen is described by a display list of items: rectangles,
+ * lines, text, sprites, bitmaps and callbacks.  srn_pages_render() draws
+ * the list one 8 row page at a time into a 128 byte band, clipping every
+ * item to it, and sends each page as soon as it is drawn.  Two page
+ * buffers take turns, so the next page is drawn while the last one is on
+ * the wire, and the first page reaches the glass before the last one is
+ * drawn.
+ *
+ *   static sh1107_t panel;
+ *   static srn_pages_t pages;
+ *   static const srn_item_t screen[] = {
+ *     SRN_RECT(0, 0, 127, 9, SRN_ROP_SET),
+ *     SRN_TEXT(2, 1, &srn_font8x8_prop, "Status"),
+ *     SRN_SPRITE(116, 1, &srn_icon_battery),
+ *     SRN_LINE(0, 127, 127, 20, SRN_ROP_SET),
+ *   };
+ *   sh1107_init(&panel, NULL);        // no pixel buffers
+ *   ... set the transport ...
+ *   srn_pages_init(&pages, &panel);
+ *   srn_pages_render(&pages, screen, 4);
+ *
+ * The whole screen is drawn every time, so the list must hold everything
+ * on it.  Items are drawn in order on a blank page, later ones on top.
+ * The renderer keeps no pixels between calls: the memory for a panel is
+ * the two page buffers in srn_pages_t.
+ */
+
+#ifndef SRN_PAGES_H
+#define SRN_PAGES_H
+
+#include "sh1107_spi.h"
+#include "srn_stream.h"
+#include "bitblt.h"
+#include "draw_char.h"
+#include "draw_sprite.h"
+
+// Draws into the band of one page.  Row 0 of band is row page * 8 of the
+// screen.  Use bitblt(), bitblt_rect() or the bytes of band->pixels.
+typedef void (*srn_page_draw_t)(void *ctx, srn_bitmap_t *band, int page);
+
+typedef enum srn_item_kind {
+  SRN_ITEM_RECT,      // rop on the rectangle x0, y0 to x1, y1 inclusive
+  SRN_ITEM_LINE,      // rop on the pixels of the line x0, y0 to x1, y1
+  SRN_ITEM_TEXT,      // text with its top left corner at x0, y0
+  SRN_ITEM_SPRITE,    // a sprite with its top left corner at x0, y0
+  SRN_ITEM_BITMAP,    // bitblt() of a whole bitmap to x0, y0 with rop
+  SRN_ITEM_CALL,      // a callback for every page
+} srn_item_kind_t;
+
+// rectangles and lines take SRN_ROP_SET, SRN_ROP_CLEAR or SRN_ROP_INVERT
+typedef struct srn_item {
+  uint8_t kind;           // srn_item_kind_t
+  uint8_t rop;            // srn_rop_t
+  int16_t x0, y0, x1, y1;
+  union {
+    struct {
+      const char *str;
+      const srn_font_t *font;
+    } text;
+    const srn_sprite_t *sprite;
+    const srn_bitmap_t *bitmap;
+    struct {
+      srn_page_draw_t draw;
+      void *ctx;
+    } call;
+  };
+} srn_item_t;
+
+#define SRN_RECT(_X0, _Y0, _X1, _Y1, _ROP) \
+  {.kind = SRN_ITEM_RECT, .rop = (_ROP), .x0 = (_X0), .y0 = (_Y0), .x1 = (_X1), .y1 = (_Y1)}
+#define SRN_LINE(_X0, _Y0, _X1, _Y1, _ROP) \
+  {.kind = SRN_ITEM_LINE, .rop = (_ROP), .x0 = (_X0), .y0 = (_Y0), .x1 = (_X1), .y1 = (_Y1)}
+#define SRN_TEXT(_X, _Y, _FONT, _STR) \
+  {.kind = SRN_ITEM_TEXT, .x0 = (_X), .y0 = (_Y), .text = {(_STR), (_FONT)}}
+#define SRN_SPRITE(_X, _Y, _SPRITE) \
+  {.kind = SRN_ITEM_SPRITE, .x0 = (_X), .y0 = (_Y), .sprite = (_SPRITE)}
+#define SRN_BITMAP(_X, _Y, _BITMAP, _ROP) \
+  {.kind = SRN_ITEM_BITMAP, .rop = (_ROP), .x0 = (_X), .y0 = (_Y), .bitmap = (_BITMAP)}
+#define SRN_CALL(_DRAW, _CTX) \
+  {.kind = SRN_ITEM_CALL, .call = {(_DRAW), (_CTX)}}
+
+// bytes of one page as a stream: the start line, addressing mode and set
+// column and page commands, 128 bytes of pixels and the headers
+#define SRN_PAGE_STREAM_BYTES (3 * SRN_STREAM_HEADER + 2 + 1 + 3 + 128)
+
+typedef struct srn_pages {
+  sh1107_t *display;
+  int next;               // the buffer the next page is drawn in
+  uint8_t buffers[2][SRN_PAGE_STREAM_BYTES];
+} srn_pages_t;
+
+// Sets up a renderer for display, which needs a transport but no pixel
+// buffers.
+void srn_pages_init(srn_pages_t *this, sh1107_t *display);
+
+// Draws the num items of a display list on every page and sends the
+// pages.  It returns as soon as the last page has started to go:
+// sh1107_refresh_wait(display) waits for it.
+void srn_pages_render(srn_pages_t *this, const srn_item_t *items, int num);
+
+// srn_pages_render() for pages first to last only, for example to update
+// a status line.  The other pages keep what the panel shows.
+void srn_pages_render_range(srn_pages_t *this, const srn_item_t *items, int num,
+                            int first, int last);
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifdef SRN_PERF
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_port.h"
+#include "srn_stream.h"
+#include "srn_perf.h"
+
+static const char *names[SRN_PERF_NUM_COUNTERS] = {
+  "refresh", "spi", "scroll", "clear", "line", "char", "scroll_text",
+};
+
+// The SPI counter is added to from the transfer done interrupt, the
+// others from the drawing code, so no counter has two writers.
+static srn_perf_stat_t stats[SRN_PERF_NUM_COUNTERS];
+static srn_perf_totals_t totals;
+
+// COUNTING
+
+static inline int bucket(uint64_t ns) {
+  uint32_t us = ns / 1000;
+  if (us == 0) return 0;
+  int b = 32 - __builtin_clz(us);
+  return b < SRN_PERF_BUCKETS ? b : SRN_PERF_BUCKETS - 1;
+}
+
+void srn_perf_add(srn_perf_counter_t counter, uint64_t ns) {
+  srn_perf_stat_t *stat = &stats[counter];
+  uint32_t t = ns > UINT32_MAX ? UINT32_MAX : ns;
+  if (stat->count == 0 || t < stat->min_ns) stat->min_ns = t;
+  if (t > stat->max_ns) stat->max_ns = t;
+  stat->count++;
+  stat->total_ns += ns;
+  stat->histogram[bucket(ns)]++;
+}
+
+void srn_perf_stream(const uint8_t *stream, int num) {
+  totals.transfers++;
+  int i = 0;
+  while (i + SRN_STREAM_HEADER <= num) {
+    bool data;
+    int n = srn_stream_segment(stream + i, &data);
+    if (n < 0) break;
+    totals.bytes += n;
+    i += SRN_STREAM_HEADER + n;
+  }
+}
+
+void srn_perf_pages(int pages) {
+  totals.pages += pages;
+}
+
+// QUERIES
+
+void srn_perf_get(srn_perf_counter_t counter, srn_perf_stat_t *stat) {
+  *stat = stats[counter];
+}
+
+void srn_perf_get_totals(srn_perf_totals_t *t) {
+  *t = totals;
+}
+
+void srn_perf_reset() {
+  memset(stats, 0, sizeof(stats));
+  memset(&totals, 0, sizeof(totals));
+}
+
+const char *srn_perf_name(srn_perf_counter_t counter) {
+  return counter < SRN_PERF_NUM_COUNTERS ? names[counter] : "?";
+}
+
+void srn_perf_print() {
+  printf("perf,counter,count,min_us,avg_us,max_us,histogram\n");
+  for (int c = 0; c < SRN_PERF_NUM_COUNTERS; c++) {
+    srn_perf_stat_t stat;
+    srn_perf_get(c, &stat);
+    uint32_t avg = stat.count ? stat.total_ns / stat.count : 0;
+    printf("perf,%s,%lu,%lu,%lu,%lu,", names[c], (unsigned long)stat.count,
+           (unsigned long)(stat.min_ns / 1000), (unsigned long)(avg / 1000),
+           (unsigned long)(stat.max_ns / 1000));
+    for (int b = 0; b < SRN_PERF_BUCKETS; b++) {
+      printf(b ? " %lu" : "%lu", (unsigned long)stat.histogram[b]);
+    }
+    printf("\n");
+  }
+  printf("perf,transfers,%lu\n", (unsigned long)totals.transfers);
+  printf("perf,pages,%lu\n", (unsigned long)totals.pages);
+  printf("perf,bytes,%llu\n", (unsigned long long)totals.bytes);
+}
+
+#endif
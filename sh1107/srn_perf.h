@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* srn_perf.h
+ * Counters and timers for where the frame time goes, built in with
+ * SRN_PERF defined (cmake -DSRN_PERF=ON).  Each timed counter keeps the
+ * number of calls, the minimum, total and maximum time, and a histogram
+ * of the times in powers of two of a microsecond:
+ *
+ *   refresh       time in srn_refresh(), srn_refresh_region() and
+ *                 srn_refresh_async(), waits included
+ *   spi           the transport busy, from the start of a transfer until
+ *                 the transport is done with it
+ *   scroll        scroll_screen_region()
+ *   clear         clearing a region, as with clear_screen_region()
+ *   line          draw_line()
+ *   char          write_char_next()
+ *   scroll_text   scroll_text()
+ *
+ * A call inside another is counted in both, so a scroll_text() is also a
+ * scroll.  Alongside them are the totals of transfers, pages and bytes
+ * sent to the panels.
+ *
+ *   srn_perf_reset();
+ *   ... draw and refresh for a while ...
+ *   srn_perf_print();
+ *
+ * Without SRN_PERF the hooks in the driver are empty macros and the
+ * functions below do nothing, so they cost nothing and the calls can stay
+ * in the program.
+ */
+
+#ifndef SRN_PERF_H
+#define SRN_PERF_H
+
+#include "sh1107_port.h"
+
+typedef enum srn_perf_counter {
+  SRN_PERF_REFRESH,
+  SRN_PERF_SPI,
+  SRN_PERF_SCROLL,
+  SRN_PERF_CLEAR,
+  SRN_PERF_LINE,
+  SRN_PERF_CHAR,
+  SRN_PERF_SCROLL_TEXT,
+  SRN_PERF_NUM_COUNTERS
+} srn_perf_counter_t;
+
+// bucket 0 is under 1 us, bucket k from 2^(k-1) us up to 2^k us, and the
+// last bucket everything longer
+#define SRN_PERF_BUCKETS 16
+
+typedef struct srn_perf_stat {
+  uint32_t count;
+  uint32_t min_ns;
+  uint32_t max_ns;
+  uint64_t total_ns;
+  uint32_t histogram[SRN_PERF_BUCKETS];
+} srn_perf_stat_t;
+
+typedef struct srn_perf_totals {
+  uint32_t transfers;  // streams sent: one per refresh, or per srn_pages page
+  uint32_t pages;      // pages with changes in them
+  uint64_t bytes;      // command and data bytes on the wire
+} srn_perf_totals_t;
+
+#ifdef SRN_PERF
+
+// Adds a time to a counter.
+void srn_perf_add(srn_perf_counter_t counter, uint64_t ns);
+
+// Adds a stream of num bytes (see srn_stream.h) to the totals.
+void srn_perf_stream(const uint8_t *stream, int num);
+
+void srn_perf_pages(int pages);
+
+// A copy of a counter.  Its min_ns is 0 if it has no calls.
+void srn_perf_get(srn_perf_counter_t counter, srn_perf_stat_t *stat);
+
+void srn_perf_get_totals(srn_perf_totals_t *totals);
+
+void srn_perf_reset();
+
+const char *srn_perf_name(srn_perf_counter_t counter);
+
+// Prints every counter and the totals as CSV on stdio, after a header
+// line, in the form of the bench output:
+//   perf,counter,count,min_us,avg_us,max_us,histogram
+// where histogram is the SRN_PERF_BUCKETS counts separated by spaces.
+void srn_perf_print();
+
+// HOOKS
+// SRN_PERF_TIME() times the rest of the block it is in, whichever way the
+// block is left.
+
+typedef struct srn_perf_timer {
+  srn_perf_counter_t counter;
+  uint64_t start;
+} srn_perf_timer_t;
+
+static inline void srn_perf_timer_end(srn_perf_timer_t *timer) {
+  srn_perf_add(timer->counter, srn_time_ns() - timer->start);
+}
+
+#define SRN_PERF_TIME(_COUNTER) \
+  srn_perf_timer_t _srn_perf_timer __attribute__((cleanup(srn_perf_timer_end))) = \
+    {(_COUNTER), srn_time_ns()}
+#define SRN_PERF_START(_NS) ((_NS) = srn_time_ns())
+#define SRN_PERF_STOP(_COUNTER, _NS) srn_perf_add((_COUNTER), srn_time_ns() - (_NS))
+#define SRN_PERF_STREAM(_STREAM, _NUM) srn_perf_stream((_STREAM), (_NUM))
+#define SRN_PERF_PAGES(_PAGES) srn_perf_pages(_PAGES)
+
+#else
+
+static inline void srn_perf_get(srn_perf_counter_t counter, srn_perf_stat_t *stat) {
+  *stat = (srn_perf_stat_t){0};
+}
+static inline void srn_perf_get_totals(srn_perf_totals_t *totals) {
+  *totals = (srn_perf_totals_t){0};
+}
+static inline void srn_perf_reset() {}
+static inline void srn_perf_print() {}
+
+#define SRN_PERF_TIME(_COUNTER)
+#define SRN_PERF_START(_NS) ((void)0)
+#define SRN_PERF_STOP(_COUNTER, _NS) ((void)0)
+#define SRN_PERF_STREAM(_STREAM, _NUM) ((void)0)
+#define SRN_PERF_PAGES(_PAGES) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,224 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_port.h"
+#include "sh1107_spi.h"
+#include "sh1107_transport.h"
+#include "srn_pump.h"
+
+// FRAMES
+// Three frames are shared by the two sides.  At any time core0 owns one
+// (prod_idx), core1 owns one (cons_idx) and the third is in frame_ready.
+// FRAME_NEW is set in frame_ready when it holds a frame core1 has not taken.
+// Both sides only ever exchange their own frame with frame_ready.
+
+#define FRAME_NEW 4
+
+typedef struct srn_frame {
+  srn_pixels_t pixels;
+  uint8_t dirty_min[16];
+  uint8_t dirty_max[16];
+} srn_frame_t;
+
+// the display the pump sends to, the one selected at srn_pump_start()
+static sh1107_t *pump_display;
+
+static srn_frame_t frames[3];
+static int prod_idx = 0;
+static int cons_idx = 1;
+static volatile uint32_t frame_ready = 2;
+static volatile bool pump_running = false;
+static volatile bool pump_stopping = false;
+
+// changes published since the last frame known to be taken by core1
+static uint8_t carry_min[16];
+static uint8_t carry_max[16];
+
+static srn_pump_stats_t pump_stats;
+
+// PLATFORM
+// swap_ready() atomically exchanges frame_ready.  ring_doorbell() wakes the
+// pump and wait_doorbell() sleeps until then.  It returns false when the
+// pump is asked to stop.
+
+#if PICO_ON_DEVICE
+
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+// The M0+ has no exclusive load/store, so the exchange is done under one of
+// the SIO hardware spin locks.  It is held for two instructions.
+static spin_lock_t *ready_lock;
+
+static uint32_t swap_ready(uint32_t val) {
+  uint32_t save = spin_lock_blocking(ready_lock);
+  uint32_t old = frame_ready;
+  frame_ready = val;
+  spin_unlock(ready_lock, save);
+  return old;
+}
+
+static void ring_doorbell() {
+  // one waiting token is enough, so never block on a full FIFO
+  if (multicore_fifo_wready()) multicore_fifo_push_blocking(0);
+}
+
+static bool wait_doorbell() {
+  multicore_fifo_pop_blocking();
+  return !pump_stopping;
+}
+
+static void pump_loop();
+
+static void launch_pump() {
+  if (ready_lock == NULL) {
+    ready_lock = spin_lock_instance(spin_lock_claim_unused(true));
+  }
+  multicore_fifo_drain();
+  multicore_launch_core1(pump_loop);
+}
+
+static void join_pump() {
+  multicore_fifo_push_blocking(0);
+  while (pump_running) tight_loop_contents();
+  multicore_reset_core1();
+}
+
+#else // host build, the pump runs on a pthread
+
+#include <pthread.h>
+
+static pthread_t pump_thread;
+static pthread_mutex_t doorbell_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t doorbell_cond = PTHREAD_COND_INITIALIZER;
+static bool doorbell;
+
+static uint32_t swap_ready(uint32_t val) {
+  return __atomic_exchange_n(&frame_ready, val, __ATOMIC_ACQ_REL);
+}
+
+static void ring_doorbell() {
+  pthread_mutex_lock(&doorbell_mutex);
+  doorbell = true;
+  pthread_cond_signal(&doorbell_cond);
+  pthread_mutex_unlock(&doorbell_mutex);
+}
+
+static bool wait_doorbell() {
+  pthread_mutex_lock(&doorbell_mutex);
+  while (!doorbell) pthread_cond_wait(&doorbell_cond, &doorbell_mutex);
+  doorbell = false;
+  pthread_mutex_unlock(&doorbell_mutex);
+  return !pump_stopping;
+}
+
+static void pump_loop();
+
+static void *pump_thread_main(void *arg) {
+  pump_loop();
+  return NULL;
+}
+
+static void launch_pump() {
+  pthread_create(&pump_thread, NULL, pump_thread_main, NULL);
+}
+
+static void join_pump() {
+  ring_doorbell();
+  pthread_join(pump_thread, NULL);
+}
+
+#endif
+
+// CONSUMER
+// Takes the newest frame, if there is one, and sends its changed spans.
+
+static bool send_latest() {
+  if (!(frame_ready & FRAME_NEW)) return false;
+  cons_idx = swap_ready(cons_idx) & 3;
+  srn_frame_t *f = &frames[cons_idx];
+  sh1107_send_spans(pump_display, f->pixels, f->dirty_min, f->dirty_max);
+  pump_stats.sent++;
+  return true;
+}
+
+static void pump_loop() {
+  while (wait_doorbell()) {
+    send_latest();
+  }
+  send_latest();
+  pump_running = false;
+}
+
+// PRODUCER
+
+bool srn_pump_publish() {
+  srn_frame_t *f = &frames[prod_idx];
+  sh1107_t *d = pump_display;
+  sh1107_composite_dirty(d);
+  memcpy(f->pixels, *d->output, sizeof(f->pixels));
+  for (int j = 0; j < 16; j++) {
+    if (d->dirty_min[j] < carry_min[j]) carry_min[j] = d->dirty_min[j];
+    if (d->dirty_max[j] > carry_max[j]) carry_max[j] = d->dirty_max[j];
+    f->dirty_min[j] = carry_min[j];
+    f->dirty_max[j] = carry_max[j];
+    d->dirty_min[j] = 0xFF;
+    d->dirty_max[j] = 0;
+  }
+  uint32_t old = swap_ready(prod_idx | FRAME_NEW);
+  prod_idx = old & 3;
+  pump_stats.published++;
+  bool taken = !(old & FRAME_NEW);
+  if (taken) {
+    // everything before this frame is on the display, so only this
+    // frame's changes are still owed.
+    memcpy(carry_min, f->dirty_min, sizeof(carry_min));
+    memcpy(carry_max, f->dirty_max, sizeof(carry_max));
+  } else {
+    pump_stats.dropped++;
+  }
+  ring_doorbell();
+  return taken;
+}
+
+void srn_pump_start() {
+  if (pump_running) return;
+  pump_display = srn_display;
+  srn_refresh_wait();
+  // everything in srn_display_pixels is owed to the display.
+  memcpy(carry_min, srn_dirty_min, sizeof(carry_min));
+  memcpy(carry_max, srn_dirty_max, sizeof(carry_max));
+  pump_display->pumped = true;
+  frame_ready = 2;
+  prod_idx = 0;
+  cons_idx = 1;
+  pump_stopping = false;
+  pump_running = true;
+  launch_pump();
+}
+
+void srn_pump_stop() {
+  if (!pump_running) return;
+  pump_stopping = true;
+  join_pump();
+  pump_display->pumped = false;
+  // the carried spans were sent with the last frame or are still in
+  // the pixel buffer, so hand them back to the normal refresh.
+  for (int j = 0; j < 16; j++) {
+    if (carry_min[j] < pump_display->dirty_min[j]) pump_display->dirty_min[j] = carry_min[j];
+    if (carry_max[j] > pump_display->dirty_max[j]) pump_display->dirty_max[j] = carry_max[j];
+  }
+}
+
+bool srn_pump_running() {
+  return pump_running;
+}
+
+void srn_pump_get_stats(srn_pump_stats_t *stats) {
+  *stats = pump_stats;
+}
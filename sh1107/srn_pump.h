@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* srn_pump.h
+ * Optional mode in which core1 owns the SPI link and sends frames to the
+ * SH1107 while core0 keeps drawing.  Once the pump is started, srn_refresh()
+ * and srn_refresh_async() no longer talk to the display.  They copy
+ * srn_display_pixels into a free frame and publish it to core1, which sends
+ * the changed spans.  If core1 has not taken the last published frame yet,
+ * that frame is dropped and the newest one wins.  The changes of a dropped
+ * frame are carried into the next one so nothing is lost on the display.
+ *
+ * The frame handoff is a triple buffer with one shared index swapped
+ * atomically, so neither core ever waits for the other.  On a host build the
+ * pump runs on a pthread instead of core1.
+ */
+
+#ifndef SRN_PUMP_H
+#define SRN_PUMP_H
+
+typedef struct srn_pump_stats {
+  uint32_t published;  // frames handed over by srn_pump_publish()
+  uint32_t sent;       // frames sent to the display by the pump
+  uint32_t dropped;    // frames replaced by a newer one before being sent
+} srn_pump_stats_t;
+
+// Launches the pump on core1 for the selected display.  Its transport must
+// already be set up, for example with init_sh1107_SPI().  The pump serves
+// one display; the refresh of any other display works as usual.  Other
+// commands such as srn_set_contrast() must not be sent to it while the pump
+// is running.
+void srn_pump_start();
+
+// Sends any frame still waiting and stops the pump.  core1 is reset.
+void srn_pump_stop();
+
+bool srn_pump_running();
+
+// Publishes the pixels of the pump's display to the pump.  Returns false if
+// the previously published frame was dropped.
+bool srn_pump_publish();
+
+void srn_pump_get_stats(srn_pump_stats_t *stats);
+
+#endif
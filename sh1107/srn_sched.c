@@ -0,0 +1,321 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_port.h"
+#include "sh1107_spi.h"
+#include "srn_sched.h"
+
+// REGIONS
+// Each region with its own rate is due every period ticks.  pending is set
+// by a request and cleared when the region is sent.
+
+typedef struct sched_region {
+  const screen_region_t *sr;
+  int hz;
+  uint32_t period;     // in ticks
+  uint32_t next_due;   // tick at which it may be sent again
+  bool pending;
+} sched_region_t;
+
+static sched_region_t regions[SRN_SCHED_MAX_REGIONS];
+static sh1107_t *sched_display;    // the display selected at srn_sched_start()
+static int tick_hz;
+static bool paced = false;
+static bool other_pending;   // requests for regions without a rate
+static uint32_t last_tick;
+static srn_sched_stats_t sched_stats;
+
+// TICKS
+// start_ticks() starts the repeating timer and current_tick() returns the
+// number of ticks since then.
+
+#if PICO_ON_DEVICE
+
+static repeating_timer_t tick_timer;
+static volatile uint32_t tick_count;
+
+static bool on_tick(repeating_timer_t *rt) {
+  tick_count++;
+  return true;
+}
+
+static void start_ticks() {
+  tick_count = 0;
+  // a negative delay keeps the ticks evenly spaced
+  add_repeating_timer_us(-1000000 / tick_hz, on_tick, NULL, &tick_timer);
+}
+
+static void stop_ticks() {
+  cancel_repeating_timer(&tick_timer);
+}
+
+static uint32_t current_tick() {
+  return tick_count;
+}
+
+#else // host build, the ticks are worked out from the clock
+
+static uint64_t start_ns;
+
+static void start_ticks() {
+  start_ns = srn_time_ns();
+}
+
+static void stop_ticks() {
+}
+
+static uint32_t current_tick() {
+  return (uint32_t)((srn_time_ns() - start_ns) * tick_hz / 1000000000);
+}
+
+#endif
+
+static sched_region_t *find_region(const screen_region_t *sr) {
+  for (int i = 0; i < SRN_SCHED_MAX_REGIONS; i++) {
+    if (regions[i].sr == sr) return &regions[i];
+  }
+  return NULL;
+}
+
+static bool anything_pending() {
+  if (other_pending) return true;
+  for (int i = 0; i < SRN_SCHED_MAX_REGIONS; i++) {
+    if (regions[i].sr != NULL && regions[i].pending) return true;
+  }
+  return false;
+}
+
+static inline uint32_t period_of(int hz) {
+  return hz < tick_hz ? tick_hz / hz : 1;
+}
+
+static inline bool is_due(const sched_region_t *r, uint32_t tick) {
+  return r->pending && (int32_t)(tick - r->next_due) >= 0;
+}
+
+void srn_sched_start(int hz) {
+  if (paced || hz <= 0) return;
+  tick_hz = hz;
+  sched_display = srn_display;
+  // rates set before starting are turned into periods now
+  for (int i = 0; i < SRN_SCHED_MAX_REGIONS; i++) {
+    if (regions[i].sr == NULL) continue;
+    regions[i].period = period_of(regions[i].hz);
+    regions[i].next_due = 0;
+    regions[i].pending = false;
+  }
+  other_pending = false;
+  last_tick = 0;
+  paced = true;
+  start_ticks();
+}
+
+void srn_sched_stop() {
+  if (!paced) return;
+  stop_ticks();
+  paced = false;
+  sh1107_refresh(sched_display);
+  other_pending = false;
+  for (int i = 0; i < SRN_SCHED_MAX_REGIONS; i++) {
+    regions[i].pending = false;
+  }
+}
+
+bool srn_sched_paced() {
+  return paced;
+}
+
+bool srn_sched_set_rate(const screen_region_t *sr, int hz) {
+  sched_region_t *r = find_region(sr);
+  if (hz <= 0) {
+    if (r != NULL) {
+      // anything it still owes goes out with the next tick
+      if (r->pending) other_pending = true;
+      memset(r, 0, sizeof(*r));
+    }
+    return true;
+  }
+  if (r == NULL) r = find_region(NULL);
+  if (r == NULL) return false;
+  r->sr = sr;
+  r->hz = hz;
+  r->period = paced ? period_of(hz) : 1;
+  return true;
+}
+
+void srn_sched_request(const screen_region_t *sr) {
+  if (!paced) {
+    srn_refresh();
+    return;
+  }
+  sched_stats.requests++;
+  sched_region_t *r = sr == NULL ? NULL : find_region(sr);
+  bool *pending = r == NULL ? &other_pending : &r->pending;
+  if (*pending) sched_stats.merged++;
+  *pending = true;
+}
+
+// HOLDING BACK
+// A region with a rate keeps its changes on the display until it is due,
+// even when a refresh for other regions goes out, so a refresh from the
+// scheduler leaves out the columns of the regions that are not due.  It
+// sends one span of columns per page, so a page sends the part of its
+// changes that is clear of those regions and starts or ends its changed
+// span, and is left owing the rest as a span.  Changes that end up between
+// two held regions wait for one of them to be due.
+
+static inline bool is_held(const sched_region_t *r, uint32_t tick) {
+  return r->sr != NULL && (int32_t)(tick - r->next_due) < 0;
+}
+
+static inline bool on_page(const sched_region_t *r, int j) {
+  return j >= r->sr->yMin >> 3 && j <= r->sr->yMax >> 3;
+}
+
+static bool held_column(int j, int c, uint32_t tick) {
+  for (int i = 0; i < SRN_SCHED_MAX_REGIONS; i++) {
+    const sched_region_t *r = &regions[i];
+    if (is_held(r, tick) && on_page(r, j) && c >= r->sr->xMin && c <= r->sr->xMax) return true;
+  }
+  return false;
+}
+
+// the first column of page j from c on that is not held back
+static int skip_held(int j, int c, uint32_t tick) {
+  bool moved = true;
+  while (moved && c < 128) {
+    moved = false;
+    for (int i = 0; i < SRN_SCHED_MAX_REGIONS; i++) {
+      const sched_region_t *r = &regions[i];
+      if (is_held(r, tick) && on_page(r, j) && c >= r->sr->xMin && c <= r->sr->xMax) {
+        c = r->sr->xMax + 1;
+        moved = true;
+      }
+    }
+  }
+  return c;
+}
+
+// the end of the columns of page j from the free column c up to hi that
+// are clear of held regions
+static int free_to(int j, int c, int hi, uint32_t tick) {
+  for (int i = 0; i < SRN_SCHED_MAX_REGIONS; i++) {
+    const sched_region_t *r = &regions[i];
+    if (is_held(r, tick) && on_page(r, j) && r->sr->xMin > c && r->sr->xMin <= hi) {
+      hi = r->sr->xMin - 1;
+    }
+  }
+  return hi;
+}
+
+// the start of the columns of page j from lo up to the free column c that
+// are clear of held regions
+static int free_from(int j, int lo, int c, uint32_t tick) {
+  for (int i = 0; i < SRN_SCHED_MAX_REGIONS; i++) {
+    const sched_region_t *r = &regions[i];
+    if (is_held(r, tick) && on_page(r, j) && r->sr->xMax < c && r->sr->xMax >= lo) {
+      lo = r->sr->xMax + 1;
+    }
+  }
+  return lo;
+}
+
+// Narrows the span of each page to what it can send of its changes.
+static void hold_back(uint8_t span_min[16], uint8_t span_max[16], uint32_t tick) {
+  const uint8_t *dirty_min = sched_display->dirty_min;
+  const uint8_t *dirty_max = sched_display->dirty_max;
+  for (int j = 0; j < 16; j++) {
+    int lo = dirty_min[j] > span_min[j] ? dirty_min[j] : span_min[j];
+    int hi = dirty_max[j] < span_max[j] ? dirty_max[j] : span_max[j];
+    span_min[j] = 0xFF;
+    span_max[j] = 0;
+    if (lo > hi) continue;
+    if (lo == dirty_min[j] && !held_column(j, lo, tick)) {
+      hi = free_to(j, lo, hi, tick);
+    } else if (hi == dirty_max[j] && !held_column(j, hi, tick)) {
+      lo = free_from(j, lo, hi, tick);
+    } else {
+      // in the middle of the changed span, which is kept whole
+      lo = skip_held(j, lo, tick);
+      if (lo > hi) continue;
+      hi = free_to(j, lo, hi, tick);
+    }
+    span_min[j] = lo;
+    span_max[j] = hi;
+  }
+}
+
+// True if a page still owes changes that are not held back at an end of
+// its changed span, which the next tick can send.
+static bool owes_free_changes(uint32_t tick) {
+  const uint8_t *dirty_min = sched_display->dirty_min;
+  const uint8_t *dirty_max = sched_display->dirty_max;
+  for (int j = 0; j < 16; j++) {
+    if (dirty_min[j] > dirty_max[j]) continue;
+    if (!held_column(j, dirty_min[j], tick) || !held_column(j, dirty_max[j], tick)) return true;
+  }
+  return false;
+}
+
+// POLLING
+// Everything due on a tick goes in one refresh: all pages when a region
+// without a rate is owed, else the columns of the due regions.
+
+static void add_region(uint8_t span_min[16], uint8_t span_max[16], const screen_region_t *sr) {
+  for (int j = sr->yMin >> 3; j <= sr->yMax >> 3; j++) {
+    if (sr->xMin < span_min[j]) span_min[j] = sr->xMin;
+    if (sr->xMax > span_max[j]) span_max[j] = sr->xMax;
+  }
+}
+
+bool srn_sched_poll() {
+  if (!paced) return false;
+  uint32_t tick = current_tick();
+  if (tick == last_tick) return false;
+  if (tick - last_tick > 1 && anything_pending()) {
+    sched_stats.dropped += tick - last_tick - 1;
+  }
+  last_tick = tick;
+
+  uint8_t span_min[16];
+  uint8_t span_max[16];
+  bool owed = other_pending;
+  for (int j = 0; j < 16; j++) {
+    span_min[j] = owed ? 0 : 0xFF;
+    span_max[j] = owed ? 127 : 0;
+  }
+  for (int i = 0; i < SRN_SCHED_MAX_REGIONS; i++) {
+    sched_region_t *r = &regions[i];
+    if (r->sr == NULL || !is_due(r, tick)) continue;
+    add_region(span_min, span_max, r->sr);
+    owed = true;
+  }
+  if (!owed) return false;
+
+  sh1107_composite_dirty(sched_display);
+  hold_back(span_min, span_max, tick);
+  bool sent = sh1107_refresh_spans(sched_display, span_min, span_max);
+  for (int i = 0; i < SRN_SCHED_MAX_REGIONS; i++) {
+    sched_region_t *r = &regions[i];
+    if (r->sr == NULL || !is_due(r, tick)) continue;
+    r->pending = false;
+    r->next_due = tick + r->period;
+  }
+  // what was left out only because a page sends one span goes next tick
+  other_pending = owes_free_changes(tick);
+  if (sent) sched_stats.frames++;
+  return sent;
+}
+
+void srn_sched_get_stats(srn_sched_stats_t *stats) {
+  *stats = sched_stats;
+}
+
+void srn_sched_reset_stats() {
+  memset(&sched_stats, 0, sizeof(sched_stats));
+}
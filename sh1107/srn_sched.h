@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* srn_sched.h
+ * Refresh scheduler.  Drawing code calls srn_sched_request() with the
+ * screen region it changed instead of srn_refresh().  By default the
+ * scheduler is in immediate mode and a request is just srn_refresh(), so
+ * nothing changes for existing code.
+ *
+ * srn_sched_start() switches to paced mode.  A repeating timer then ticks
+ * at the given rate and requests only record that a region is owed to the
+ * display.  srn_sched_poll(), called from the main loop, sends one refresh
+ * per tick covering everything that is due, so several requests between
+ * two ticks cost one transfer.  A region can be given its own, slower,
+ * rate with srn_sched_set_rate(), for example 60 Hz for a graph and 4 Hz
+ * for a readout.  Regions without a rate are due on every tick.  Each tick
+ * sends what is due in a single transfer: the due regions, or everything
+ * that has changed if a region without a rate is owed.  Either way the
+ * changes of rated regions that are not due yet stay back until they are.
+ *
+ *   srn_sched_start(60);
+ *   srn_sched_set_rate(&readout.sr, 4);
+ *   while (1) {
+ *     draw_next_as_line(&graph, sample());
+ *     srn_sched_request(&graph.sr);
+ *     srn_sched_poll();
+ *   }
+ */
+
+#ifndef SRN_SCHED_H
+#define SRN_SCHED_H
+
+#include "pixel_ops.h"
+
+// number of regions that can have their own rate
+#ifndef SRN_SCHED_MAX_REGIONS
+#define SRN_SCHED_MAX_REGIONS 8
+#endif
+
+typedef struct srn_sched_stats {
+  uint32_t requests;  // calls to srn_sched_request()
+  uint32_t merged;    // requests for a region that was already owed
+  uint32_t frames;    // refreshes sent by srn_sched_poll(), one a tick at most
+  uint32_t dropped;   // ticks that passed with work owed but no poll
+} srn_sched_stats_t;
+
+// Switches to paced mode with tick_hz ticks a second.  The ticks refresh
+// the display selected now, whichever is selected later.
+void srn_sched_start(int tick_hz);
+
+// Sends whatever is owed and goes back to immediate mode.
+void srn_sched_stop();
+
+bool srn_sched_paced();
+
+// Sets the update rate of a region in Hz.  The region is matched by
+// address, so pass the same screen_region_t to srn_sched_request().  A
+// rate of 0 removes the region.  Returns false if there is no room left.
+bool srn_sched_set_rate(const screen_region_t *sr, int hz);
+
+// Says the region has changed.  Refreshes now in immediate mode.
+void srn_sched_request(const screen_region_t *sr);
+
+// Sends one refresh if a tick has passed and something is due.  Returns
+// true if anything was sent.
+bool srn_sched_poll();
+
+void srn_sched_get_stats(srn_sched_stats_t *stats);
+void srn_sched_reset_stats();
+
+#endif
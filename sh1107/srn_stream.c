@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_port.h"
+#include "srn_stream.h"
+
+#define HEADER_DATA 0x8000
+
+// ENCODER
+
+static inline void put_header(uint8_t *p, bool data, int bits) {
+  int header = (data ? HEADER_DATA : 0) | (bits - 1);
+  p[0] = header >> 8;
+  p[1] = header & 0xFF;
+}
+
+static inline bool header_data(const uint8_t *p) {
+  return p[0] & 0x80;
+}
+
+static inline int header_bits(const uint8_t *p) {
+  return (((p[0] & 0x7F) << 8) | p[1]) + 1;
+}
+
+void srn_stream_init(srn_stream_t *this, uint8_t *buf, int size) {
+  this->buf = buf;
+  this->size = size;
+  this->len = 0;
+  this->segment = -1;
+  this->full = false;
+}
+
+// bytes the open segment can still take of this kind, -1 if there is no
+// open segment of this kind
+static int room_in_segment(const srn_stream_t *this, bool data) {
+  if (this->segment < 0) return -1;
+  const uint8_t *seg = this->buf + this->segment;
+  if (header_data(seg) != data) return -1;
+  return SRN_STREAM_MAX_SEGMENT - header_bits(seg) / 8;
+}
+
+// Makes room for num bytes of one kind at the end of the stream, in the
+// open segment if it has room or else in a new one.  num is at most
+// SRN_STREAM_MAX_SEGMENT.  Returns where the bytes go, or NULL.
+static uint8_t *reserve(srn_stream_t *this, bool data, int num) {
+  bool open = room_in_segment(this, data) >= num;
+  int need = num + (open ? 0 : SRN_STREAM_HEADER);
+  if (this->full || this->len + need > this->size) {
+    this->full = true;
+    return NULL;
+  }
+  // an empty segment cannot be encoded, and nothing needs to change
+  if (num == 0) return this->buf + this->len;
+  if (!open) {
+    this->segment = this->len;
+    put_header(this->buf + this->segment, data, num * 8);
+    this->len += SRN_STREAM_HEADER;
+  } else {
+    uint8_t *seg = this->buf + this->segment;
+    put_header(seg, data, header_bits(seg) + num * 8);
+  }
+  uint8_t *p = this->buf + this->len;
+  this->len += num;
+  return p;
+}
+
+static bool append(srn_stream_t *this, bool data, const uint8_t *bytes, int num) {
+  while (num > 0) {
+    // fill what is left of the open segment, then whole new ones
+    int n = room_in_segment(this, data);
+    if (n <= 0) n = SRN_STREAM_MAX_SEGMENT;
+    if (n > num) n = num;
+    uint8_t *p = reserve(this, data, n);
+    if (p == NULL) return false;
+    memcpy(p, bytes, n);
+    bytes += n;
+    num -= n;
+  }
+  return true;
+}
+
+bool srn_stream_cmd(srn_stream_t *this, const uint8_t *bytes, int num) {
+  return append(this, false, bytes, num);
+}
+
+bool srn_stream_data(srn_stream_t *this, const uint8_t *bytes, int num) {
+  return append(this, true, bytes, num);
+}
+
+uint8_t *srn_stream_data_space(srn_stream_t *this, int num) {
+  if (num > SRN_STREAM_MAX_SEGMENT) return NULL;
+  return reserve(this, true, num);
+}
+
+bool srn_stream_end(srn_stream_t *this) {
+  if (this->full || this->len + SRN_STREAM_HEADER > this->size) {
+    this->full = true;
+    return false;
+  }
+  put_header(this->buf + this->len, false, 1);
+  this->len += SRN_STREAM_HEADER;
+  this->segment = -1;
+  return true;
+}
+
+// DECODER
+
+int srn_stream_segment(const uint8_t *p, bool *data) {
+  *data = header_data(p);
+  int bits = header_bits(p);
+  if (!*data && bits == 1) return -1;
+  return bits / 8;
+}
+
+// srn_stream_decode() follows the PIO program: read a header, end the
+// frame on a one bit command, else send that many bits with D/C from the
+// header.
+
+int srn_stream_decode(const uint8_t *stream, int num,
+                      void (*write)(void *ctx, const uint8_t *buf, int num, bool cmd),
+                      void (*end)(void *ctx), void *ctx) {
+  int frames = 0;
+  int i = 0;
+  while (i < num) {
+    if (i + SRN_STREAM_HEADER > num) return -1;
+    const uint8_t *p = stream + i;
+    bool data = header_data(p);
+    int bits = header_bits(p);
+    i += SRN_STREAM_HEADER;
+    if (!data && bits == 1) {
+      if (end) end(ctx);
+      frames++;
+      continue;
+    }
+    // the encoder only makes whole bytes
+    if (bits & 7 || i + bits / 8 > num) return -1;
+    if (write) write(ctx, stream + i, bits / 8, !data);
+    i += bits / 8;
+  }
+  return frames;
+}
@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* srn_stream.h
+ * A tagged byte stream that carries commands and pixel data for the SH1107
+ * in one buffer, so a whole frame can be handed to the PIO transmitter in
+ * sh1107_tx.pio as a single DMA transfer.  The transmitter drives D/C and
+ * CS itself from the tags.
+ *
+ * The stream is a list of segments.  Each starts with a two byte header,
+ * most significant byte first: bit 15 is D/C (1 for pixel data, 0 for
+ * commands) and bits 14 to 0 are the number of bits in the segment less
+ * one.  The bytes of the segment follow.  A header of 0x0000, a one bit
+ * command, ends the frame: the transmitter releases CS and raises its
+ * interrupt.  CS stays asserted from the first segment to the end.
+ *
+ *   srn_stream_t s;
+ *   srn_stream_init(&s, buf, sizeof(buf));
+ *   srn_stream_cmd(&s, set_col_page, 3);
+ *   srn_stream_data(&s, pixels, 128);
+ *   srn_stream_end(&s);
+ *
+ * This file is plain C so the encoding can be checked on a host:
+ * srn_stream_decode() plays a stream back as the writes the transmitter
+ * puts on the wire.
+ */
+
+#ifndef SRN_STREAM_H
+#define SRN_STREAM_H
+
+#include "sh1107_port.h"
+
+// the most bytes one segment carries.  Longer runs take more segments.
+#define SRN_STREAM_MAX_SEGMENT 4096
+
+// bytes of header in front of each segment and at the end of a frame
+#define SRN_STREAM_HEADER 2
+
+// bytes a stream needs for a full frame sent page by page: a 3 byte
+// set column and page command and 128 bytes of data for each of the 16
+// pages, the start line and addressing mode commands, which share the
+// first command segment, and the end header.  A frame in vertical
+// addressing mode (see srn_encode.h) is shorter.
+#define SRN_STREAM_FRAME_BYTES \
+  (16 * (2 * SRN_STREAM_HEADER + 3 + 128) + 2 + 1 + SRN_STREAM_HEADER)
+
+typedef struct srn_stream {
+  uint8_t *buf;
+  int size;
+  int len;          // bytes used so far
+  int segment;      // offset of the header of the open segment, or -1
+  bool full;        // something did not fit
+} srn_stream_t;
+
+// Starts an empty stream in buf.
+void srn_stream_init(srn_stream_t *this, uint8_t *buf, int size);
+
+// Appends command or pixel data bytes.  Bytes of the same kind as the
+// segment before go into that segment, so D/C only changes when the kind
+// does.  Returns false and marks the stream full if they do not fit.
+bool srn_stream_cmd(srn_stream_t *this, const uint8_t *bytes, int num);
+bool srn_stream_data(srn_stream_t *this, const uint8_t *bytes, int num);
+
+// Reserves num bytes of pixel data and returns where to put them, or NULL
+// if they do not fit.  Saves a copy when the caller builds the data.
+uint8_t *srn_stream_data_space(srn_stream_t *this, int num);
+
+// Ends the frame.  Returns false if the stream is full.
+bool srn_stream_end(srn_stream_t *this);
+
+// Reads the header of the segment at p.  Returns the number of bytes
+// that follow and sets *data, or returns -1 at the end of the frame.
+int srn_stream_segment(const uint8_t *p, bool *data);
+
+// Plays a stream back as the transmitter would send it: write is called
+// once per segment with its bytes and D/C, and end once per frame.
+// Returns the number of frames, or -1 if the stream is malformed.
+int srn_stream_decode(const uint8_t *stream, int num,
+                      void (*write)(void *ctx, const uint8_t *buf, int num, bool cmd),
+                      void (*end)(void *ctx), void *ctx);
+
+#endif
@@ -0,0 +1,227 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_port.h"
+#include "pixel_ops.h"
+#include "draw_graphics.h"
+#include "strip_chart.h"
+
+// RING
+// The sample of age a, 0 being the newest, is in slot head - 1 - a.  The
+// sliding minimum and maximum are kept as rings of slots in age order
+// whose samples only rise (minimum) or fall (maximum) from the oldest on,
+// so the first slot holds the answer.  A new sample drops the slots it
+// makes useless from the end, and the oldest slot drops off the front
+// when its sample is replaced.
+
+static inline int wrap(const srn_strip_chart_t *this, int slot) {
+  if (slot < 0) return slot + this->width;
+  if (slot >= this->width) return slot - this->width;
+  return slot;
+}
+
+static inline int age_slot(const srn_strip_chart_t *this, int age) {
+  return wrap(this, this->head - 1 - age);
+}
+
+static void push_slot(srn_strip_chart_t *this, uint8_t *slots, int first, int *len,
+                      int slot, bool max) {
+  srn_fix_t v = this->samples[slot];
+  while (*len > 0) {
+    srn_fix_t last = this->samples[slots[wrap(this, first + *len - 1)]];
+    if (max ? last > v : last < v) break;
+    (*len)--;
+  }
+  slots[wrap(this, first + *len)] = slot;
+  (*len)++;
+}
+
+static void drop_slot(srn_strip_chart_t *this, uint8_t *slots, int *first, int *len, int slot) {
+  if (*len > 0 && slots[*first] == slot) {
+    *first = wrap(this, *first + 1);
+    (*len)--;
+  }
+}
+
+bool srn_strip_min_max(const srn_strip_chart_t *this, srn_fix_t *min, srn_fix_t *max) {
+  if (this->count == 0) return false;
+  *min = this->samples[this->min_slots[this->min_first]];
+  *max = this->samples[this->max_slots[this->max_first]];
+  return true;
+}
+
+// DRAWING
+
+// the row of a value: hi is the top row and lo the bottom one
+static inline int value_row(const srn_strip_chart_t *this, srn_fix_t v) {
+  if (v > this->hi) v = this->hi;
+  if (v < this->lo) v = this->lo;
+  int row = this->sr.yMin + (int)((((int64_t)this->hi - v) * this->scale) >> 32);
+  return row < this->sr.yMax ? row : this->sr.yMax;
+}
+
+// draws the sample in slot in column x, joined to the one in prev unless
+// prev is -1
+static void draw_column(srn_strip_chart_t *this, int x, int slot, int prev) {
+  fill_vspan(x, this->sr.yMin, this->sr.yMax, 0);
+  int row = value_row(this, this->samples[slot]);
+  if (this->style == SRN_STRIP_BAR) {
+    fill_vspan(x, row, this->sr.yMax, 1);
+    return;
+  }
+  int from = prev < 0 ? row : value_row(this, this->samples[prev]);
+  // the column takes the rows from next to the last sample up to this one
+  if (from < row) fill_vspan(x, from + 1, row, 1);
+  else if (from > row) fill_vspan(x, row, from - 1, 1);
+  else fill_vspan(x, row, row, 1);
+}
+
+// A sweep shows every sample in the column of its slot but the oldest,
+// whose column is left blank to show where the next sample goes.  A scroll
+// shows them from the oldest, in the slot after head, on.  Each column is
+// blanked before it is drawn.
+static void draw_columns(srn_strip_chart_t *this) {
+  for (int age = this->count - 1; age >= 0; age--) {
+    int slot = age_slot(this, age);
+    int prev = age + 1 < this->count ? age_slot(this, age + 1) : -1;
+    if (this->mode == SRN_STRIP_SWEEP) {
+      if (this->count == this->width && slot == this->head) continue;
+      draw_column(this, this->sr.xMin + slot, slot, prev);
+    } else {
+      draw_column(this, this->sr.xMin + this->count - 1 - age, slot, prev);
+    }
+  }
+  this->stale = false;
+}
+
+static void draw_all(srn_strip_chart_t *this) {
+  clear_screen_region(&this->sr);
+  this->redraws++;
+  draw_columns(this);
+}
+
+// draws what the newest sample changed, in slot; full if the ring was full
+// before it
+static void draw_newest(srn_strip_chart_t *this, int slot, bool full) {
+  int prev = this->count > 1 ? age_slot(this, 1) : -1;
+  if (this->mode == SRN_STRIP_SWEEP) {
+    draw_column(this, this->sr.xMin + slot, slot, prev);
+    fill_vspan(this->sr.xMin + this->head, this->sr.yMin, this->sr.yMax, 0);
+  } else if (full) {
+    // every column moves, which srn_strip_present() draws once for all
+    // the samples since the last refresh
+    this->stale = true;
+  } else {
+    draw_column(this, this->sr.xMin + this->count - 1, slot, prev);
+  }
+}
+
+// RANGE
+
+static void set_range(srn_strip_chart_t *this, srn_fix_t lo, srn_fix_t hi) {
+  int height = this->sr.yMax - this->sr.yMin + 1;
+  this->lo = lo;
+  this->hi = hi;
+  this->scale = ((int64_t)height << 32) / ((int64_t)hi - lo);
+}
+
+static inline srn_fix_t saturate(int64_t v) {
+  if (v > INT32_MAX) return INT32_MAX;
+  if (v < INT32_MIN) return INT32_MIN;
+  return (srn_fix_t)v;
+}
+
+// Ranges the chart to its samples with an eighth of their spread above and
+// below.  Returns true if the range changed.
+static bool fit_range(srn_strip_chart_t *this) {
+  srn_fix_t min, max;
+  if (!srn_strip_min_max(this, &min, &max)) return false;
+  int64_t spread = (int64_t)max - min;
+  int64_t range = (int64_t)this->hi - this->lo;
+  if (min >= this->lo && max <= this->hi && spread * 4 >= range) return false;
+  int64_t pad = spread > 0 ? spread / 8 : 0;
+  if (pad == 0) pad = SRN_FIX_ONE;
+  srn_fix_t lo = saturate(min - pad);
+  srn_fix_t hi = saturate(max + pad);
+  if (lo == this->lo && hi == this->hi) return false;
+  set_range(this, lo, hi);
+  return true;
+}
+
+bool srn_strip_set_range_q(srn_strip_chart_t *this, srn_fix_t lo, srn_fix_t hi) {
+  if (lo >= hi) return false;
+  this->auto_range = false;
+  set_range(this, lo, hi);
+  draw_all(this);
+  return true;
+}
+
+bool srn_strip_set_range(srn_strip_chart_t *this, float lo, float hi) {
+  return srn_strip_set_range_q(this, srn_float_to_fix(lo), srn_float_to_fix(hi));
+}
+
+void srn_strip_auto_range(srn_strip_chart_t *this) {
+  this->auto_range = true;
+  if (fit_range(this)) draw_all(this);
+}
+
+// SAMPLES
+
+void srn_strip_add_q(srn_strip_chart_t *this, srn_fix_t value) {
+  int slot = this->head;
+  bool full = this->count == this->width;
+  if (full) {
+    drop_slot(this, this->min_slots, &this->min_first, &this->min_len, slot);
+    drop_slot(this, this->max_slots, &this->max_first, &this->max_len, slot);
+  } else {
+    this->count++;
+  }
+  this->samples[slot] = value;
+  push_slot(this, this->min_slots, this->min_first, &this->min_len, slot, false);
+  push_slot(this, this->max_slots, this->max_first, &this->max_len, slot, true);
+  this->head = wrap(this, slot + 1);
+  if (this->auto_range && fit_range(this)) {
+    draw_all(this);
+  } else {
+    draw_newest(this, slot, full);
+  }
+}
+
+void srn_strip_add(srn_strip_chart_t *this, float value) {
+  srn_strip_add_q(this, srn_float_to_fix(value));
+}
+
+void srn_strip_redraw(srn_strip_chart_t *this) {
+  draw_all(this);
+}
+
+void srn_strip_present(srn_strip_chart_t *this) {
+  if (this->stale) draw_columns(this);
+}
+
+void srn_strip_reset(srn_strip_chart_t *this) {
+  this->count = 0;
+  this->head = 0;
+  this->min_first = this->min_len = 0;
+  this->max_first = this->max_len = 0;
+  this->stale = false;
+  clear_screen_region(&this->sr);
+}
+
+bool srn_strip_init(srn_strip_chart_t *this, int pix_l, int pix_t, int pix_r, int pix_b,
+                    srn_strip_mode_t mode, srn_strip_style_t style) {
+  memset(this, 0, sizeof(*this));
+  // a sweep needs a column for the gap
+  if (pix_r <= pix_l || !set_screen_region(&this->sr, pix_l, pix_t, pix_r, pix_b)) return false;
+  this->mode = mode;
+  this->style = style;
+  this->width = pix_r - pix_l + 1;
+  set_range(this, 0, SRN_FIX_ONE);
+  srn_strip_reset(this);
+  return true;
+}
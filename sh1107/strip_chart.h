@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* strip_chart.h
+ * A strip chart keeps the samples it shows, one per column of its screen
+ * region, in a ring.  Each new sample takes the slot of the oldest one and
+ * only the columns it changes are drawn.  Because the history is kept,
+ * the chart can be drawn again at any time, after a clear or with a new Y
+ * range, and it can range Y to fit the samples by itself.
+ *
+ * There are two ways of moving along:
+ *   SRN_STRIP_SWEEP   the newest sample is drawn over the oldest, in its
+ *                     column, and the column after it is blanked to show
+ *                     where the chart is, like a sweeping oscilloscope.
+ *                     Each sample costs one column whatever the width.
+ *   SRN_STRIP_SCROLL  the newest sample is always at the right and the
+ *                     chart scrolls left under it, as with
+ *                     draw_next_as_line().  Once the ring is full a
+ *                     sample only goes into the ring, and
+ *                     srn_strip_present() draws the region from the ring,
+ *                     oldest slot first, before the refresh.  However
+ *                     many samples came in, that is one pass over the
+ *                     columns per refresh, all of which go to the display.
+ * A sweep sends one column per sample.  A scroll costs the same per sample
+ * whatever the width, but sends the whole chart on every refresh.
+ *
+ *   static srn_strip_chart_t chart;
+ *   srn_strip_init(&chart, 0, 64, 127, 127, SRN_STRIP_SWEEP, SRN_STRIP_LINE);
+ *   srn_strip_auto_range(&chart);
+ *   while (true) {
+ *     srn_strip_add_q(&chart, SRN_INT_TO_FIX(adc_read()));
+ *     srn_strip_present(&chart);  // only needed for SRN_STRIP_SCROLL
+ *     srn_refresh();
+ *   }
+ *
+ * With auto ranging the lowest and highest samples in the ring are kept
+ * up to date as samples come and go, at a fixed cost per sample.  The
+ * chart is ranged again, and drawn again, when a sample falls outside the
+ * range or when the samples have shrunk to under a quarter of it, so small
+ * changes do not make the whole chart redraw.
+ */
+
+#ifndef STRIP_CHART_H
+#define STRIP_CHART_H
+
+#include "pixel_ops.h"
+#include "draw_graphics.h"
+
+typedef enum srn_strip_mode {
+  SRN_STRIP_SWEEP,
+  SRN_STRIP_SCROLL,
+} srn_strip_mode_t;
+
+typedef enum srn_strip_style {
+  SRN_STRIP_LINE,     // each column joins its sample to the one before
+  SRN_STRIP_BAR,      // each column is filled from its sample down
+} srn_strip_style_t;
+
+typedef struct srn_strip_chart {
+  screen_region_t sr;
+  uint8_t mode;               // srn_strip_mode_t
+  uint8_t style;              // srn_strip_style_t
+  bool auto_range;
+  bool stale;                 // a scroll is behind its ring, see srn_strip_present()
+  int width;                  // columns, and slots in the ring
+  int count;                  // samples in the ring
+  int head;                   // the slot of the next sample
+  srn_fix_t lo, hi;           // the values of the bottom and top rows
+  int64_t scale;              // rows per value, 32 fraction bits
+  uint32_t redraws;           // whole charts drawn, rescales included
+  srn_fix_t samples[128];
+  // slots of the sliding minimum and maximum, oldest first, each a ring
+  // of width entries
+  uint8_t min_slots[128];
+  uint8_t max_slots[128];
+  int min_first, min_len;
+  int max_first, max_len;
+} srn_strip_chart_t;
+
+// Sets up an empty chart on the screen region pix_l, pix_t to pix_r, pix_b
+// inclusive, which it clears.  The Y range is 0 to 1 until it is set.
+// Returns false if the region is outside the display.
+bool srn_strip_init(srn_strip_chart_t *this, int pix_l, int pix_t, int pix_r, int pix_b,
+                    srn_strip_mode_t mode, srn_strip_style_t style);
+
+// Adds a sample and draws the columns it changes.
+void srn_strip_add(srn_strip_chart_t *this, float value);
+void srn_strip_add_q(srn_strip_chart_t *this, srn_fix_t value);
+
+// Sets the values at the bottom and top of the region, turns auto ranging
+// off and draws the chart again.  Returns false if lo is not below hi.
+bool srn_strip_set_range(srn_strip_chart_t *this, float lo, float hi);
+bool srn_strip_set_range_q(srn_strip_chart_t *this, srn_fix_t lo, srn_fix_t hi);
+
+// Turns auto ranging on, ranging the chart to its samples now.
+void srn_strip_auto_range(srn_strip_chart_t *this);
+
+// Clears the region and draws every sample in the ring again, for example
+// after something else was drawn over the chart.
+void srn_strip_redraw(srn_strip_chart_t *this);
+
+// Brings the region of a scrolling chart up to date with its samples.
+// Call it before the refresh that is to show them.  It does nothing for a
+// sweep, which is drawn as the samples come.
+void srn_strip_present(srn_strip_chart_t *this);
+
+// Forgets the samples and clears the region.
+void srn_strip_reset(srn_strip_chart_t *this);
+
+// The lowest and highest sample in the ring.  Returns false if it is empty.
+bool srn_strip_min_max(const srn_strip_chart_t *this, srn_fix_t *min, srn_fix_t *max);
+
+#endif
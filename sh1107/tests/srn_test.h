@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* srn_test.h
+ * The little there is to the host tests: CHECK() counts a failure and
+ * prints the first few, and srn_test_done() prints the tally and gives
+ * the exit status for ctest.  srn_test_rand() is a fixed sequence, so a
+ * failure happens again on the next run.
+ *
+ *   int main() {
+ *     CHECK(1 + 1 == 2);
+ *     CHECK(x == 3, "x is %d", x);
+ *     return srn_test_done("example");
+ *   }
+ */
+
+#ifndef SRN_TEST_H
+#define SRN_TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef SRN_TEST_MAX_REPORTS
+#define SRN_TEST_MAX_REPORTS 20
+#endif
+
+static int srn_test_checks;
+static int srn_test_failures;
+
+// _COND is evaluated once, so it may have side effects.  The message, if
+// any, is pasted after a space so the format is never empty.
+#define CHECK(_COND, ...) \
+  do { \
+    srn_test_checks++; \
+    if (!(_COND) && ++srn_test_failures <= SRN_TEST_MAX_REPORTS) { \
+      printf("%s:%d: %s failed:", __FILE__, __LINE__, #_COND); \
+      printf(" " __VA_ARGS__); \
+      printf("\n"); \
+    } \
+  } while (0)
+
+static inline int srn_test_done(const char *name) {
+  printf("%s: %d checks, %d failed\n", name, srn_test_checks, srn_test_failures);
+  return srn_test_failures != 0;
+}
+
+// xorshift32
+static uint32_t srn_test_seed = 2463534242u;
+
+static inline uint32_t srn_test_rand() {
+  uint32_t x = srn_test_seed;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return srn_test_seed = x;
+}
+
+// a number from 0 to n - 1
+static inline int srn_test_below(int n) {
+  return srn_test_rand() % n;
+}
+
+#endif
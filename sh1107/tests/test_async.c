@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_async.c
+ * Checks srn_refresh_async() against a fake transport whose transfers
+ * finish late: a pthread plays the part of the DMA, waits a while, feeds
+ * the bytes to the SH1107 simulator and only then calls
+ * sh1107_transfer_done().  It holds each frame until the main thread has
+ * drawn over the screen, so the drawing always happens with the frame in
+ * flight, and the main thread then refreshes again at once.  Each frame the panel ends up with
+ * must be the one drawn when its refresh was called, and no transfer may
+ * start while another is in flight.  Both kinds of transport are tried:
+ * one that takes streams and one that is given a segment at a time.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "sh1107_spi.h"
+#include "sh1107_transport.h"
+#include "sh1107_sim.h"
+#include "pixel_ops.h"
+#include "srn_test.h"
+
+#define ROUNDS 300
+
+static sh1107_sim_t sim;
+static srn_transport_t transport;
+
+// FAKE DMA
+// One transfer at a time, as the hardware would have it.
+
+static pthread_t dma_thread;
+static pthread_mutex_t dma_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dma_cond = PTHREAD_COND_INITIALIZER;
+static const uint8_t *job_buf;
+static int job_num;
+static bool job_cmd;
+static bool job_stream;
+static bool job_ready;
+static bool dma_quit;
+static int overlaps;
+static int released;      // frames the fake DMA may finish
+
+// what the panel showed at the end of each frame
+static srn_pixels_t drawn[2 * ROUNDS];
+static uint8_t shown[2 * ROUNDS][16][128];
+static int frames_shown;
+static int frames_drawn;
+
+static void start_job(const uint8_t *buf, int num, bool cmd, bool stream) {
+  pthread_mutex_lock(&dma_mutex);
+  if (job_ready) overlaps++;
+  job_buf = buf;
+  job_num = num;
+  job_cmd = cmd;
+  job_stream = stream;
+  job_ready = true;
+  pthread_cond_signal(&dma_cond);
+  pthread_mutex_unlock(&dma_mutex);
+}
+
+static void fake_start_stream(void *ctx, const uint8_t *stream, int num) {
+  start_job(stream, num, false, true);
+}
+
+static void fake_start_write(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  start_job(buf, num, cmd, false);
+}
+
+static void fake_write(void *ctx, const uint8_t *buf, int num, bool cmd) {
+  sh1107_sim_write(&sim, buf, num, cmd);
+}
+
+static void *dma_main(void *arg) {
+  uint32_t seed = 1234567u;
+  while (true) {
+    pthread_mutex_lock(&dma_mutex);
+    while (!(job_ready && frames_shown < released) && !dma_quit) {
+      pthread_cond_wait(&dma_cond, &dma_mutex);
+    }
+    if (!job_ready) {
+      pthread_mutex_unlock(&dma_mutex);
+      return NULL;
+    }
+    pthread_mutex_unlock(&dma_mutex);
+
+    // the bytes are read at the end, as slowly as a real transfer
+    seed = seed * 1103515245u + 12345u;
+    uint64_t until = srn_time_ns() + 20000 + (seed >> 16) % 200000;
+    while (srn_time_ns() < until) {}
+    if (job_stream) sh1107_sim_write_stream(&sim, job_buf, job_num);
+    else sh1107_sim_write(&sim, job_buf, job_num, job_cmd);
+
+    sh1107_t *d = transport.display;
+    if (job_stream || d->next_segment >= d->num_segments) {
+      memcpy(shown[frames_shown++], sim.gddram, sizeof(sim.gddram));
+    }
+    pthread_mutex_lock(&dma_mutex);
+    job_ready = false;
+    pthread_mutex_unlock(&dma_mutex);
+    sh1107_transfer_done(d);
+  }
+}
+
+// DRAWING
+
+static void scribble() {
+  for (int i = 0; i < 12; i++) {
+    int x = srn_test_below(128), y = srn_test_below(128);
+    fill_rect(x, y, x + srn_test_below(60), y + srn_test_below(60), srn_test_rand() & 1);
+  }
+}
+
+// lets the fake DMA finish the frames drawn so far
+static void release() {
+  pthread_mutex_lock(&dma_mutex);
+  released = frames_drawn;
+  pthread_cond_signal(&dma_cond);
+  pthread_mutex_unlock(&dma_mutex);
+}
+
+// An asynchronous refresh is left in flight, drawn over and released.  A
+// refresh that waits is released first.
+static void refresh(bool async) {
+  memcpy(drawn[frames_drawn++], srn_display_pixels, sizeof(srn_pixels_t));
+  if (async) {
+    CHECK(srn_refresh_async());
+    CHECK(srn_refresh_busy(), "frame %d finished at once", frames_drawn - 1);
+    scribble();
+  } else {
+    release();
+    srn_refresh();
+    CHECK(!srn_refresh_busy());
+    // without streams a refresh that waits is written, not started
+    if (transport.start_stream == NULL) {
+      memcpy(shown[frames_shown++], sim.gddram, sizeof(sim.gddram));
+    }
+  }
+  release();
+}
+
+static void run(bool streams) {
+  const char *name = streams ? "streams" : "segments";
+  frames_drawn = frames_shown = 0;
+  release();
+  for (int round = 0; round < ROUNDS; round++) {
+    scribble();
+    refresh(true);
+    // right behind the last, which may still be going
+    refresh(srn_test_below(2));
+  }
+  srn_refresh_wait();
+  CHECK(frames_shown == frames_drawn, "%s: %d frames shown of %d", name, frames_shown,
+        frames_drawn);
+  int bad = 0;
+  for (int f = 0; f < frames_shown && f < frames_drawn; f++) {
+    for (int j = 0; j < 16; j++) {
+      for (int c = 0; c < 128; c++) {
+        if (shown[f][j][c] != SRN_FB_BYTE(drawn[f], j, c)) {
+          if (bad++ == 0) printf("%s: frame %d page %d column %d differs\n", name, f, j, c);
+          goto next;
+        }
+      }
+    }
+  next:;
+  }
+  CHECK(bad == 0, "%s: %d frames not as drawn", name, bad);
+  CHECK(overlaps == 0, "%s: %d transfers started over another", name, overlaps);
+}
+
+int main() {
+  sh1107_sim_init(&sim, 1000 * 1000);
+  transport.write = fake_write;
+  transport.start_write = fake_start_write;
+  transport.ctx = &sim;
+  srn_set_transport(&transport);
+  pthread_create(&dma_thread, NULL, dma_main, NULL);
+
+  // start from a panel that matches the buffer
+  srn_refresh_full();
+  transport.start_stream = fake_start_stream;
+  run(true);
+  transport.start_stream = NULL;
+  run(false);
+
+  pthread_mutex_lock(&dma_mutex);
+  dma_quit = true;
+  pthread_cond_signal(&dma_cond);
+  pthread_mutex_unlock(&dma_mutex);
+  pthread_join(dma_thread, NULL);
+  return srn_test_done("async");
+}
@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_bitblt.c
+ * Checks bitblt() and bitblt_rect() pixel by pixel against a model that
+ * reads and writes one pixel at a time.  Bitmaps are the screen and page-
+ * major bitmaps of random sizes at word and byte aligned addresses, the
+ * rectangles run off their edges, and a third of the blits are from a
+ * bitmap onto itself, so overlapping copies both ways are covered.  The
+ * screen is column-major when the test is built with SRN_COLUMN_MAJOR.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "bitblt.h"
+#include "srn_test.h"
+
+#define ROUNDS 5000
+
+static uint8_t bufs[3][4096 + 8] __attribute__((aligned(4)));
+static uint8_t src_copy[128][128], dst_copy[128][128];
+
+static int get(const srn_bitmap_t *bm, int x, int y) {
+  return (bm->pixels[(y >> 3) * bm->page_stride + x * bm->col_stride] >> (y & 7)) & 1;
+}
+
+static void put(srn_bitmap_t *bm, int x, int y, int v) {
+  uint8_t *p = &bm->pixels[(y >> 3) * bm->page_stride + x * bm->col_stride];
+  if (v) *p |= 1 << (y & 7);
+  else *p &= ~(1 << (y & 7));
+}
+
+static int model(int d, int s, srn_rop_t rop) {
+  switch (rop) {
+  case SRN_ROP_COPY: return s;
+  case SRN_ROP_OR: return d | s;
+  case SRN_ROP_AND: return d & s;
+  case SRN_ROP_AND_NOT: return d & !s;
+  case SRN_ROP_XOR: return d ^ s;
+  case SRN_ROP_NOT_COPY: return !s;
+  case SRN_ROP_INVERT: return !d;
+  case SRN_ROP_CLEAR: return 0;
+  case SRN_ROP_SET: return 1;
+  }
+  return d;
+}
+
+static inline bool inside(const screen_region_t *r, int x, int y) {
+  return x >= r->xMin && x <= r->xMax && y >= r->yMin && y <= r->yMax;
+}
+
+// a bitmap of up to 70 x 70 pixels, at an offset of 0 to 3 bytes from a
+// word half the time and with a width that is a multiple of 4 half the time
+static void random_bitmap(srn_bitmap_t *bm, uint8_t *buf) {
+  int w = 1 + srn_test_below(70);
+  int h = 1 + srn_test_below(70);
+  int offset = srn_test_below(2) ? 0 : srn_test_below(4);
+  if (srn_test_below(2)) w = (w + 3) & ~3;
+  srn_bitmap_init(bm, buf + offset, w, h);
+}
+
+int main() {
+  int rops_seen[SRN_ROP_SET + 1] = {0};
+  int overlaps = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    srn_bitmap_t bms[3];
+    srn_screen_bitmap(&bms[0]);
+    random_bitmap(&bms[1], bufs[1]);
+    random_bitmap(&bms[2], bufs[2]);
+    for (int i = 0; i < 3; i++) {
+      for (int y = 0; y < bms[i].height; y++) {
+        for (int x = 0; x < bms[i].width; x++) put(&bms[i], x, y, srn_test_rand() & 1);
+      }
+    }
+    int si = srn_test_below(3);
+    int di = srn_test_below(3) == 0 ? si : srn_test_below(3);
+    srn_bitmap_t *src = &bms[si], *dst = &bms[di];
+    for (int y = 0; y < src->height; y++) {
+      for (int x = 0; x < src->width; x++) src_copy[y][x] = get(src, x, y);
+    }
+    for (int y = 0; y < dst->height; y++) {
+      for (int x = 0; x < dst->width; x++) dst_copy[y][x] = get(dst, x, y);
+    }
+
+    // rectangles and positions up to 10 pixels off the edges
+    screen_region_t r;
+    r.xMin = srn_test_below(src->width + 20) - 10;
+    r.yMin = srn_test_below(src->height + 20) - 10;
+    r.xMax = r.xMin + srn_test_below(80) - 5;
+    r.yMax = r.yMin + srn_test_below(80) - 5;
+    int dx = srn_test_below(dst->width + 20) - 10;
+    int dy = srn_test_below(dst->height + 20) - 10;
+    srn_rop_t rop = round % (SRN_ROP_SET + 1);
+    bool rect = srn_test_below(5) == 0;
+    rops_seen[rop]++;
+    if (rect) {
+      bitblt_rect(dst, &r, rop);
+    } else {
+      bitblt(src, &r, dst, dx, dy, rop);
+      if (src == dst) overlaps++;
+    }
+
+    for (int y = 0; y < dst->height; y++) {
+      for (int x = 0; x < dst->width; x++) {
+        int expect = dst_copy[y][x];
+        if (rect) {
+          if (inside(&r, x, y)) expect = model(expect, 0, rop);
+        } else {
+          int sx = x - dx + r.xMin, sy = y - dy + r.yMin;
+          if (inside(&r, sx, sy) && sx >= 0 && sy >= 0 && sx < src->width && sy < src->height) {
+            expect = model(expect, src_copy[sy][sx], rop);
+          }
+        }
+        if (get(dst, x, y) != expect) {
+          CHECK(false, "round %d %s rop %d src %d dst %d rect %d,%d to %d,%d at %d,%d: "
+                "pixel %d,%d", round, rect ? "bitblt_rect" : "bitblt", rop, si, di,
+                r.xMin, r.yMin, r.xMax, r.yMax, dx, dy, x, y);
+          goto next;
+        }
+      }
+    }
+    CHECK(true);
+  next:;
+  }
+  for (int rop = 0; rop <= SRN_ROP_SET; rop++) CHECK(rops_seen[rop] > 0, "rop %d not tried", rop);
+  CHECK(overlaps > ROUNDS / 10, "only %d overlapping blits", overlaps);
+  return srn_test_done("bitblt");
+}
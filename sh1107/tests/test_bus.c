@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_bus.c
+ * Checks that two panels sharing one SPI port take turns.  Two displays
+ * have their own SH1107 simulator, both on one srn_bus_t, and random
+ * drawing, asynchronous refreshes and completions of the transfer on the
+ * wire are mixed on them, with whole frames as streams and then a segment
+ * at a time.  A refresh of one display while the other holds the port
+ * must be queued rather than sent, only one panel may be sending at a
+ * time, and each panel must end up showing its own display's pixels.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "sh1107_transport.h"
+#include "pixel_ops.h"
+#include "sh1107_sim.h"
+#include "srn_bus.h"
+#include "srn_test.h"
+
+#define ROUNDS 20000
+
+static sh1107_sim_t sims[2];
+static sh1107_t right;
+static sh1107_buffers_t right_buffers;
+static sh1107_t *displays[2] = {&srn_default_display, &right};
+static srn_bus_t bus;
+
+static int wrong_pixels(int d) {
+  int wrong = 0;
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 128; x++) {
+      int p = (SRN_FB_BYTE(*displays[d]->output, y >> 3, x) >> (y & 7)) & 1;
+      if (sh1107_sim_pixel(&sims[d], x, y) != p) wrong++;
+    }
+  }
+  return wrong;
+}
+
+// completes transfers until neither panel is sending
+static void drain() {
+  while (sh1107_sim_complete(&sims[0]) || sh1107_sim_complete(&sims[1])) {}
+}
+
+static void run(bool streams) {
+  for (int d = 0; d < 2; d++) {
+    sh1107_sim_init(&sims[d], 1000 * 1000);
+    sh1107_sim_enable_streams(&sims[d], streams);
+    sh1107_sim_share_bus(&sims[d], &bus);
+    sh1107_set_transport(displays[d], sh1107_sim_transport(&sims[d]));
+    sh1107_select(displays[d]);
+    srn_turn_display_on(true);
+    memset(srn_display_pixels, 0, sizeof(srn_display_pixels));
+    srn_mark_all_dirty();
+  }
+  uint32_t queued = 0;
+  for (int t = 0; t < ROUNDS; t++) {
+    int d = srn_test_below(2);
+    switch (srn_test_below(3)) {
+    case 0: { // draw, which is fine while a frame is on the wire
+      sh1107_select(displays[d]);
+      int x = srn_test_below(128), y = srn_test_below(128);
+      fill_rect(x, y, x + srn_test_below(40), y + srn_test_below(40), srn_test_below(2));
+      break;
+    }
+    case 1: // refresh unless the last one of the display is still going
+      if (sh1107_refresh_busy(displays[d])) break;
+      sh1107_refresh_async(displays[d]);
+      if (sims[1 - d].sending && sh1107_refresh_busy(displays[d])) {
+        CHECK(!sims[d].sending, "round %d: panel %d started on a held port", t, d);
+        queued++;
+      }
+      break;
+    default:
+      sh1107_sim_complete(&sims[d]);
+      break;
+    }
+    CHECK(!(sims[0].sending && sims[1].sending), "round %d: both panels sending", t);
+    CHECK(bus.owner == NULL || bus.owner->ctx == &sims[0] || bus.owner->ctx == &sims[1],
+          "round %d: port held by a stranger", t);
+  }
+  CHECK(queued > 0, "no refresh was ever queued");
+
+  // one last refresh of each, then both must show their own pixels
+  drain();
+  for (int d = 0; d < 2; d++) sh1107_refresh_async(displays[d]);
+  drain();
+  for (int d = 0; d < 2; d++) {
+    CHECK(!sh1107_refresh_busy(displays[d]), "display %d still busy", d);
+    int wrong = wrong_pixels(d);
+    CHECK(wrong == 0, "streams %d: panel %d has %d pixels wrong", streams, d, wrong);
+  }
+  CHECK(bus.owner == NULL && bus.head == NULL, "the port was not given back");
+}
+
+int main() {
+  srn_bus_init(&bus);
+  sh1107_init(&right, &right_buffers);
+  run(true);
+  run(false);
+  return srn_test_done("bus");
+}
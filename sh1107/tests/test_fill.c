@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_fill.c
+ * Checks the span fills, and the drawing that was moved onto them, against
+ * the pixel at a time code they replaced: fill_vspan(), fill_hspan() and
+ * fill_rect() against put_pixel() loops, bars from draw_next_as_bar(),
+ * axis lines from draw_line() against the float DDA, and clears of screen
+ * regions.  Every changed pixel must also be in the dirty spans.  The
+ * pixel buffer starts each round with random contents.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "pixel_ops.h"
+#include "draw_graphics.h"
+#include "srn_test.h"
+
+#define ROUNDS 20000
+
+static srn_pixels_t before, expect;
+
+static inline int pixel(const srn_pixels_t *pixels, int x, int y) {
+  return (SRN_FB_BYTE(*pixels, y >> 3, x) >> (y & 7)) & 1;
+}
+
+static inline void model_pixel(int x, int y, int b) {
+  if (x < 0 || x > 127 || y < 0 || y > 127) return;
+  uint8_t *p = &SRN_FB_BYTE(expect, y >> 3, x);
+  if (b) *p |= 1 << (y & 7);
+  else *p &= ~(1 << (y & 7));
+}
+
+static void start() {
+  for (int page = 0; page < 16; page++) {
+    for (int col = 0; col < 128; col++) SRN_PAGE_BYTE(page, col) = srn_test_rand();
+  }
+  memcpy(before, srn_display_pixels, sizeof(before));
+  memcpy(expect, srn_display_pixels, sizeof(expect));
+  memset(srn_dirty_min, 0xFF, sizeof(srn_dirty_min));
+  memset(srn_dirty_max, 0, sizeof(srn_dirty_max));
+}
+
+static void check(const char *what, int round) {
+  int wrong = 0, undirty = 0;
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 128; x++) {
+      int p = pixel(&srn_display_pixels, x, y);
+      if (p != pixel(&expect, x, y)) wrong++;
+      if (p != pixel(&before, x, y) && (x < srn_dirty_min[y >> 3] || x > srn_dirty_max[y >> 3])) {
+        undirty++;
+      }
+    }
+  }
+  CHECK(wrong == 0, "%s round %d: %d pixels differ", what, round, wrong);
+  CHECK(undirty == 0, "%s round %d: %d changed pixels not dirty", what, round, undirty);
+}
+
+// from a little off one side of the display to a little off the other
+static inline int coord() {
+  return srn_test_below(148) - 10;
+}
+
+static void random_region(screen_region_t *sr) {
+  int l = srn_test_below(120), t = srn_test_below(120);
+  set_screen_region(sr, l, t, l + 1 + srn_test_below(127 - l), t + 1 + srn_test_below(127 - t));
+}
+
+// SPANS
+
+static void test_spans(int round) {
+  start();
+  int b = srn_test_below(2);
+  int x0 = coord(), x1 = coord(), y0 = coord(), y1 = coord();
+  switch (round % 3) {
+  case 0:
+    fill_vspan(x0, y0, y1, b);
+    for (int y = y0; y <= y1; y++) model_pixel(x0, y, b);
+    check("fill_vspan", round);
+    break;
+  case 1:
+    fill_hspan(y0, x0, x1, b);
+    for (int x = x0; x <= x1; x++) model_pixel(x, y0, b);
+    check("fill_hspan", round);
+    break;
+  case 2:
+    fill_rect(x0, y0, x1, y1, b);
+    for (int y = y0; y <= y1; y++) {
+      for (int x = x0; x <= x1; x++) model_pixel(x, y, b);
+    }
+    check("fill_rect", round);
+    break;
+  }
+}
+
+// BARS
+// Fewer bars than columns, so the region does not scroll.
+
+static void test_bars(int round) {
+  graph_screen_region_t g;
+  screen_region_t sr;
+  random_region(&sr);
+  start();
+  map_autoscroll_bar_window(&g, 1.0f, -1.0f, sr.xMin, sr.yMin, sr.xMax, sr.yMax);
+  memcpy(expect, srn_display_pixels, sizeof(expect));
+  int bars = srn_test_below(sr.xMax - sr.xMin);
+  for (int i = 0; i < bars; i++) {
+    // a fifth of the values are off the top or the bottom
+    float v = (srn_test_rand() / 4294967296.0f * 2 - 1) * 1.25f;
+    draw_next_as_bar(&g, v);
+    for (int y = (int)(v * g.yscl + g.yoff); y <= g.sr.yMax; y++) {
+      if (y >= g.sr.yMin) model_pixel(g.next_x, y, 1);
+    }
+  }
+  check("draw_next_as_bar", round);
+}
+
+// AXIS LINES
+// With a window one unit to a pixel, the float DDA drew from the first end
+// up to but not including the second.
+
+static void test_axis_lines(int round) {
+  graph_screen_region_t g;
+  start();
+  map_window(&g, 0, 0, 128, 128, 0, 0, 127, 127);
+  memcpy(expect, srn_display_pixels, sizeof(expect));
+  int a = coord(), b = coord(), c = coord();
+  if (a == b) b++;
+  int step = a < b ? 1 : -1;
+  if (round & 1) {
+    draw_line(&g, a, c, b, c);
+    for (int x = a; x != b; x += step) model_pixel(x, c, 1);
+  } else {
+    draw_line(&g, c, a, c, b);
+    for (int y = a; y != b; y += step) model_pixel(c, y, 1);
+  }
+  check("axis line", round);
+}
+
+// CLEARS
+
+static void test_clear(int round) {
+  screen_region_t sr;
+  random_region(&sr);
+  start();
+  clear_screen_region(&sr);
+  for (int y = sr.yMin; y <= sr.yMax; y++) {
+    for (int x = sr.xMin; x <= sr.xMax; x++) model_pixel(x, y, 0);
+  }
+  check("clear_screen_region", round);
+}
+
+int main() {
+  for (int round = 0; round < ROUNDS; round++) {
+    switch (round % 4) {
+    case 0: test_spans(round / 4); break;
+    case 1: test_bars(round / 4); break;
+    case 2: test_axis_lines(round / 4); break;
+    case 3: test_clear(round / 4); break;
+    }
+  }
+  return srn_test_done("fill");
+}
@@ -0,0 +1,229 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_fonts.c
+ * Checks the built in font packs and the registry.  The 2x and 3x packs
+ * must be font8x8_basic with every pixel scaled up, the proportional
+ * metrics must cover exactly the lit columns of each glyph, and
+ * srn_font_find() must find the built in fonts and registered ones, with
+ * a registered font replacing a built in one of the same name.  Random
+ * text printed into char regions in each font, wrapping and scrolling,
+ * must match a pixel at a time model drawn from font8x8_basic.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "pixel_ops.h"
+#include "draw_char.h"
+#include "srn_fonts.h"
+#include "sh1107_sim.h"
+#include "srn_test.h"
+
+#define ROUNDS 2000
+
+// defined in draw_char.c, a column per byte with the top row in bit 0
+extern char font8x8_basic[128][8];
+
+static sh1107_sim_t sim;
+static srn_pixels_t expect;
+
+static inline int pixel(const srn_pixels_t *pixels, int x, int y) {
+  return (SRN_FB_BYTE(*pixels, y >> 3, x) >> (y & 7)) & 1;
+}
+
+static inline int basic_pixel(uint8_t chr, int col, int row) {
+  return chr < 128 ? (font8x8_basic[chr][col] >> row) & 1 : 0;
+}
+
+// a pixel of a glyph as stored in a srn_font_t
+static int glyph_pixel(const srn_font_t *font, uint8_t chr, int col, int row) {
+  int pages = (font->height + 7) >> 3;
+  const uint8_t *glyph = font->glyphs + (chr - font->first) * font->cell_width * pages;
+  return (glyph[(row >> 3) * font->cell_width + col] >> (row & 7)) & 1;
+}
+
+// PACKS
+
+static void test_scaled(const char *name, const srn_font_t *font, int scale, int first,
+                        int last) {
+  CHECK(font->first == first && font->last == last, "%s has %d to %d", name, font->first,
+        font->last);
+  CHECK(font->cell_width == 8 * scale && font->height == 8 * scale, "%s is %d by %d", name,
+        font->cell_width, font->height);
+  int wrong = 0;
+  for (int chr = first; chr <= last; chr++) {
+    for (int row = 0; row < font->height; row++) {
+      for (int col = 0; col < font->cell_width; col++) {
+        if (glyph_pixel(font, chr, col, row) != basic_pixel(chr, col / scale, row / scale)) {
+          wrong++;
+        }
+      }
+    }
+  }
+  CHECK(wrong == 0, "%s: %d pixels are not font8x8_basic scaled by %d", name, wrong, scale);
+}
+
+static void test_metrics() {
+  const srn_font_t *font = &srn_font8x8_prop;
+  for (int chr = font->first; chr <= font->last; chr++) {
+    int lit_min = 8, lit_max = -1;
+    for (int col = 0; col < 8; col++) {
+      if (font8x8_basic[chr][col] == 0) continue;
+      if (col < lit_min) lit_min = col;
+      lit_max = col;
+    }
+    const srn_glyph_metrics_t *m = &font->metrics[chr - font->first];
+    if (chr == ' ') {
+      CHECK(m->width == 3, "a space %d columns wide", m->width);
+    } else if (lit_max < 0) {
+      CHECK(m->width == 0, "blank 0x%02x %d columns wide", chr, m->width);
+    } else {
+      CHECK(m->left == lit_min && m->width == lit_max - lit_min + 1,
+            "0x%02x is columns %d to %d, metrics %d and %d", chr, lit_min, lit_max, m->left,
+            m->width);
+    }
+  }
+}
+
+// REGISTRY
+
+static void test_registry() {
+  CHECK(srn_font_find("8x8") == &srn_font8x8);
+  CHECK(srn_font_find("8x8_prop") == &srn_font8x8_prop);
+  CHECK(srn_font_find("16x16") == &srn_font8x8_2x);
+  CHECK(srn_font_find("24x24_digits") == &srn_font8x8_3x_digits);
+  CHECK(srn_font_find("12x12") == NULL);
+
+  // the registry takes SRN_FONTS_MAX_REGISTERED names, and a name given
+  // again takes no more room
+  static char names[SRN_FONTS_MAX_REGISTERED][8];
+  for (int i = 0; i < SRN_FONTS_MAX_REGISTERED - 1; i++) {
+    snprintf(names[i], sizeof(names[i]), "pack%d", i);
+    CHECK(srn_font_register(names[i], &srn_font8x8_prop));
+  }
+  CHECK(srn_font_register("pack0", &srn_font8x8_2x));
+  CHECK(srn_font_find("pack0") == &srn_font8x8_2x, "a name given again is not replaced");
+  CHECK(srn_font_find("pack1") == &srn_font8x8_prop);
+  // the last slot replaces a built in font
+  CHECK(srn_font_register("8x8", &srn_font8x8_3x_digits));
+  CHECK(srn_font_find("8x8") == &srn_font8x8_3x_digits, "a built in font was not replaced");
+  CHECK(!srn_font_register("one_more", &srn_font8x8), "the registry took too many fonts");
+  CHECK(srn_font_find("one_more") == NULL);
+}
+
+// CHAR REGIONS
+// A pixel at a time model of printing into a region: the cursor moves a
+// cell at a time, wraps at the right and scrolls the region up a cell
+// when it runs off the bottom.
+
+static const struct {
+  const srn_font_t *font;
+  int scale;
+} region_fonts[] = {
+  {&srn_font8x8, 1}, {&srn_font8x8_prop, 1}, {&srn_font8x8_2x, 2}, {&srn_font8x8_3x_digits, 3},
+};
+
+static int model_row, model_col;
+
+static void model_cell(const screen_region_t *sr, const srn_font_t *font, int scale,
+                       uint8_t chr) {
+  bool known = chr >= font->first && chr <= font->last;
+  for (int row = 0; row < 8 * scale; row++) {
+    for (int col = 0; col < 8 * scale; col++) {
+      int b = known && basic_pixel(chr, col / scale, row / scale);
+      uint8_t *p = &SRN_FB_BYTE(expect, (model_row * 8 + row) >> 3, model_col * 8 + col);
+      int bit = 1 << ((model_row * 8 + row) & 7);
+      if (b) *p |= bit;
+      else *p &= ~bit;
+    }
+  }
+}
+
+static void model_scroll(const screen_region_t *sr, int rows) {
+  for (int y = sr->yMin; y <= sr->yMax; y++) {
+    for (int x = sr->xMin; x <= sr->xMax; x++) {
+      int from = y + rows * 8;
+      int b = from <= sr->yMax && pixel(&expect, x, from);
+      uint8_t *p = &SRN_FB_BYTE(expect, y >> 3, x);
+      if (b) *p |= 1 << (y & 7);
+      else *p &= ~(1 << (y & 7));
+    }
+  }
+}
+
+static void model_char(const char_screen_region_t *csr, int scale, uint8_t chr) {
+  int last_row = csr->crow_bot - scale + 1;
+  if (model_row > last_row) {
+    model_scroll(&csr->sr, scale);
+    model_row = last_row;
+    model_col = csr->ccol_lft;
+  }
+  if (model_col + scale - 1 > csr->ccol_rgt || chr == '\n') {
+    model_row += scale;
+    model_col = csr->ccol_lft;
+    if (model_row > last_row) {
+      model_scroll(&csr->sr, scale);
+      model_row = last_row;
+    }
+  } else if (chr >= 0x20) {
+    model_cell(&csr->sr, csr->font, scale, chr);
+    model_col += scale;
+  }
+}
+
+static void test_region(int t) {
+  int f = srn_test_below(4);
+  const srn_font_t *font = region_fonts[f].font;
+  int scale = region_fonts[f].scale;
+  int l = srn_test_below(14), top = srn_test_below(14);
+  int r = l + srn_test_below(16 - l), b = top + srn_test_below(16 - top);
+  char_screen_region_t csr;
+  CHECK(init_char_screen_region(&csr, l, top, r, b));
+  bool fits = r - l + 1 >= scale && b - top + 1 >= scale;
+  CHECK(set_char_font(&csr, font) == fits, "round %d: %d by %d cells in a %d by %d region", t,
+        scale, scale, r - l + 1, b - top + 1);
+  if (!fits) return;
+
+  for (int page = 0; page < 16; page++) {
+    for (int col = 0; col < 128; col++) SRN_PAGE_BYTE(page, col) = srn_test_rand();
+  }
+  clear_text(&csr);
+  memcpy(expect, srn_display_pixels, sizeof(expect));
+  model_row = top;
+  model_col = l;
+  char str[40];
+  int n = srn_test_below(sizeof(str));
+  for (int i = 0; i < n; i++) {
+    int what = srn_test_below(20);
+    if (what == 0) str[i] = '\n';
+    else if (what == 1) str[i] = 1 + srn_test_below(0x1F);  // skipped
+    else str[i] = 0x20 + srn_test_below(0x5F);
+  }
+  str[n] = 0;
+  srn_print(&csr, str);
+  for (int i = 0; i < n; i++) model_char(&csr, scale, str[i]);
+  int wrong = 0;
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 128; x++) {
+      if (pixel(&srn_display_pixels, x, y) != pixel(&expect, x, y)) wrong++;
+    }
+  }
+  CHECK(wrong == 0, "round %d: %d pixels differ printing %d characters of font %d", t, wrong,
+        n, f);
+}
+
+int main() {
+  // srn_print() refreshes the region
+  sh1107_sim_init(&sim, 1000 * 1000);
+  srn_set_transport(sh1107_sim_transport(&sim));
+  test_scaled("16x16", &srn_font8x8_2x, 2, 0x20, 0x7E);
+  test_scaled("24x24_digits", &srn_font8x8_3x_digits, 3, ' ', ':');
+  test_metrics();
+  for (int t = 0; t < ROUNDS; t++) test_region(t);
+  test_registry();
+  return srn_test_done("fonts");
+}
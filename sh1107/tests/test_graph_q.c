@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_graph_q.c
+ * Checks that the fixed point graph functions draw within one pixel of the
+ * float ones.  Each round maps a random window of up to +-4000 onto a
+ * random screen region and draws a line, a point, or 150 samples of a bar
+ * or line graph both ways.  Every pixel of either picture must have a
+ * pixel of the other within one pixel, except on the edges of the region,
+ * where a pixel one side of the edge may be clipped off the other.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "pixel_ops.h"
+#include "draw_graphics.h"
+#include "srn_test.h"
+
+#define ROUNDS 5000
+#define SAMPLES 150
+
+static srn_pixels_t floats;
+static int graph[SAMPLES];
+
+static inline int pixel(const srn_pixels_t *pixels, int x, int y) {
+  return (SRN_FB_BYTE(*pixels, y >> 3, x) >> (y & 7)) & 1;
+}
+
+// the furthest a pixel of a is from the nearest pixel of b, up to 4, with
+// the edges of r left out
+static int distance(const srn_pixels_t *a, const srn_pixels_t *b, const screen_region_t *r) {
+  int worst = 0;
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 128; x++) {
+      if (!pixel(a, x, y)) continue;
+      if (x == r->xMin || x == r->xMax || y == r->yMin || y == r->yMax) continue;
+      int best = 4;
+      for (int v = y - 3; v <= y + 3; v++) {
+        for (int u = x - 3; u <= x + 3; u++) {
+          if (u < 0 || u > 127 || v < 0 || v > 127 || !pixel(b, u, v)) continue;
+          int d = abs(v - y) > abs(u - x) ? abs(v - y) : abs(u - x);
+          if (d < best) best = d;
+        }
+      }
+      if (best > worst) worst = best;
+    }
+  }
+  return worst;
+}
+
+int main() {
+  for (int t = 0; t < ROUNDS; t++) {
+    int l = srn_test_below(100), top = srn_test_below(100);
+    int r = l + 1 + srn_test_below(127 - l), b = top + 1 + srn_test_below(127 - top);
+    int wl = srn_test_below(4000) - 2000, wr = wl + 1 + srn_test_below(4000);
+    int wt = srn_test_below(4000) - 2000, wb = wt - 1 - srn_test_below(4000);
+    int x1 = wl + srn_test_below(wr - wl), x2 = wl + srn_test_below(wr - wl);
+    int y1 = wb + srn_test_below(wt - wb), y2 = wb + srn_test_below(wt - wb);
+    for (int i = 0; i < SAMPLES; i++) graph[i] = wb + srn_test_below(wt - wb);
+    int kind = t % 4;
+
+    graph_screen_region_t g;
+    memset(srn_display_pixels, 0, sizeof(srn_display_pixels));
+    if (kind < 2) map_window(&g, wl, wt, wr, wb, l, top, r, b);
+    else map_autoscroll_bar_window(&g, wt, wb, l, top, r, b);
+    switch (kind) {
+    case 0: draw_line(&g, x1, y1, x2, y2); break;
+    case 1: draw_point(&g, x1, y1); break;
+    case 2: for (int i = 0; i < SAMPLES; i++) draw_next_as_bar(&g, graph[i]); break;
+    case 3: for (int i = 0; i < SAMPLES; i++) draw_next_as_line(&g, graph[i]); break;
+    }
+    memcpy(floats, srn_display_pixels, sizeof(floats));
+
+    memset(srn_display_pixels, 0, sizeof(srn_display_pixels));
+    if (kind < 2) {
+      map_window_q(&g, SRN_INT_TO_FIX(wl), SRN_INT_TO_FIX(wt), SRN_INT_TO_FIX(wr),
+                   SRN_INT_TO_FIX(wb), l, top, r, b);
+    } else {
+      map_autoscroll_bar_window_q(&g, SRN_INT_TO_FIX(wt), SRN_INT_TO_FIX(wb), l, top, r, b);
+    }
+    switch (kind) {
+    case 0: draw_line_q(&g, SRN_INT_TO_FIX(x1), SRN_INT_TO_FIX(y1),
+                        SRN_INT_TO_FIX(x2), SRN_INT_TO_FIX(y2)); break;
+    case 1: draw_point_q(&g, SRN_INT_TO_FIX(x1), SRN_INT_TO_FIX(y1)); break;
+    case 2: for (int i = 0; i < SAMPLES; i++) draw_next_as_bar_q(&g, SRN_INT_TO_FIX(graph[i])); break;
+    case 3: for (int i = 0; i < SAMPLES; i++) draw_next_as_line_q(&g, SRN_INT_TO_FIX(graph[i])); break;
+    }
+
+    int d = distance(&floats, &srn_display_pixels, &g.sr);
+    CHECK(d <= 1, "round %d kind %d: float pixel %d from the _q ones", t, kind, d);
+    d = distance(&srn_display_pixels, &floats, &g.sr);
+    CHECK(d <= 1, "round %d kind %d: _q pixel %d from the float ones", t, kind, d);
+  }
+  return srn_test_done("graph_q");
+}
@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_hw_scroll.c
+ * Checks scrolling by the display start line.  Random drawing is mixed
+ * with vertical scrolls of the whole screen by whole pages, which go to
+ * srn_hw_scroll_pages(), and scrolls of other regions, which go the
+ * software way, and of a whole screen text region with scroll_text().
+ * Each scroll must leave the pixel buffer as a pixel at a
+ * time model of it, and after each refresh the SH1107 simulator must show
+ * the buffer with the start line at page_offset * 8.  A hardware scroll
+ * on its own must send only the pages it clears.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "pixel_ops.h"
+#include "draw_char.h"
+#include "sh1107_sim.h"
+#include "srn_test.h"
+
+#define ROUNDS 5000
+
+static sh1107_sim_t sim;
+static srn_pixels_t expect;
+
+static inline int pixel(const srn_pixels_t *pixels, int x, int y) {
+  return (SRN_FB_BYTE(*pixels, y >> 3, x) >> (y & 7)) & 1;
+}
+
+static inline void model_pixel(int x, int y, int b) {
+  uint8_t *p = &SRN_FB_BYTE(expect, y >> 3, x);
+  if (b) *p |= 1 << (y & 7);
+  else *p &= ~(1 << (y & 7));
+}
+
+// scroll_screen_region() a pixel at a time: each pixel takes the one
+// step pixels below or to the right of it, or 0 past the region
+static void model_scroll(const screen_region_t *sr, int x_step, int y_step) {
+  srn_pixels_t from;
+  memcpy(from, expect, sizeof(from));
+  for (int y = sr->yMin; y <= sr->yMax; y++) {
+    for (int x = sr->xMin; x <= sr->xMax; x++) {
+      int u = x + x_step, v = y + y_step;
+      bool inside = u >= sr->xMin && u <= sr->xMax && v >= sr->yMin && v <= sr->yMax;
+      model_pixel(x, y, inside && pixel(&from, u, v));
+    }
+  }
+}
+
+static void check_buffer(const char *what, int t) {
+  int wrong = 0;
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 128; x++) {
+      if (pixel(&srn_display_pixels, x, y) != pixel(&expect, x, y)) wrong++;
+    }
+  }
+  CHECK(wrong == 0, "round %d: %d pixels of the buffer differ after %s", t, wrong, what);
+}
+
+static void check_panel(int t) {
+  int wrong = 0;
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 128; x++) {
+      if (sh1107_sim_pixel(&sim, x, y) != pixel(&srn_display_pixels, x, y)) wrong++;
+    }
+  }
+  CHECK(wrong == 0, "round %d: %d pixels of the panel differ", t, wrong);
+  CHECK(sim.start_line == srn_display->page_offset * 8, "round %d: start line %d, offset %d",
+        t, sim.start_line, srn_display->page_offset);
+}
+
+static void refresh() {
+  switch (srn_test_below(3)) {
+  case 0:
+    srn_refresh();
+    break;
+  case 1:
+    srn_refresh_async();
+    srn_refresh_wait();
+    break;
+  default:
+    srn_refresh_region(srn_test_below(64), srn_test_below(64),
+                       64 + srn_test_below(64), 64 + srn_test_below(64));
+    srn_refresh();
+    break;
+  }
+}
+
+int main() {
+  sh1107_sim_init(&sim, 1000 * 1000);
+  srn_set_transport(sh1107_sim_transport(&sim));
+  srn_turn_display_on(true);
+  srn_fast_clear();
+  srn_enable_hw_scroll(true);
+  screen_region_t screen;
+  set_screen_region(&screen, 0, 0, 127, 127);
+  char_screen_region_t console;
+  init_char_screen_region(&console, 0, 0, 15, 15);
+  int hw_scrolls = 0;
+  for (int t = 0; t < ROUNDS; t++) {
+    int x = srn_test_below(128), y = srn_test_below(128);
+    int b = srn_test_below(2);
+    fill_rect(x, y, x + srn_test_below(40), y + srn_test_below(40), b);
+    memcpy(expect, srn_display_pixels, sizeof(expect));
+
+    int what = srn_test_below(4);
+    if (what == 0) {
+      // a scroll on its own sends only the pages it clears
+      refresh();
+      int pages = srn_test_below(31) - 15;
+      int offset = srn_display->page_offset;
+      sh1107_sim_reset_counters(&sim);
+      scroll_screen_region(&screen, 0, pages * 8);
+      model_scroll(&screen, 0, pages * 8);
+      check_buffer("a hardware scroll", t);
+      CHECK(srn_display->page_offset == ((offset + pages) & 15), "round %d: offset %d by %d "
+            "pages is %d", t, offset, pages, srn_display->page_offset);
+      srn_refresh();
+      // 15 pages are cheaper as one run down every column
+      CHECK(abs(pages) == 15 || sim.data_bytes == (uint64_t)abs(pages) * 128,
+            "round %d: %d page scroll sent %d bytes", t, pages, (int)sim.data_bytes);
+      hw_scrolls += pages != 0;
+    } else if (what == 1) {
+      // not whole pages, or not the whole screen: the software way
+      screen_region_t sr;
+      int l = srn_test_below(20), top = srn_test_below(20);
+      set_screen_region(&sr, l, top, 127 - srn_test_below(20) * (l == 0),
+                        127 - srn_test_below(20) * (top == 0));
+      int x_step = srn_test_below(2) ? 0 : srn_test_below(9) - 4;
+      int y_step = srn_test_below(33) - 16;
+      if (sr.xMin == 0 && sr.yMin == 0 && sr.xMax == 127 && sr.yMax == 127 && x_step == 0) {
+        y_step |= 1;
+      }
+      int offset = srn_display->page_offset;
+      scroll_screen_region(&sr, x_step, y_step);
+      model_scroll(&sr, x_step, y_step);
+      check_buffer("a software scroll", t);
+      CHECK(srn_display->page_offset == offset, "round %d: a software scroll moved the offset",
+            t);
+    } else if (what == 2) {
+      // a log console scrolling up its text rows
+      int rows = 1 + srn_test_below(4);
+      int offset = srn_display->page_offset;
+      scroll_text(&console, rows);
+      model_scroll(&screen, 0, rows * 8);
+      check_buffer("scroll_text()", t);
+      CHECK(srn_display->page_offset == ((offset + rows) & 15), "round %d: scroll_text() "
+            "did not move the offset", t);
+    }
+    refresh();
+    check_panel(t);
+  }
+  CHECK(hw_scrolls > 0);
+
+  // with hardware scrolling off every scroll is done in the buffer
+  srn_enable_hw_scroll(false);
+  int offset = srn_display->page_offset;
+  CHECK(!srn_hw_scroll_pages(2));
+  memcpy(expect, srn_display_pixels, sizeof(expect));
+  scroll_screen_region(&screen, 0, 16);
+  model_scroll(&screen, 0, 16);
+  check_buffer("a scroll with hardware scrolling off", ROUNDS);
+  CHECK(srn_display->page_offset == offset);
+  srn_refresh();
+  check_panel(ROUNDS);
+  return srn_test_done("hw_scroll");
+}
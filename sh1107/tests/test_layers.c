@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_layers.c
+ * Checks the layer composite against a pixel at a time model.  Random
+ * fills, text and scrolls go into random layers, layers are enabled,
+ * disabled and given new ops, and after each refresh (plain, asynchronous
+ * or of a region followed by a plain one) the SH1107 simulator must show
+ * the enabled layers combined in order.  Built against a three layer copy
+ * of the library in both layouts.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "pixel_ops.h"
+#include "draw_char.h"
+#include "sh1107_sim.h"
+#include "srn_test.h"
+
+#if SRN_NUM_LAYERS != 3
+#error "test_layers needs SRN_NUM_LAYERS=3"
+#endif
+
+#define ROUNDS 20000
+
+static sh1107_sim_t sim;
+static bool enabled[3] = {true, true, true};
+static srn_layer_op_t ops[3];
+
+static int model_pixel(int x, int y) {
+  int v = 0;
+  for (int l = 0; l < 3; l++) {
+    if (!enabled[l]) continue;
+    int b = (SRN_FB_BYTE(srn_default_display.layer_pixels[l], y >> 3, x) >> (y & 7)) & 1;
+    switch (l == 0 ? SRN_LAYER_OR : ops[l]) {
+    case SRN_LAYER_OR: v |= b; break;
+    case SRN_LAYER_ANDNOT: v &= !b; break;
+    case SRN_LAYER_XOR: v ^= b; break;
+    }
+  }
+  return v;
+}
+
+static void draw_something() {
+  srn_select_layer(srn_test_below(3));
+  int what = srn_test_below(100);
+  if (what < 40) {
+    int x = srn_test_below(128), y = srn_test_below(128);
+    fill_rect(x, y, x + srn_test_below(40), y + srn_test_below(40), srn_test_below(2));
+  } else if (what < 65) {
+    draw_text(&srn_font8x8_prop, NULL, srn_test_below(140) - 10, srn_test_below(140) - 10,
+              "Hi 42");
+  } else if (what < 75) {
+    fill_vspan(srn_test_below(128), srn_test_below(128), srn_test_below(128),
+               srn_test_below(2));
+  } else if (what < 85) {
+    screen_region_t sr;
+    int l = srn_test_below(100), t = srn_test_below(100);
+    set_screen_region(&sr, l, t, l + 1 + srn_test_below(127 - l), t + 1 + srn_test_below(127 - t));
+    scroll_screen_region(&sr, srn_test_below(9) - 4, srn_test_below(9) - 4);
+  } else {
+    int l = srn_test_below(3);
+    enabled[l] = srn_test_below(4) != 0;
+    ops[l] = srn_test_below(3);
+    srn_set_layer(l, enabled[l], ops[l]);
+  }
+}
+
+int main() {
+  sh1107_sim_init(&sim, 1000 * 1000);
+  srn_set_transport(sh1107_sim_transport(&sim));
+  srn_turn_display_on(true);
+  srn_fast_clear();
+  srn_refresh_full();
+  for (int t = 0; t < ROUNDS; t++) {
+    draw_something();
+    switch (srn_test_below(4)) {
+    case 0:
+      srn_refresh();
+      break;
+    case 1:
+      srn_refresh_async();
+      srn_refresh_wait();
+      break;
+    case 2:
+      srn_refresh_region(srn_test_below(64), srn_test_below(64),
+                         64 + srn_test_below(64), 64 + srn_test_below(64));
+      srn_refresh();
+      break;
+    default:
+      continue;
+    }
+    int wrong = 0;
+    for (int y = 0; y < 128; y++) {
+      for (int x = 0; x < 128; x++) {
+        if (sh1107_sim_pixel(&sim, x, y) != model_pixel(x, y)) wrong++;
+      }
+    }
+    CHECK(wrong == 0, "round %d: %d pixels differ", t, wrong);
+  }
+  return srn_test_done("layers");
+}
@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_line.c
+ * Checks draw_line() against the float DDA it replaced, on random lines
+ * in random windows.  Lines inside the window must give the same pixels
+ * except where float error in the old loop put a coordinate on the other
+ * side of an integer, which is rare and never more than a pixel out.
+ * Lines that run off the window must not draw outside it.  Lines from
+ * ends far off the screen must give exactly the pixels of the true line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sh1107_spi.h"
+#include "pixel_ops.h"
+#include "draw_graphics.h"
+#include "srn_test.h"
+
+#define LINES 20000
+#define FAR_LINES 2000
+
+static uint8_t ref[128][128];
+
+// the draw_line() of before the integer DDA, into ref
+static void old_line(graph_screen_region_t *g, float x1, float y1, float x2, float y2) {
+  x1 = x1 * g->xscl + g->xoff;
+  x2 = x2 * g->xscl + g->xoff;
+  y1 = y1 * g->yscl + g->yoff;
+  y2 = y2 * g->yscl + g->yoff;
+  float dx = x2 - x1, dy = y2 - y1;
+  float step = fabsf(dx) >= fabsf(dy) ? fabsf(dx) : fabsf(dy);
+  dx /= step;
+  dy /= step;
+  float x = x1, y = y1;
+  for (int i = 1; i <= step; i++) {
+    int xi = (int)x, yi = (int)y;
+    if (xi >= g->sr.xMin && xi <= g->sr.xMax && yi >= g->sr.yMin && yi <= g->sr.yMax) {
+      ref[yi][xi] = 1;
+    }
+    x += dx;
+    y += dy;
+  }
+}
+
+static inline int pixel(int x, int y) {
+  return (SRN_PAGE_BYTE(y >> 3, x) >> (y & 7)) & 1;
+}
+
+// a value from -scale to scale
+static float random_coord(float scale) {
+  return (srn_test_rand() / 4294967296.0f * 2 - 1) * scale;
+}
+
+// true if a pixel of the old line, or of the new one, is set within one
+// pixel of x, y
+static bool near(int x, int y, bool from_ref) {
+  for (int v = y - 1; v <= y + 1; v++) {
+    for (int u = x - 1; u <= x + 1; u++) {
+      if (u < 0 || u > 127 || v < 0 || v > 127) continue;
+      if (from_ref ? ref[v][u] : pixel(u, v)) return true;
+    }
+  }
+  return false;
+}
+
+// NEAR LINES
+
+static void test_near_lines() {
+  int mismatched = 0;
+  for (int t = 0; t < LINES; t++) {
+    memset(srn_display_pixels, 0, sizeof(srn_display_pixels));
+    memset(ref, 0, sizeof(ref));
+    graph_screen_region_t g;
+    int l = srn_test_below(100), top = srn_test_below(100);
+    int r = l + srn_test_below(128 - l), b = top + srn_test_below(128 - top);
+    map_window(&g, -1, 1, 1, -1, l, top, r, b);
+    // every other line runs off the window
+    bool inside = t & 1;
+    float scale = inside ? 1.0f : 3.0f;
+    float x1 = random_coord(scale), y1 = random_coord(scale);
+    float x2 = random_coord(scale), y2 = random_coord(scale);
+    draw_line(&g, x1, y1, x2, y2);
+    old_line(&g, x1, y1, x2, y2);
+
+    bool same = true;
+    for (int y = 0; y < 128; y++) {
+      for (int x = 0; x < 128; x++) {
+        int p = pixel(x, y);
+        if (p != ref[y][x]) same = false;
+        if (p) {
+          CHECK(x >= l && x <= r && y >= top && y <= b,
+                "line %d: pixel %d,%d outside %d,%d to %d,%d", t, x, y, l, top, r, b);
+        }
+        if (inside && p && !ref[y][x]) {
+          CHECK(near(x, y, true), "line %d: pixel %d,%d far from the old line", t, x, y);
+        }
+        if (inside && ref[y][x] && !p) {
+          CHECK(near(x, y, false), "line %d: old pixel %d,%d far from the line", t, x, y);
+        }
+      }
+    }
+    if (inside && !same) mismatched++;
+  }
+  // about 0.1% in practice
+  CHECK(mismatched * 200 <= LINES / 2, "%d of %d lines inside differ", mismatched, LINES / 2);
+  printf("%d of %d lines inside differ from the float DDA\n", mismatched, LINES / 2);
+}
+
+// FAR LINES
+// Lines through the window from ends up to 900000 pixels away, drawn one
+// unit to a pixel so the fixed point ends are exact.  The pixels must be
+// those of the exact line, worked out with 128 bit integers.
+
+static int64_t floor_div128(__int128 a, int64_t b) {
+  __int128 q = a / b;
+  if (a % b != 0 && (a < 0) != (b < 0)) q--;
+  return (int64_t)q;
+}
+
+// the exact pixel of step k of an axis from p moving by d
+static int64_t exact_pixel(int64_t k, int64_t p, int64_t d, int64_t step) {
+  return (p + floor_div128((__int128)k * d * SRN_FIX_ONE, step)) >> SRN_FIX_FRAC_BITS;
+}
+
+// the pixels of the exact line from x1, y1 to x2, y2, in fixed point, that
+// fall in g's region
+static void exact_line(graph_screen_region_t *g, int64_t x1, int64_t y1, int64_t x2, int64_t y2) {
+  int64_t dx = x2 - x1, dy = y2 - y1;
+  bool x_major = llabs(dx) >= llabs(dy);
+  int64_t step = x_major ? llabs(dx) : llabs(dy);
+  int64_t n = step / SRN_FIX_ONE;
+  // the major axis moves a whole pixel a step, so only the steps around
+  // the one at pixel 0 can be on the display
+  int64_t p = x_major ? x1 : y1;
+  int64_t d = x_major ? dx : dy;
+  int64_t k_zero = (d > 0 ? -p : p) >> SRN_FIX_FRAC_BITS;
+  int64_t k_lo = d > 0 ? k_zero - 2 : k_zero - 130;
+  for (int64_t k = k_lo; k <= k_lo + 132; k++) {
+    if (k < 0 || k >= n) continue;
+    int64_t x = exact_pixel(k, x1, dx, step);
+    int64_t y = exact_pixel(k, y1, dy, step);
+    if (x >= g->sr.xMin && x <= g->sr.xMax && y >= g->sr.yMin && y <= g->sr.yMax) ref[y][x] = 1;
+  }
+}
+
+static void test_far_lines() {
+  int drawn = 0;
+  for (int t = 0; t < FAR_LINES; t++) {
+    memset(srn_display_pixels, 0, sizeof(srn_display_pixels));
+    memset(ref, 0, sizeof(ref));
+    graph_screen_region_t g;
+    int l = srn_test_below(100), top = srn_test_below(100);
+    int r = l + srn_test_below(128 - l), b = top + srn_test_below(128 - top);
+    map_window(&g, l, top, r + 1, b + 1, l, top, r, b);
+    // through a point of the window from ends 100 to 999000 pixels away
+    double cx = l + srn_test_below((r - l + 1) * 256) / 256.0;
+    double cy = top + srn_test_below((b - top + 1) * 256) / 256.0;
+    int ux = srn_test_below(2001) - 1000, uy = srn_test_below(2001) - 1000;
+    if (ux == 0 && uy == 0) ux = 1;
+    int len1 = 1 + srn_test_below(999), len2 = 1 + srn_test_below(999);
+    float x1 = cx - ux * len1, y1 = cy - uy * len1;
+    float x2 = cx + ux * len2, y2 = cy + uy * len2;
+    draw_line(&g, x1, y1, x2, y2);
+    // x1 * SRN_FIX_ONE is exact, as draw_line() sees it
+    exact_line(&g, (int64_t)(x1 * SRN_FIX_ONE), (int64_t)(y1 * SRN_FIX_ONE),
+               (int64_t)(x2 * SRN_FIX_ONE), (int64_t)(y2 * SRN_FIX_ONE));
+    int wrong = 0, set = 0;
+    for (int y = 0; y < 128; y++) {
+      for (int x = 0; x < 128; x++) {
+        if (pixel(x, y) != ref[y][x]) wrong++;
+        set += ref[y][x];
+      }
+    }
+    if (set) drawn++;
+    CHECK(wrong == 0, "far line %d: %d pixels off the exact line", t, wrong);
+  }
+  printf("%d of %d far lines cross their window\n", drawn, FAR_LINES);
+}
+
+int main() {
+  test_near_lines();
+  test_far_lines();
+  return srn_test_done("line");
+}
@@ -0,0 +1,221 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_mirror.c
+ * Checks the run-length code of srn_mirror.h byte for byte at the limits
+ * of each kind of run, and that it decodes back to what went in.  Then
+ * frame sequences are mirrored, all equal, all different, alternating and
+ * random, through a write function that takes a few bytes at a time, and
+ * a viewer fed from the other end must show each frame sent.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "srn_mirror.h"
+#include "srn_test.h"
+
+static uint8_t delta[SRN_MIRROR_FRAME];
+static uint8_t code[SRN_MIRROR_MAX_BODY + 64];
+static uint8_t back[SRN_MIRROR_FRAME];
+
+// codes num bytes of delta, checks the code if want is not NULL and
+// checks it decodes to delta
+static void round_trip(int num, const uint8_t *want, int want_len, const char *name) {
+  int len = srn_mirror_encode(delta, num, code);
+  CHECK(len <= num + num / 64 + 2, "%s: %d bytes of code", name, len);
+  if (want) {
+    bool same = len == want_len && memcmp(code, want, len) == 0;
+    CHECK(same, "%s: %d bytes of code, %d expected", name, len, want_len);
+    if (!same) {
+      for (int i = 0; i < len && i < 24; i++) printf(" %02X", code[i]);
+      printf("\n");
+    }
+  }
+  memset(back, 0, num);
+  CHECK(srn_mirror_decode(code, len, back, num) && memcmp(back, delta, num) == 0,
+        "%s: did not decode", name);
+}
+
+static void fill(int from, int num, uint8_t b) {
+  memset(delta + from, b, num);
+}
+
+// distinct neighbours, none zero
+static void fill_different(int from, int num) {
+  for (int i = 0; i < num; i++) delta[from + i] = i % 255 + 1;
+}
+
+static void run_limits() {
+  uint8_t want[SRN_MIRROR_MAX_BODY];
+
+  fill(0, 128, 0);
+  round_trip(128, (const uint8_t[]){0x7F}, 1, "128 zeros");
+  fill(0, 129, 0);
+  round_trip(129, (const uint8_t[]){0x7F, 0x00}, 2, "129 zeros");
+
+  fill(0, 3, 0x11);
+  round_trip(3, (const uint8_t[]){0x80, 0x11}, 2, "3 repeats");
+  fill(0, 66, 0x11);
+  round_trip(66, (const uint8_t[]){0xBF, 0x11}, 2, "66 repeats");
+  fill(0, 67, 0x11);
+  round_trip(67, (const uint8_t[]){0xBF, 0x11, 0xC0, 0x11}, 4, "67 repeats");
+  // two the same are cheaper as literals
+  fill(0, 2, 0x11);
+  round_trip(2, (const uint8_t[]){0xC1, 0x11, 0x11}, 3, "2 repeats");
+
+  fill_different(0, 64);
+  want[0] = 0xFF;
+  memcpy(want + 1, delta, 64);
+  round_trip(64, want, 65, "64 literals");
+  fill_different(0, 65);
+  want[65] = 0xC0;
+  want[66] = delta[64];
+  round_trip(65, want, 67, "65 literals");
+
+  // a lone zero stays in an open literal run
+  memcpy(delta, (const uint8_t[]){0x01, 0x00, 0x02}, 3);
+  round_trip(3, (const uint8_t[]){0xC2, 0x01, 0x00, 0x02}, 4, "lone zero");
+
+  // whole frames
+  fill(0, SRN_MIRROR_FRAME, 0);
+  memset(want, 0x7F, 16);
+  round_trip(SRN_MIRROR_FRAME, want, 16, "unchanged frame");
+
+  fill(0, SRN_MIRROR_FRAME, 0xAB);
+  for (int i = 0; i < 31; i++) want[2 * i] = 0xBF, want[2 * i + 1] = 0xAB;
+  memcpy(want + 62, (const uint8_t[]){0xC1, 0xAB, 0xAB}, 3);
+  round_trip(SRN_MIRROR_FRAME, want, 65, "all equal frame");
+
+  fill_different(0, SRN_MIRROR_FRAME);
+  for (int i = 0; i < 32; i++) {
+    want[65 * i] = 0xFF;
+    memcpy(want + 65 * i + 1, delta + 64 * i, 64);
+  }
+  round_trip(SRN_MIRROR_FRAME, want, 32 * 65, "all different frame");
+
+  for (int i = 0; i < SRN_MIRROR_FRAME; i++) delta[i] = i & 1 ? 0xAA : 0x55;
+  round_trip(SRN_MIRROR_FRAME, NULL, 0, "alternating frame");
+}
+
+// runs of random kinds and lengths around the limits
+static void random_runs() {
+  static const int lengths[] = {1, 2, 3, 4, 63, 64, 65, 66, 67, 127, 128, 129};
+  for (int round = 0; round < 5000; round++) {
+    int i = 0;
+    while (i < SRN_MIRROR_FRAME) {
+      int n = srn_test_below(3) ? lengths[srn_test_below(12)] : 1 + srn_test_below(300);
+      if (n > SRN_MIRROR_FRAME - i) n = SRN_MIRROR_FRAME - i;
+      switch (srn_test_below(4)) {
+      case 0: fill(i, n, 0); break;
+      case 1: fill(i, n, srn_test_rand() | 1); break;
+      case 2: fill_different(i, n); break;
+      default:
+        for (int k = 0; k < n; k++) delta[i + k] = srn_test_below(4) ? 0 : srn_test_rand();
+      }
+      i += n;
+    }
+    round_trip(SRN_MIRROR_FRAME, NULL, 0, "random runs");
+  }
+}
+
+// MIRRORED SEQUENCES
+
+static uint8_t wire[1 << 16];
+static int wire_len;
+static int chunk;       // the most the write takes at once, 0 for any
+
+static int take(void *ctx, const uint8_t *buf, int num) {
+  int n = chunk > 0 && num > chunk ? chunk : num;
+  if (wire_len + n > (int)sizeof(wire)) n = sizeof(wire) - wire_len;
+  memcpy(wire + wire_len, buf, n);
+  wire_len += n;
+  return n;
+}
+
+static sh1107_t display;
+static srn_pixels_t pixels;
+static srn_mirror_t mirror;
+static srn_mirror_view_t view;
+
+// the frame as the viewer holds it, page by page
+static bool shown(const uint8_t *frame) {
+  for (int j = 0; j < 16; j++) {
+    for (int c = 0; c < 128; c++) {
+      if (frame[j * 128 + c] != SRN_FB_BYTE(pixels, j, c)) return false;
+    }
+  }
+  return true;
+}
+
+// mirrors pixels and feeds what comes out to the viewer
+static void mirror_frame(const char *name, int index) {
+  wire_len = 0;
+  bool queued = srn_mirror_frame(&mirror, pixels);
+  while (!srn_mirror_poll(&mirror)) {}
+  uint32_t frames = view.frames;
+  srn_mirror_view_feed(&view, wire, wire_len, NULL, NULL);
+  CHECK(view.frames == frames + (queued ? 1 : 0), "%s %d: frame not applied", name, index);
+  CHECK(view.errors == 0, "%s %d: %u errors", name, index, view.errors);
+  CHECK(shown(view.frame), "%s %d: viewer differs", name, index);
+}
+
+static void set_all(uint8_t b) {
+  for (int j = 0; j < 16; j++) {
+    for (int c = 0; c < 128; c++) SRN_FB_BYTE(pixels, j, c) = b;
+  }
+}
+
+static void set_different(int seed) {
+  for (int j = 0; j < 16; j++) {
+    for (int c = 0; c < 128; c++) SRN_FB_BYTE(pixels, j, c) = (j * 128 + c + seed) % 255 + 1;
+  }
+}
+
+static void sequences() {
+  for (chunk = 0; chunk <= 7; chunk += 7) {
+    srn_mirror_start(&mirror, &display, take, NULL, 0);
+    srn_mirror_view_init(&view);
+    for (int i = 0; i < 4; i++) {
+      set_all(0);
+      mirror_frame("all equal, blank", i);
+      set_all(0xFF);
+      mirror_frame("all equal, lit", i);
+    }
+    for (int i = 0; i < 40; i++) {
+      set_different(i);
+      mirror_frame("all different", i);
+    }
+    for (int i = 0; i < 40; i++) {
+      set_all(i & 1 ? 0xAA : 0x55);
+      mirror_frame("alternating", i);
+    }
+    // changes of run-limit lengths at random places
+    static const int lengths[] = {1, 2, 3, 64, 65, 66, 67, 128, 129};
+    for (int i = 0; i < 200; i++) {
+      int changes = 1 + srn_test_below(6);
+      for (int k = 0; k < changes; k++) {
+        int n = lengths[srn_test_below(9)];
+        int at = srn_test_below(SRN_MIRROR_FRAME - n);
+        uint8_t b = srn_test_rand();
+        bool same = srn_test_below(2);
+        for (int m = at; m < at + n; m++) {
+          SRN_FB_BYTE(pixels, m >> 7, m & 127) = same ? b : srn_test_rand();
+        }
+      }
+      mirror_frame("random", i);
+    }
+    CHECK(mirror.stats.keys >= 1 + mirror.stats.frames / (SRN_MIRROR_KEY_INTERVAL + 1),
+          "%u key frames of %u", mirror.stats.keys, mirror.stats.frames);
+    srn_mirror_stop(&mirror);
+  }
+}
+
+int main() {
+  run_limits();
+  random_runs();
+  sequences();
+  return srn_test_done("mirror");
+}
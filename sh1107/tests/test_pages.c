@@ -0,0 +1,224 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_pages.c
+ * Checks srn_pages_render() against a full frame render.  Random display
+ * lists of rectangles, lines, text, sprites, bitmaps and callbacks, running
+ * off every edge, are rendered a page at a time to one SH1107 simulator by
+ * a panel without pixel buffers.  The same items are drawn into the pixel
+ * buffer of srn_default_display with bitblt_rect(), draw_text(),
+ * draw_sprite() and bitblt(), and refreshed to a second simulator.  Both
+ * panels must show the same pixels, a whole render must send every page
+ * once, and srn_pages_render_range() must leave the other pages as they
+ * were.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "pixel_ops.h"
+#include "bitblt.h"
+#include "draw_char.h"
+#include "draw_sprite.h"
+#include "srn_fonts.h"
+#include "srn_pages.h"
+#include "sh1107_sim.h"
+#include "srn_test.h"
+
+#define ROUNDS 3000
+#define ITEMS 16
+#define BITMAPS 4
+
+static sh1107_sim_t full_sim, paged_sim;
+static sh1107_t panel;
+static srn_pages_t pages;
+static srn_bitmap_t screen;
+
+static srn_item_t items[ITEMS];
+static char strs[ITEMS][12];
+static screen_region_t call_rects[ITEMS];
+
+static uint8_t bitmap_pixels[BITMAPS][SRN_BITMAP_BYTES(40, 24)];
+static srn_bitmap_t bitmaps[BITMAPS];
+
+static const srn_font_t *fonts[] = {&srn_font8x8, &srn_font8x8_prop, &srn_font8x8_2x,
+                                    &srn_font8x8_3x_digits};
+static const srn_sprite_t *sprites[] = {&srn_icon_battery, &srn_icon_link, &srn_icon_warning};
+static const srn_rop_t shape_rops[] = {SRN_ROP_SET, SRN_ROP_CLEAR, SRN_ROP_INVERT};
+static const srn_rop_t source_rops[] = {SRN_ROP_COPY, SRN_ROP_OR, SRN_ROP_AND, SRN_ROP_AND_NOT,
+                                        SRN_ROP_XOR, SRN_ROP_NOT_COPY};
+
+// a callback item inverts its rectangle, in the band of each page
+static void draw_call(void *ctx, srn_bitmap_t *band, int page) {
+  const screen_region_t *r = ctx;
+  screen_region_t in_band = {r->xMin, r->yMin - page * 8, r->xMax, r->yMax - page * 8};
+  bitblt_rect(band, &in_band, SRN_ROP_INVERT);
+}
+
+// a coordinate that is off the display at times
+static int random_coord() {
+  return srn_test_below(176) - 24;
+}
+
+static void random_item(int i) {
+  srn_item_t *item = &items[i];
+  int x = random_coord(), y = random_coord();
+  int x1 = x + srn_test_below(60), y1 = y + srn_test_below(60);
+  switch (srn_test_below(6)) {
+  case SRN_ITEM_RECT:
+    *item = (srn_item_t)SRN_RECT(x, y, x1, y1, shape_rops[srn_test_below(3)]);
+    break;
+  case SRN_ITEM_LINE:
+    *item = (srn_item_t)SRN_LINE(x, y, random_coord(), random_coord(),
+                                 shape_rops[srn_test_below(3)]);
+    break;
+  case SRN_ITEM_TEXT: {
+    int n = srn_test_below(sizeof(strs[i]));
+    for (int c = 0; c < n; c++) strs[i][c] = 0x20 + srn_test_below(0x5F);
+    strs[i][n] = 0;
+    *item = (srn_item_t)SRN_TEXT(x, y, fonts[srn_test_below(4)], strs[i]);
+    break;
+  }
+  case SRN_ITEM_SPRITE:
+    *item = (srn_item_t)SRN_SPRITE(x, y, sprites[srn_test_below(3)]);
+    break;
+  case SRN_ITEM_BITMAP:
+    *item = (srn_item_t)SRN_BITMAP(x, y, &bitmaps[srn_test_below(BITMAPS)],
+                                   source_rops[srn_test_below(6)]);
+    break;
+  default:
+    call_rects[i] = (screen_region_t){x, y, x1, y1};
+    *item = (srn_item_t)SRN_CALL(draw_call, &call_rects[i]);
+    break;
+  }
+}
+
+// FULL FRAME
+// Each item drawn into the whole pixel buffer.
+
+static void plot(int x, int y, srn_rop_t rop) {
+  screen_region_t r = {x, y, x, y};
+  bitblt_rect(&screen, &r, rop);
+}
+
+// the Bresenham line of srn_pages.h, over the whole screen
+static void full_line(const srn_item_t *item) {
+  int x0 = item->x0, y0 = item->y0;
+  int x1 = item->x1, y1 = item->y1;
+  int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+  int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+  int err = dx + dy;
+  while (true) {
+    plot(x0, y0, item->rop);
+    if (x0 == x1 && y0 == y1) break;
+    int e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      x0 += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y0 += sy;
+    }
+  }
+}
+
+static void full_render(int num) {
+  memset(srn_display_pixels, 0, sizeof(srn_pixels_t));
+  for (int i = 0; i < num; i++) {
+    const srn_item_t *item = &items[i];
+    switch (item->kind) {
+    case SRN_ITEM_RECT: {
+      screen_region_t r = {item->x0, item->y0, item->x1, item->y1};
+      bitblt_rect(&screen, &r, item->rop);
+      break;
+    }
+    case SRN_ITEM_LINE:
+      full_line(item);
+      break;
+    case SRN_ITEM_TEXT:
+      draw_text(item->text.font, NULL, item->x0, item->y0, item->text.str);
+      break;
+    case SRN_ITEM_SPRITE:
+      draw_sprite(item->sprite, NULL, item->x0, item->y0);
+      break;
+    case SRN_ITEM_BITMAP: {
+      const srn_bitmap_t *src = item->bitmap;
+      screen_region_t all = {0, 0, src->width - 1, src->height - 1};
+      bitblt(src, &all, &screen, item->x0, item->y0, item->rop);
+      break;
+    }
+    case SRN_ITEM_CALL:
+      bitblt_rect(&screen, item->call.ctx, SRN_ROP_INVERT);
+      break;
+    }
+  }
+}
+
+static void differences(int t, const char *what) {
+  int wrong = 0;
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 128; x++) {
+      if (sh1107_sim_pixel(&paged_sim, x, y) != sh1107_sim_pixel(&full_sim, x, y)) wrong++;
+    }
+  }
+  CHECK(wrong == 0, "round %d: %d pixels differ after %s", t, wrong, what);
+}
+
+static void test_round(int t) {
+  int num = srn_test_below(ITEMS + 1);
+  for (int i = 0; i < num; i++) random_item(i);
+  if (srn_test_below(4)) {
+    full_render(num);
+    srn_refresh_full();
+    sh1107_sim_reset_counters(&paged_sim);
+    srn_pages_render(&pages, items, num);
+    sh1107_refresh_wait(&panel);
+    CHECK(paged_sim.data_bytes == 16 * 128, "round %d: a render sent %d bytes", t,
+          (int)paged_sim.data_bytes);
+    differences(t, "a render");
+  } else {
+    // the pages outside the range keep the last render
+    int first = srn_test_below(16), last = first + srn_test_below(16 - first);
+    srn_pixels_t shown;
+    memcpy(shown, srn_display_pixels, sizeof(shown));
+    full_render(num);
+    for (int page = 0; page < 16; page++) {
+      if (page >= first && page <= last) continue;
+      for (int col = 0; col < 128; col++) {
+        SRN_PAGE_BYTE(page, col) = SRN_FB_BYTE(shown, page, col);
+      }
+    }
+    srn_refresh_full();
+    srn_pages_render_range(&pages, items, num, first, last);
+    sh1107_refresh_wait(&panel);
+    differences(t, "a range");
+  }
+}
+
+int main() {
+  for (int b = 0; b < BITMAPS; b++) {
+    srn_bitmap_init(&bitmaps[b], bitmap_pixels[b], 1 + srn_test_below(40),
+                    1 + srn_test_below(24));
+    for (int i = 0; i < (int)sizeof(bitmap_pixels[b]); i++) bitmap_pixels[b][i] = srn_test_rand();
+  }
+  sh1107_sim_init(&full_sim, 1000 * 1000);
+  srn_set_transport(sh1107_sim_transport(&full_sim));
+  srn_screen_bitmap(&screen);
+
+  sh1107_sim_init(&paged_sim, 1000 * 1000);
+  sh1107_init(&panel, NULL);
+  sh1107_set_transport(&panel, sh1107_sim_transport(&paged_sim));
+  sh1107_select(&panel);
+  srn_turn_display_on(true);
+  sh1107_select(&srn_default_display);
+  srn_turn_display_on(true);
+  srn_pages_init(&pages, &panel);
+
+  for (int t = 0; t < ROUNDS; t++) test_round(t);
+  return srn_test_done("pages");
+}
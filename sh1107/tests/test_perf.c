@@ -0,0 +1,200 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_perf.c
+ * Checks the counters of srn_perf.h, built with SRN_PERF.  Times added
+ * directly must land in the right histogram buckets with the right count,
+ * minimum, maximum and total.  Random drawing and refreshes to the SH1107
+ * simulator must count each call of the drawing functions, nested calls
+ * too, and the totals must match what the simulator saw: a transfer per
+ * refresh that sends anything, the dirty pages and every byte.  Pages
+ * rendered with srn_pages.h count a transfer and a page each.  In every
+ * counter the histogram must add up to the count.  The scheduler is paced,
+ * so the refreshes are all the test's own.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "pixel_ops.h"
+#include "draw_char.h"
+#include "draw_graphics.h"
+#include "srn_pages.h"
+#include "srn_perf.h"
+#include "srn_sched.h"
+#include "sh1107_sim.h"
+#include "srn_test.h"
+
+#define ROUNDS 3000
+
+static sh1107_sim_t sim;
+static uint32_t expect[SRN_PERF_NUM_COUNTERS];
+
+static void check_counts(int t) {
+  for (int c = 0; c < SRN_PERF_NUM_COUNTERS; c++) {
+    srn_perf_stat_t stat;
+    srn_perf_get(c, &stat);
+    uint32_t sum = 0;
+    for (int b = 0; b < SRN_PERF_BUCKETS; b++) sum += stat.histogram[b];
+    CHECK(sum == stat.count, "round %d: %s has %lu calls in its histogram of %lu", t,
+          srn_perf_name(c), (unsigned long)sum, (unsigned long)stat.count);
+    if (c == SRN_PERF_SPI) continue;  // checked against the transfers
+    CHECK(stat.count == expect[c], "round %d: %s counted %lu calls of %lu", t, srn_perf_name(c),
+          (unsigned long)stat.count, (unsigned long)expect[c]);
+  }
+}
+
+// BUCKETS
+
+static void test_buckets() {
+  static const struct {
+    uint64_t ns;
+    int bucket;
+  } times[] = {
+    {0, 0}, {999, 0}, {1000, 1}, {1999, 1}, {2000, 2}, {3999, 2}, {4000, 3},
+    {1000 * 1000, 10}, {16383 * 1000ull, 14}, {16384 * 1000ull, 15},
+    {10ull * 1000 * 1000 * 1000, 15},
+  };
+  int n = sizeof(times) / sizeof(times[0]);
+  srn_perf_reset();
+  srn_perf_stat_t stat;
+  srn_perf_get(SRN_PERF_LINE, &stat);
+  CHECK(stat.count == 0 && stat.min_ns == 0 && stat.max_ns == 0 && stat.total_ns == 0);
+  uint64_t total = 0;
+  for (int i = 0; i < n; i++) {
+    srn_perf_get(SRN_PERF_LINE, &stat);
+    uint32_t before = stat.histogram[times[i].bucket];
+    srn_perf_add(SRN_PERF_LINE, times[i].ns);
+    total += times[i].ns;
+    srn_perf_get(SRN_PERF_LINE, &stat);
+    CHECK(stat.histogram[times[i].bucket] == before + 1, "%llu ns is not in bucket %d",
+          (unsigned long long)times[i].ns, times[i].bucket);
+  }
+  CHECK(stat.count == (uint32_t)n, "%lu calls of %d", (unsigned long)stat.count, n);
+  CHECK(stat.min_ns == 0 && stat.max_ns == UINT32_MAX, "min %lu max %lu",
+        (unsigned long)stat.min_ns, (unsigned long)stat.max_ns);
+  CHECK(stat.total_ns == total, "total %llu of %llu", (unsigned long long)stat.total_ns,
+        (unsigned long long)total);
+  srn_perf_get(SRN_PERF_CHAR, &stat);
+  CHECK(stat.count == 0, "a time went to the wrong counter");
+  srn_perf_reset();
+  srn_perf_get(SRN_PERF_LINE, &stat);
+  CHECK(stat.count == 0 && stat.total_ns == 0 && stat.histogram[15] == 0);
+}
+
+// DRAWING AND REFRESHES
+
+static int dirty_pages() {
+  int n = 0;
+  for (int j = 0; j < 16; j++) n += srn_dirty_min[j] <= srn_dirty_max[j];
+  return n;
+}
+
+static void test_drawing() {
+  memset(expect, 0, sizeof(expect));
+  uint32_t transfers = 0, pages = 0;
+  uint64_t bytes = 0;
+  char_screen_region_t csr;
+  init_char_screen_region(&csr, 2, 2, 13, 13);
+  graph_screen_region_t gsr;
+  map_window(&gsr, 0, 0, 127, 127, 0, 0, 127, 127);
+  static sh1107_t panel;
+  static srn_pages_t render;
+  static sh1107_sim_t panel_sim;
+  sh1107_sim_init(&panel_sim, 1000 * 1000);
+  sh1107_init(&panel, NULL);
+  sh1107_set_transport(&panel, sh1107_sim_transport(&panel_sim));
+  srn_pages_init(&render, &panel);
+  srn_perf_reset();
+
+  for (int t = 0; t < ROUNDS; t++) {
+    switch (srn_test_below(6)) {
+    case 0: {
+      // the columns and rows a scroll leaves are cleared
+      screen_region_t sr;
+      set_screen_region(&sr, srn_test_below(60), srn_test_below(60), 64 + srn_test_below(60),
+                        64 + srn_test_below(60));
+      int x = srn_test_below(9) - 4, y = srn_test_below(9) - 4;
+      scroll_screen_region(&sr, x, y);
+      expect[SRN_PERF_SCROLL]++;
+      if (x || y) expect[SRN_PERF_CLEAR] += (x != 0) + (y != 0);
+      break;
+    }
+    case 1:
+      draw_line(&gsr, srn_test_below(128), srn_test_below(128), srn_test_below(128),
+                srn_test_below(128));
+      expect[SRN_PERF_LINE]++;
+      break;
+    case 2: {
+      start_char_at(&csr, srn_test_below(12), 0);
+      int n = srn_test_below(12);
+      for (int i = 0; i < n; i++) write_char_next(&csr, 'A' + i);
+      expect[SRN_PERF_CHAR] += n;
+      break;
+    }
+    case 3: {
+      // a scroll of the text rows is a scroll of the region too
+      scroll_text(&csr, 1 + srn_test_below(3));
+      expect[SRN_PERF_SCROLL_TEXT]++;
+      expect[SRN_PERF_SCROLL]++;
+      expect[SRN_PERF_CLEAR]++;
+      break;
+    }
+    case 4:
+      // pages rendered without pixel buffers
+      srn_pages_render_range(&render, NULL, 0, 0, srn_test_below(16));
+      sh1107_refresh_wait(&panel);
+      break;
+    default:
+      fill_rect(srn_test_below(128), srn_test_below(128), srn_test_below(128),
+                srn_test_below(128), srn_test_below(2));
+      break;
+    }
+    if (srn_test_below(3) == 0) continue;
+
+    // a refresh sends the dirty pages, if any, in one transfer
+    sh1107_sim_enable_streams(&sim, srn_test_below(2));
+    int dirty = dirty_pages();
+    uint64_t on_wire = sim.cmd_bytes + sim.data_bytes;
+    if (srn_test_below(2)) {
+      srn_refresh();
+    } else {
+      srn_refresh_async();
+      srn_refresh_wait();
+    }
+    expect[SRN_PERF_REFRESH]++;
+    transfers += dirty > 0;
+    pages += dirty;
+    bytes += sim.cmd_bytes + sim.data_bytes - on_wire;
+
+    srn_perf_totals_t totals;
+    srn_perf_get_totals(&totals);
+    uint32_t paged = panel_sim.data_bytes / 128;
+    CHECK(totals.transfers == transfers + paged, "round %d: %lu transfers of %lu", t,
+          (unsigned long)totals.transfers, (unsigned long)(transfers + paged));
+    CHECK(totals.pages == pages + paged, "round %d: %lu pages of %lu", t,
+          (unsigned long)totals.pages, (unsigned long)(pages + paged));
+    CHECK(totals.bytes == bytes + panel_sim.cmd_bytes + panel_sim.data_bytes,
+          "round %d: %llu bytes, the panels took %llu", t, (unsigned long long)totals.bytes,
+          (unsigned long long)(bytes + panel_sim.cmd_bytes + panel_sim.data_bytes));
+    srn_perf_stat_t spi;
+    srn_perf_get(SRN_PERF_SPI, &spi);
+    CHECK(spi.count == totals.transfers, "round %d: %lu transfers timed of %lu", t,
+          (unsigned long)spi.count, (unsigned long)totals.transfers);
+    check_counts(t);
+  }
+}
+
+int main() {
+  sh1107_sim_init(&sim, 1000 * 1000);
+  srn_set_transport(sh1107_sim_transport(&sim));
+  test_buckets();
+  // scroll_text() only asks for a refresh, the test does them
+  srn_sched_start(10);
+  test_drawing();
+  srn_sched_stop();
+  return srn_test_done("perf");
+}
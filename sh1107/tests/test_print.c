@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_print.c
+ * Checks srn_print_int(), srn_print_fixed() and srn_print_float() against
+ * snprintf() over random values, widths, decimals and SRN_FMT_* flags.
+ * Each number is printed on text row 0 and what snprintf() made of it is
+ * printed with srn_print() on row 1; the two rows of pixels must be the
+ * same.  Two known differences are left out: a value that rounds to zero
+ * has no '-', and an exact binary half rounds up rather than to even.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sh1107_spi.h"
+#include "draw_char.h"
+#include "sh1107_sim.h"
+#include "srn_test.h"
+
+#define ROUNDS 200000
+
+static sh1107_sim_t sim;
+static char_screen_region_t row0, row1;
+
+// the printf flags for each combination of SRN_FMT_* flags tried
+static const char *printf_flags[] = {"", "+", " ", "0", "-", "+0", " 0", "-+"};
+static const int srn_flags[] = {
+  0, SRN_FMT_PLUS, SRN_FMT_SPACE, SRN_FMT_ZERO, SRN_FMT_LEFT,
+  SRN_FMT_PLUS | SRN_FMT_ZERO, SRN_FMT_SPACE | SRN_FMT_ZERO, SRN_FMT_LEFT | SRN_FMT_PLUS,
+};
+
+static bool same_rows() {
+  for (int x = 0; x < 128; x++) {
+    if (SRN_PAGE_BYTE(0, x) != SRN_PAGE_BYTE(1, x)) return false;
+  }
+  return true;
+}
+
+// true for the differences from printf that are documented
+static bool known_difference(const char *expect, double v, int decimals) {
+  if (strchr(expect, '-') && atof(expect) == 0) return true;
+  double scaled = fabs(v);
+  for (int i = 0; i < decimals; i++) scaled *= 10;
+  return scaled - floor(scaled) == 0.5;
+}
+
+int main() {
+  sh1107_sim_init(&sim, 1000 * 1000);
+  srn_set_transport(sh1107_sim_transport(&sim));
+  init_char_screen_region(&row0, 0, 0, 15, 0);
+  init_char_screen_region(&row1, 0, 1, 15, 1);
+  int tried = 0;
+  for (int t = 0; t < ROUNDS; t++) {
+    int width = srn_test_below(14);
+    int f = srn_test_below(8);
+    int kind = srn_test_below(3);
+    int decimals = srn_test_below(7);
+    // a quarter of the values over the whole range
+    int32_t v = srn_test_below(4) == 0 ? (int32_t)srn_test_rand() : srn_test_below(2000) - 1000;
+    char format[32], expect[64];
+    clear_text(&row0);
+    clear_text(&row1);
+    if (kind == 0) {
+      snprintf(format, sizeof(format), "%%%s%dd", printf_flags[f], width);
+      snprintf(expect, sizeof(expect), format, v);
+      if (strlen(expect) > 16) continue;
+      srn_print_int(&row0, v, width, srn_flags[f]);
+    } else if (kind == 1) {
+      v %= 30000 << 16;
+      double d = v / 65536.0;
+      snprintf(format, sizeof(format), "%%%s%d.%df", printf_flags[f], width, decimals);
+      snprintf(expect, sizeof(expect), format, d);
+      if (strlen(expect) > 16 || known_difference(expect, d, decimals)) continue;
+      srn_print_fixed(&row0, v, decimals, width, srn_flags[f]);
+    } else {
+      // values with from 0 to 24 fraction bits
+      float x = ((int32_t)srn_test_rand() >> 1) / (float)(1 << srn_test_below(25));
+      snprintf(format, sizeof(format), "%%%s%d.%df", printf_flags[f], width, decimals);
+      snprintf(expect, sizeof(expect), format, (double)x);
+      if (strlen(expect) > 16 || known_difference(expect, x, decimals)) continue;
+      srn_print_float(&row0, x, decimals, width, srn_flags[f]);
+    }
+    start_char_at(&row1, 0, 0);
+    srn_print(&row1, expect);
+    CHECK(same_rows(), "kind %d %s: not printed as \"%s\"", kind, format, expect);
+    tried++;
+  }
+  printf("%d numbers printed\n", tried);
+  return srn_test_done("print");
+}
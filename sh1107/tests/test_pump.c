@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_pump.c
+ * Stresses the triple buffer of srn_pump.c with the pump on its pthread.
+ * The main thread draws random rectangles and a frame number, keeps a copy
+ * of each frame and publishes it.  The transport, on the pump thread,
+ * checks after every frame that the panel shows exactly one frame that
+ * was published, no older than the last one, so a torn frame or a lost
+ * dirty span shows up as a difference.  The pump is slowed at random so
+ * that frames are dropped as well.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "sh1107_transport.h"
+#include "sh1107_sim.h"
+#include "pixel_ops.h"
+#include "srn_pump.h"
+#include "srn_test.h"
+
+#define FRAMES 3000
+#define STAMP_BITS 16
+
+static sh1107_sim_t sim;
+static srn_transport_t transport;
+static srn_pixels_t published[FRAMES + 1];
+static int last_shown = -1;
+static int frames_checked;
+static int bad_frames;
+static uint32_t pump_seed = 88172645u;
+
+// the frame number in the top row of the panel
+static int stamp_shown() {
+  int n = 0;
+  for (int b = 0; b < STAMP_BITS; b++) n |= (sim.gddram[0][b] & 1) << b;
+  return n;
+}
+
+static void check_frame() {
+  int n = stamp_shown();
+  frames_checked++;
+  bool good = n >= last_shown && n <= FRAMES;
+  for (int j = 0; good && j < 16; j++) {
+    for (int c = 0; c < 128; c++) {
+      if (sim.gddram[j][c] != SRN_FB_BYTE(published[n], j, c)) {
+        good = false;
+        break;
+      }
+    }
+  }
+  if (!good && ++bad_frames <= 5) printf("frame %d after %d is not as published\n", n, last_shown);
+  last_shown = n;
+}
+
+static void stream_checked(void *ctx, const uint8_t *stream, int num) {
+  sh1107_sim_write_stream(&sim, stream, num);
+  check_frame();
+  // now and then the pump is slow, so the main thread gets ahead
+  pump_seed ^= pump_seed << 13;
+  pump_seed ^= pump_seed >> 17;
+  pump_seed ^= pump_seed << 5;
+  if (pump_seed % 8 == 0) {
+    uint64_t until = srn_time_ns() + 20000 * (pump_seed % 5);
+    while (srn_time_ns() < until) {}
+  }
+  sh1107_transfer_done(transport.display);
+}
+
+static void draw_stamp(int n) {
+  for (int b = 0; b < STAMP_BITS; b++) fill_rect(b, 0, b, 0, (n >> b) & 1);
+}
+
+int main() {
+  sh1107_sim_init(&sim, 1000 * 1000);
+  transport = *sh1107_sim_transport(&sim);
+  transport.start_stream = stream_checked;
+  srn_set_transport(&transport);
+  srn_refresh_full();
+
+  memcpy(published[0], srn_display_pixels, sizeof(srn_pixels_t));
+  srn_pump_start();
+  for (int n = 1; n <= FRAMES; n++) {
+    int k = srn_test_below(4);
+    for (int i = 0; i < k; i++) {
+      int x = srn_test_below(128), y = 1 + srn_test_below(127);
+      fill_rect(x, y, x + srn_test_below(40), y + srn_test_below(40), srn_test_rand() & 1);
+    }
+    draw_stamp(n);
+    // the copy is made before the frame can reach the pump
+    memcpy(published[n], srn_display_pixels, sizeof(srn_pixels_t));
+    srn_refresh();
+    if (srn_test_below(16) == 0) {
+      uint64_t until = srn_time_ns() + 50000;
+      while (srn_time_ns() < until) {}
+    }
+  }
+  srn_pump_stop();
+
+  srn_pump_stats_t stats;
+  srn_pump_get_stats(&stats);
+  printf("published %u, sent %u, dropped %u, checked %d\n", stats.published, stats.sent,
+         stats.dropped, frames_checked);
+  CHECK(bad_frames == 0, "%d frames not as published", bad_frames);
+  CHECK(stats.published == FRAMES && stats.sent + stats.dropped == stats.published,
+        "%u published, %u sent, %u dropped", stats.published, stats.sent, stats.dropped);
+  CHECK(stats.dropped > 0, "no frames dropped, the test is too gentle");
+  // the last frame is on the panel once the pump has stopped
+  CHECK(last_shown == FRAMES, "the panel shows frame %d of %d", last_shown, FRAMES);
+  return srn_test_done("pump");
+}
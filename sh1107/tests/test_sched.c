@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_sched.c
+ * Checks that srn_sched_poll() holds back the changes of a rated region
+ * that is not due while it sends regions without a rate, and that rated
+ * regions due on the same tick go out in one transfer, also after a
+ * hardware scroll.  The ticks come from the clock, so the test waits for
+ * them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "sh1107_sim.h"
+#include "pixel_ops.h"
+#include "srn_sched.h"
+#include "srn_test.h"
+
+#define TICK_HZ 100
+
+static sh1107_sim_t sim;
+
+// true if the panel shows the rectangle lit
+static bool shown(int x0, int y0, int x1, int y1) {
+  for (int y = y0; y <= y1; y++) {
+    int row = (y + sim.start_line) & 0x7F;
+    for (int x = x0; x <= x1; x++) {
+      if (!(sim.gddram[row >> 3][x] & (1 << (row & 7)))) return false;
+    }
+  }
+  return true;
+}
+
+// polls until a refresh goes out, or for a second
+static bool poll_frame() {
+  uint64_t end = srn_time_ns() + 1000000000ull;
+  while (srn_time_ns() < end) {
+    if (srn_sched_poll()) return true;
+  }
+  return false;
+}
+
+int main() {
+  sh1107_sim_init(&sim, 1000 * 1000);
+  srn_set_transport(sh1107_sim_transport(&sim));
+
+  // a slow region and another at the same rate on the same pages, and
+  // the rest of the screen without a rate
+  screen_region_t slow, other;
+  set_screen_region(&slow, 0, 0, 31, 31);
+  set_screen_region(&other, 96, 0, 127, 31);
+  srn_sched_set_rate(&slow, 2);
+  srn_sched_set_rate(&other, 2);
+  srn_sched_start(TICK_HZ);
+
+  // the first changes are due at once
+  fill_rect(0, 0, 31, 31, 1);
+  srn_sched_request(&slow);
+  fill_rect(96, 0, 127, 31, 1);
+  srn_sched_request(&other);
+  fill_rect(40, 0, 50, 10, 1);
+  srn_sched_request(NULL);
+  CHECK(poll_frame());
+  CHECK(shown(0, 0, 31, 31) && shown(40, 0, 50, 10) && shown(96, 0, 127, 31), "first frame");
+
+  // the slow region is not due for half a second, so a change without a
+  // rate goes without it
+  fill_rect(0, 40, 31, 47, 1);
+  fill_rect(0, 0, 7, 7, 0);
+  srn_sched_request(&slow);
+  fill_rect(60, 0, 70, 10, 1);
+  fill_rect(40, 100, 50, 110, 1);
+  srn_sched_request(NULL);
+  CHECK(poll_frame());
+  CHECK(shown(60, 0, 70, 10) && shown(40, 100, 50, 110), "unrated change not sent");
+  CHECK(shown(0, 0, 7, 7), "the slow region was sent before it was due");
+  // the page below the slow region is not held back
+  CHECK(shown(0, 40, 31, 47), "a change outside the slow region was held");
+
+  // the other region changes too, and both fall due on the same tick
+  fill_rect(100, 0, 110, 10, 0);
+  srn_sched_request(&other);
+  srn_sched_stats_t before, after;
+  srn_sched_get_stats(&before);
+  uint32_t transfers = sim.transfers;
+  CHECK(poll_frame());
+  srn_sched_get_stats(&after);
+  CHECK(!shown(0, 0, 7, 7), "the slow region did not go when due");
+  CHECK(!shown(100, 0, 110, 10), "the other region did not go when due");
+  CHECK(after.frames == before.frames + 1 && sim.transfers == transfers + 1,
+        "%u frames and %u transfers for one tick", after.frames - before.frames,
+        sim.transfers - transfers);
+
+  // a hardware scroll sends only its start line and the spans, so the slow
+  // region is still held back
+  srn_enable_hw_scroll(true);
+  CHECK(srn_hw_scroll_pages(2));
+  fill_rect(8, 8, 15, 15, 0);
+  srn_sched_request(&slow);
+  srn_sched_request(NULL);
+  CHECK(poll_frame());
+  CHECK(sim.start_line == 16, "start line %d after the scroll", sim.start_line);
+  CHECK(shown(40, 84, 50, 94), "the scroll did not show");
+  CHECK(shown(8, 8, 15, 15), "the slow region was sent after the scroll");
+
+  srn_sched_stop();
+  return srn_test_done("sched");
+}
@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_shadow.c
+ * Checks the shadow grid of char regions.  The same random script of
+ * prints, writes, moves, scrolls and clears is run on a region without a
+ * shadow grid and on one with, from the same random pixels, with a
+ * refresh after each step.  Both must end up with the same pixels on the
+ * SH1107 simulator, and no step with the grid may leave wider dirty spans
+ * than without it.  Printing the same text again with the grid must send
+ * nothing, and changing one character of it must send only that
+ * character's cell.  The scheduler is paced, so srn_print() leaves the
+ * refreshes to the test.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "pixel_ops.h"
+#include "draw_char.h"
+#include "srn_fonts.h"
+#include "sh1107_sim.h"
+#include "srn_sched.h"
+#include "srn_test.h"
+
+#define ROUNDS 2000
+#define OPS 12
+
+static sh1107_sim_t sim;
+static srn_pixels_t start, plain;
+static uint16_t grid[256];
+
+typedef enum { OP_PRINT, OP_WRITE_AT, OP_START_AT, OP_SCROLL, OP_CLEAR } op_kind_t;
+
+typedef struct op {
+  op_kind_t kind;
+  int row, col, n;
+  char str[24];
+} op_t;
+
+static op_t script[OPS];
+
+static const srn_font_t *fonts[] = {&srn_font8x8, &srn_font8x8_prop, &srn_font8x8_2x};
+
+// from a few characters, so the same ones come up again
+static void random_text(char *str, int max) {
+  static const char alphabet[] = "AB 12\n";
+  int n = srn_test_below(max);
+  for (int i = 0; i < n; i++) str[i] = alphabet[srn_test_below(sizeof(alphabet) - 1)];
+  str[n] = 0;
+}
+
+static void random_script() {
+  for (int i = 0; i < OPS; i++) {
+    op_t *op = &script[i];
+    op->kind = srn_test_below(10);
+    if (op->kind > OP_CLEAR) op->kind = OP_PRINT;
+    op->row = srn_test_below(16);
+    op->col = srn_test_below(16);
+    op->n = srn_test_below(7) - 3;
+    random_text(op->str, sizeof(op->str));
+  }
+}
+
+// the columns of the dirty spans
+static int dirty_columns() {
+  int n = 0;
+  for (int j = 0; j < 16; j++) {
+    if (srn_dirty_min[j] <= srn_dirty_max[j]) n += srn_dirty_max[j] - srn_dirty_min[j] + 1;
+  }
+  return n;
+}
+
+// runs the script from the start pixels, keeping the dirty columns of
+// each step in dirty
+static void run(char_screen_region_t *csr, int dirty[OPS]) {
+  memcpy(srn_display_pixels, start, sizeof(start));
+  srn_refresh_full();
+  for (int i = 0; i < OPS; i++) {
+    op_t *op = &script[i];
+    switch (op->kind) {
+    case OP_PRINT: srn_print(csr, op->str); break;
+    case OP_WRITE_AT: write_char_at(csr, op->str[0] ? op->str[0] : 'A', op->row, op->col); break;
+    case OP_START_AT: start_char_at(csr, op->row, op->col); break;
+    case OP_SCROLL: scroll_text(csr, op->n); break;
+    case OP_CLEAR: clear_text(csr); break;
+    }
+    dirty[i] = dirty_columns();
+    srn_refresh();
+  }
+}
+
+static int panel_differences(const srn_pixels_t *pixels) {
+  int wrong = 0;
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 128; x++) {
+      int p = (SRN_FB_BYTE(*pixels, y >> 3, x) >> (y & 7)) & 1;
+      if (sh1107_sim_pixel(&sim, x, y) != p) wrong++;
+    }
+  }
+  return wrong;
+}
+
+static void test_script(int t) {
+  const srn_font_t *font = fonts[srn_test_below(3)];
+  int l = srn_test_below(14), top = srn_test_below(14);
+  int r = l + 1 + srn_test_below(15 - l), b = top + 1 + srn_test_below(15 - top);
+  for (int page = 0; page < 16; page++) {
+    for (int col = 0; col < 128; col++) SRN_FB_BYTE(start, page, col) = srn_test_rand();
+  }
+  random_script();
+
+  char_screen_region_t csr;
+  init_char_screen_region(&csr, l, top, r, b);
+  set_char_font(&csr, font);
+  int plain_dirty[OPS], shadow_dirty[OPS];
+  run(&csr, plain_dirty);
+  memcpy(plain, srn_display_pixels, sizeof(plain));
+
+  init_char_screen_region(&csr, l, top, r, b);
+  set_char_font(&csr, font);
+  CHECK(set_char_shadow(&csr, grid, (r - l + 1) * (b - top + 1)));
+  run(&csr, shadow_dirty);
+  int wrong = panel_differences(&plain);
+  CHECK(wrong == 0, "round %d: %d pixels differ with the shadow grid", t, wrong);
+  for (int i = 0; i < OPS; i++) {
+    CHECK(shadow_dirty[i] <= plain_dirty[i], "round %d step %d (%d): %d dirty columns with "
+          "the grid, %d without", t, i, script[i].kind, shadow_dirty[i], plain_dirty[i]);
+  }
+}
+
+// a status panel written again and again
+static void test_status_panel() {
+  char_screen_region_t csr;
+  init_char_screen_region(&csr, 0, 0, 15, 11);
+  set_char_font(&csr, &srn_font8x8_2x);
+  CHECK(set_char_shadow(&csr, grid, 16 * 12));
+  char text[] = "TEMP 21C\nRPM  1200\nOK";
+  clear_text(&csr);
+  srn_print(&csr, text);
+  srn_pixels_t shown;
+  memcpy(shown, srn_display_pixels, sizeof(shown));
+
+  srn_refresh();
+  sh1107_sim_reset_counters(&sim);
+  start_char_at(&csr, 0, 0);
+  srn_print(&csr, text);
+  srn_refresh();
+  CHECK(sim.data_bytes == 0, "the same text again sent %d bytes", (int)sim.data_bytes);
+  CHECK(memcmp(shown, srn_display_pixels, sizeof(shown)) == 0);
+
+  text[6] = '2';
+  start_char_at(&csr, 0, 0);
+  srn_print(&csr, text);
+  srn_refresh();
+  CHECK(sim.data_bytes == 2 * 16, "one new character sent %d bytes", (int)sim.data_bytes);
+  CHECK(panel_differences(&srn_display_pixels) == 0);
+}
+
+int main() {
+  sh1107_sim_init(&sim, 1000 * 1000);
+  srn_set_transport(sh1107_sim_transport(&sim));
+  srn_turn_display_on(true);
+  srn_sched_start(10);
+  for (int t = 0; t < ROUNDS; t++) test_script(t);
+  test_status_panel();
+  srn_sched_stop();
+  return srn_test_done("shadow");
+}
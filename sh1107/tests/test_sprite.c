@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_sprite.c
+ * Checks draw_sprite() and draw_sprites() against a pixel at a time model.
+ * Random sprites, with and without masks, are laid out in the 8 shifted
+ * copies as tools/sprite_compiler.c does, and drawn at random positions,
+ * partly or wholly off the display, inside random clips that may run off
+ * the display too.  A masked sprite must replace the pixels under its mask
+ * and an unmasked one must be ORed in, only inside the clip, and every
+ * changed pixel must be in the dirty spans.  The built in icons must draw
+ * the same at every shift as their first copy.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "pixel_ops.h"
+#include "draw_sprite.h"
+#include "srn_test.h"
+
+#define ROUNDS 20000
+#define SPRITES 8
+#define MAX_SIZE 24
+#define MAX_PAGES ((MAX_SIZE + 14) / 8)
+
+static srn_pixels_t before, expect;
+
+static inline int pixel(const srn_pixels_t *pixels, int x, int y) {
+  return (SRN_FB_BYTE(*pixels, y >> 3, x) >> (y & 7)) & 1;
+}
+
+static inline void model_pixel(int x, int y, int b) {
+  uint8_t *p = &SRN_FB_BYTE(expect, y >> 3, x);
+  if (b) *p |= 1 << (y & 7);
+  else *p &= ~(1 << (y & 7));
+}
+
+// SPRITES
+// A test sprite keeps its pixels next to the shifted copies made from them.
+
+typedef struct test_sprite {
+  srn_sprite_t sprite;
+  uint8_t lit[MAX_SIZE][MAX_SIZE];     // [y][x]
+  uint8_t opaque[MAX_SIZE][MAX_SIZE];
+  uint8_t image[8 * MAX_PAGES * MAX_SIZE];
+  uint8_t mask[8 * MAX_PAGES * MAX_SIZE];
+} test_sprite_t;
+
+static test_sprite_t sprites[SPRITES];
+
+// lays out the copies as tools/sprite_compiler.c writes them
+static void shift_copies(uint8_t *out, uint8_t pixels[MAX_SIZE][MAX_SIZE], int width,
+                         int height, int pages) {
+  memset(out, 0, 8 * pages * width);
+  for (int s = 0; s < 8; s++) {
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        if (!pixels[y][x]) continue;
+        int row = y + s;
+        out[s * pages * width + (row >> 3) * width + x] |= 1 << (row & 7);
+      }
+    }
+  }
+}
+
+static void random_sprite(test_sprite_t *ts) {
+  int width = 1 + srn_test_below(MAX_SIZE), height = 1 + srn_test_below(MAX_SIZE);
+  int pages = (height + 14) / 8;
+  bool masked = srn_test_below(2);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      ts->opaque[y][x] = !masked || srn_test_below(4);
+      ts->lit[y][x] = ts->opaque[y][x] && srn_test_below(2);
+    }
+  }
+  shift_copies(ts->image, ts->lit, width, height, pages);
+  shift_copies(ts->mask, ts->opaque, width, height, pages);
+  ts->sprite = (srn_sprite_t){.width = width, .height = height, .pages = pages,
+                              .image = ts->image, .mask = masked ? ts->mask : NULL};
+}
+
+// takes the pixels of a built in sprite from its unshifted copy
+static void from_sprite(test_sprite_t *ts, const srn_sprite_t *sprite) {
+  for (int y = 0; y < sprite->height; y++) {
+    for (int x = 0; x < sprite->width; x++) {
+      int i = (y >> 3) * sprite->width + x, bit = 1 << (y & 7);
+      ts->lit[y][x] = (sprite->image[i] & bit) != 0;
+      ts->opaque[y][x] = sprite->mask == NULL || (sprite->mask[i] & bit) != 0;
+    }
+  }
+  ts->sprite = *sprite;
+}
+
+// MODEL
+
+static void model_sprite(const test_sprite_t *ts, const screen_region_t *clip, int x, int y) {
+  const srn_sprite_t *sprite = &ts->sprite;
+  for (int v = 0; v < sprite->height; v++) {
+    for (int u = 0; u < sprite->width; u++) {
+      int px = x + u, py = y + v;
+      if (px < 0 || px > 127 || py < 0 || py > 127) continue;
+      if (clip && (px < clip->xMin || px > clip->xMax || py < clip->yMin || py > clip->yMax)) {
+        continue;
+      }
+      if (sprite->mask) {
+        if (ts->opaque[v][u]) model_pixel(px, py, ts->lit[v][u]);
+      } else if (ts->lit[v][u]) {
+        model_pixel(px, py, 1);
+      }
+    }
+  }
+}
+
+static void start() {
+  for (int page = 0; page < 16; page++) {
+    for (int col = 0; col < 128; col++) SRN_PAGE_BYTE(page, col) = srn_test_rand();
+  }
+  memcpy(before, srn_display_pixels, sizeof(before));
+  memcpy(expect, srn_display_pixels, sizeof(expect));
+  memset(srn_dirty_min, 0xFF, sizeof(srn_dirty_min));
+  memset(srn_dirty_max, 0, sizeof(srn_dirty_max));
+}
+
+static void check(const char *what, int round) {
+  int wrong = 0, undirty = 0;
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 128; x++) {
+      int p = pixel(&srn_display_pixels, x, y);
+      if (p != pixel(&expect, x, y)) wrong++;
+      if (p != pixel(&before, x, y) && (x < srn_dirty_min[y >> 3] || x > srn_dirty_max[y >> 3])) {
+        undirty++;
+      }
+    }
+  }
+  CHECK(wrong == 0, "%s round %d: %d pixels differ", what, round, wrong);
+  CHECK(undirty == 0, "%s round %d: %d changed pixels not dirty", what, round, undirty);
+}
+
+// a clip that may run off any edge of the display, or none
+static const screen_region_t *random_clip(screen_region_t *clip) {
+  if (srn_test_below(4) == 0) return NULL;
+  clip->xMin = srn_test_below(160) - 16;
+  clip->yMin = srn_test_below(160) - 16;
+  clip->xMax = clip->xMin + srn_test_below(80);
+  clip->yMax = clip->yMin + srn_test_below(80);
+  return clip;
+}
+
+// a position that leaves the sprite partly off the display at times
+static int random_at() {
+  return srn_test_below(128 + 2 * MAX_SIZE) - MAX_SIZE;
+}
+
+int main() {
+  screen_region_t clip;
+  for (int t = 0; t < ROUNDS; t++) {
+    if (t % 100 == 0) {
+      for (int i = 0; i < SPRITES; i++) random_sprite(&sprites[i]);
+    }
+    start();
+    if (srn_test_below(2)) {
+      test_sprite_t *ts = &sprites[srn_test_below(SPRITES)];
+      const screen_region_t *c = random_clip(&clip);
+      int x = random_at(), y = random_at();
+      draw_sprite(&ts->sprite, c, x, y);
+      model_sprite(ts, c, x, y);
+      check(ts->sprite.mask ? "a masked sprite" : "a sprite", t);
+    } else {
+      // a list overlapping in a small area, so later ones cover earlier
+      srn_sprite_at_t list[SPRITES];
+      int n = 1 + srn_test_below(SPRITES);
+      int x = random_at(), y = random_at();
+      const screen_region_t *c = random_clip(&clip);
+      for (int i = 0; i < n; i++) {
+        test_sprite_t *ts = &sprites[srn_test_below(SPRITES)];
+        list[i] = (srn_sprite_at_t){&ts->sprite, x + srn_test_below(17) - 8,
+                                    y + srn_test_below(17) - 8};
+        model_sprite(ts, c, list[i].x, list[i].y);
+      }
+      draw_sprites(list, n, c);
+      check("a list of sprites", t);
+    }
+  }
+
+  const srn_sprite_t *icons[] = {&srn_icon_battery, &srn_icon_link, &srn_icon_warning};
+  test_sprite_t icon;
+  for (int i = 0; i < 3; i++) {
+    from_sprite(&icon, icons[i]);
+    for (int y = -8; y <= 128; y++) {
+      start();
+      int x = srn_test_below(136) - 8;
+      draw_sprite(icons[i], NULL, x, y);
+      model_sprite(&icon, NULL, x, y);
+      check("an icon", y);
+    }
+  }
+  return srn_test_done("sprite");
+}
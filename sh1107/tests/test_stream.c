@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_stream.c
+ * Checks the bytes srn_stream.h puts in a stream for known mixes of
+ * commands and data: the D/C bit and bit count less one in each segment
+ * header, where segments merge and split, and the 0x0000 end header.
+ * Then random mixes are played back with srn_stream_decode() and must
+ * give back what went in.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "srn_stream.h"
+#include "srn_test.h"
+
+static uint8_t buf[3 * SRN_STREAM_MAX_SEGMENT];
+
+static void check_bytes(const srn_stream_t *s, const uint8_t *want, int num, const char *name) {
+  bool same = s->len == num && memcmp(s->buf, want, num) == 0;
+  CHECK(same, "%s: %d bytes, %d expected", name, s->len, num);
+  if (!same) {
+    for (int i = 0; i < s->len && i < 32; i++) printf(" %02X", s->buf[i]);
+    printf("\n");
+  }
+}
+
+static void fixed_streams() {
+  srn_stream_t s;
+  static const uint8_t cmds[3] = {0x10, 0x00, 0xB0};
+  static const uint8_t data[2] = {0xAA, 0x55};
+
+  // consecutive bytes of a kind share a segment
+  srn_stream_init(&s, buf, sizeof(buf));
+  srn_stream_cmd(&s, cmds, 3);
+  srn_stream_data(&s, data, 2);
+  srn_stream_data(&s, data, 2);
+  CHECK(srn_stream_end(&s));
+  static const uint8_t merged[] = {
+    0x00, 0x17, 0x10, 0x00, 0xB0,               // 24 bit command
+    0x80, 0x1F, 0xAA, 0x55, 0xAA, 0x55,         // 32 bit data
+    0x00, 0x00,
+  };
+  check_bytes(&s, merged, sizeof(merged), "command then data");
+
+  // D/C changes back and forth, and one byte segments
+  srn_stream_init(&s, buf, sizeof(buf));
+  srn_stream_data(&s, data, 1);
+  srn_stream_cmd(&s, cmds, 1);
+  srn_stream_data(&s, data + 1, 1);
+  srn_stream_cmd(&s, cmds + 2, 1);
+  srn_stream_end(&s);
+  static const uint8_t alternating[] = {
+    0x80, 0x07, 0xAA,
+    0x00, 0x07, 0x10,
+    0x80, 0x07, 0x55,
+    0x00, 0x07, 0xB0,
+    0x00, 0x00,
+  };
+  check_bytes(&s, alternating, sizeof(alternating), "alternating");
+
+  // two frames, the second after its own end header; nothing in between
+  // an end and the next byte
+  srn_stream_init(&s, buf, sizeof(buf));
+  srn_stream_cmd(&s, cmds, 2);
+  srn_stream_end(&s);
+  srn_stream_cmd(&s, cmds + 2, 1);
+  srn_stream_end(&s);
+  srn_stream_end(&s);
+  static const uint8_t frames[] = {
+    0x00, 0x0F, 0x10, 0x00, 0x00, 0x00,
+    0x00, 0x07, 0xB0, 0x00, 0x00,
+    0x00, 0x00,
+  };
+  check_bytes(&s, frames, sizeof(frames), "three frames");
+  CHECK(srn_stream_decode(buf, s.len, NULL, NULL, NULL) == 3);
+
+  // a run longer than a segment splits at SRN_STREAM_MAX_SEGMENT bytes,
+  // whose header is 0x7FFF bits less one with D/C set
+  static uint8_t run[SRN_STREAM_MAX_SEGMENT + 1];
+  memset(run, 0x3C, sizeof(run));
+  srn_stream_init(&s, buf, sizeof(buf));
+  srn_stream_data(&s, run, sizeof(run));
+  srn_stream_end(&s);
+  CHECK(s.len == 2 + SRN_STREAM_MAX_SEGMENT + 2 + 1 + 2, "split run is %d bytes", s.len);
+  CHECK(buf[0] == 0xFF && buf[1] == 0xFF, "first header %02X%02X", buf[0], buf[1]);
+  int second = 2 + SRN_STREAM_MAX_SEGMENT;
+  CHECK(buf[second] == 0x80 && buf[second + 1] == 0x07,
+        "second header %02X%02X", buf[second], buf[second + 1]);
+  CHECK(buf[second + 3] == 0x00 && buf[second + 4] == 0x00);
+
+  // data space joins the open data segment like srn_stream_data()
+  srn_stream_init(&s, buf, sizeof(buf));
+  srn_stream_data(&s, data, 1);
+  uint8_t *p = srn_stream_data_space(&s, 2);
+  CHECK(p == buf + 3);
+  if (p) p[0] = 0x01, p[1] = 0x02;
+  CHECK(srn_stream_data_space(&s, SRN_STREAM_MAX_SEGMENT + 1) == NULL);
+  srn_stream_end(&s);
+  static const uint8_t spaced[] = {0x80, 0x17, 0xAA, 0x01, 0x02, 0x00, 0x00};
+  check_bytes(&s, spaced, sizeof(spaced), "data space");
+
+  // a stream that runs out of room says so and stays full
+  srn_stream_init(&s, buf, 6);
+  CHECK(srn_stream_cmd(&s, cmds, 3));
+  CHECK(!srn_stream_cmd(&s, cmds, 2) && s.full);
+  CHECK(!srn_stream_end(&s));
+  CHECK(s.len == 5, "full stream is %d bytes", s.len);
+
+  // the segment reader
+  bool is_data;
+  CHECK(srn_stream_segment(merged, &is_data) == 3 && !is_data);
+  CHECK(srn_stream_segment(merged + 5, &is_data) == 4 && is_data);
+  CHECK(srn_stream_segment(merged + 11, &is_data) == -1);
+}
+
+// RANDOM MIXES
+
+static uint8_t sent[2 * SRN_STREAM_MAX_SEGMENT];
+static uint8_t sent_cmd[2 * SRN_STREAM_MAX_SEGMENT];
+static int num_sent;
+
+typedef struct playback {
+  int pos;
+  int ends;
+  bool ok;
+  bool last_cmd;
+  int last_num;
+  int segments;
+} playback_t;
+
+static void play_write(void *ctx, const uint8_t *bytes, int num, bool cmd) {
+  playback_t *pb = (playback_t *)ctx;
+  // decode gives a write per segment, and a segment only follows one of
+  // the same kind when that one is full
+  if (pb->segments > 0 && pb->last_cmd == cmd && pb->last_num != SRN_STREAM_MAX_SEGMENT) {
+    pb->ok = false;
+  }
+  pb->segments++;
+  pb->last_cmd = cmd;
+  pb->last_num = num;
+  for (int i = 0; i < num; i++, pb->pos++) {
+    if (pb->pos >= num_sent || bytes[i] != sent[pb->pos] || cmd != sent_cmd[pb->pos]) pb->ok = false;
+  }
+}
+
+static void play_end(void *ctx) {
+  ((playback_t *)ctx)->ends++;
+}
+
+static void random_mixes() {
+  for (int round = 0; round < 2000; round++) {
+    srn_stream_t s;
+    srn_stream_init(&s, buf, sizeof(buf));
+    num_sent = 0;
+    int pieces = srn_test_below(12);
+    for (int k = 0; k < pieces; k++) {
+      bool cmd = srn_test_rand() & 1;
+      int n = srn_test_below(4) == 0 ? srn_test_below(1500) : 1 + srn_test_below(40);
+      if (num_sent + n > (int)sizeof(sent)) break;
+      uint8_t *from = sent + num_sent;
+      for (int i = 0; i < n; i++) {
+        sent[num_sent] = srn_test_rand();
+        sent_cmd[num_sent++] = cmd;
+      }
+      if (cmd) srn_stream_cmd(&s, from, n);
+      else srn_stream_data(&s, from, n);
+    }
+    CHECK(srn_stream_end(&s), "round %d did not fit", round);
+    playback_t pb = {0, 0, true, false, 0, 0};
+    int frames = srn_stream_decode(buf, s.len, play_write, play_end, &pb);
+    CHECK(frames == 1 && pb.ends == 1 && pb.ok && pb.pos == num_sent,
+          "round %d: %d frames, %d of %d bytes back", round, frames, pb.pos, num_sent);
+  }
+}
+
+int main() {
+  fixed_streams();
+  random_mixes();
+  return srn_test_done("stream");
+}
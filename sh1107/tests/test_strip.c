@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_strip.c
+ * Checks strip charts in both modes and styles against a model that works
+ * out each pixel of the region from the samples in age order.  Charts of
+ * random size and position take random samples, with a fixed range or
+ * auto ranging, and are presented, redrawn or reset at random.  After each
+ * sample the region must match the model, except that a full scrolling
+ * chart must not be drawn at all until it is presented, and the pixels
+ * around the region must never change.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "pixel_ops.h"
+#include "strip_chart.h"
+#include "srn_test.h"
+
+#define CHARTS 400
+#define SAMPLES 600
+
+static srn_strip_chart_t chart;
+static srn_pixels_t before;
+static srn_fix_t history[SAMPLES];  // every sample, oldest first
+static int added;
+
+static inline int pixel(const srn_pixels_t *pixels, int x, int y) {
+  return (SRN_FB_BYTE(*pixels, y >> 3, x) >> (y & 7)) & 1;
+}
+
+// the row of a value, worked out as strip_chart.c does
+static int model_row(srn_fix_t v) {
+  if (v > chart.hi) v = chart.hi;
+  if (v < chart.lo) v = chart.lo;
+  int row = chart.sr.yMin + (int)((((int64_t)chart.hi - v) * chart.scale) >> 32);
+  return row < chart.sr.yMax ? row : chart.sr.yMax;
+}
+
+// the sample of age a, 0 being the newest
+static srn_fix_t aged(int age) {
+  return history[added - 1 - age];
+}
+
+// true if the column showing the sample of age is lit at y, joined to the
+// sample before it if that is still in the ring
+static bool model_lit(int age, int y) {
+  int row = model_row(aged(age));
+  if (chart.style == SRN_STRIP_BAR) return y >= row;
+  int from = age + 1 < chart.count ? model_row(aged(age + 1)) : row;
+  if (from < row) return y > from && y <= row;
+  if (from > row) return y >= row && y < from;
+  return y == row;
+}
+
+// the age shown in column x of the region, or -1 for a blank column
+static int model_age(int x) {
+  int count = chart.count;
+  if (chart.mode == SRN_STRIP_SCROLL) return x < count ? count - 1 - x : -1;
+  // a sweep has the newest sample in the column before head and the
+  // oldest in the column of head, which is left blank
+  int age = chart.head - 1 - x;
+  if (age < 0) age += chart.width;
+  return age < count && !(count == chart.width && x == chart.head) ? age : -1;
+}
+
+static void check(const char *what, int c) {
+  int wrong = 0, outside = 0;
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 128; x++) {
+      int p = pixel(&srn_display_pixels, x, y);
+      if (x < chart.sr.xMin || x > chart.sr.xMax || y < chart.sr.yMin || y > chart.sr.yMax) {
+        if (p != pixel(&before, x, y)) outside++;
+        continue;
+      }
+      int age = model_age(x - chart.sr.xMin);
+      if (p != (age >= 0 && model_lit(age, y))) wrong++;
+    }
+  }
+  CHECK(wrong == 0, "chart %d mode %d style %d after %s: %d pixels differ", c, chart.mode,
+        chart.style, what, wrong);
+  CHECK(outside == 0, "chart %d after %s: %d pixels outside the region changed", c, what,
+        outside);
+}
+
+static void test_chart(int c) {
+  for (int page = 0; page < 16; page++) {
+    for (int col = 0; col < 128; col++) SRN_PAGE_BYTE(page, col) = srn_test_rand();
+  }
+  memcpy(before, srn_display_pixels, sizeof(before));
+  int l = srn_test_below(120), t = srn_test_below(120);
+  int r = l + 1 + srn_test_below(127 - l), b = t + srn_test_below(128 - t);
+  srn_strip_mode_t mode = srn_test_below(2) ? SRN_STRIP_SCROLL : SRN_STRIP_SWEEP;
+  CHECK(srn_strip_init(&chart, l, t, r, b, mode, srn_test_below(2)));
+  bool auto_range = srn_test_below(2);
+  if (auto_range) srn_strip_auto_range(&chart);
+  else srn_strip_set_range(&chart, -100, 100);
+  added = 0;
+  int samples = srn_test_below(SAMPLES);
+  for (int i = 0; i < samples; i++) {
+    // samples that wander, with a few jumps and some off the fixed range
+    srn_fix_t v = added > 0 && srn_test_below(8) ? aged(0) : 0;
+    v += (srn_fix_t)(srn_test_rand() % SRN_INT_TO_FIX(40)) - SRN_INT_TO_FIX(20);
+    bool full = chart.count == chart.width;
+    uint32_t redraws = chart.redraws;
+    srn_pixels_t shown;
+    memcpy(shown, srn_display_pixels, sizeof(shown));
+    srn_strip_add_q(&chart, v);
+    history[added++] = v;
+    if (mode == SRN_STRIP_SCROLL && full && chart.redraws == redraws) {
+      CHECK(memcmp(shown, srn_display_pixels, sizeof(shown)) == 0,
+            "chart %d: a full scroll was drawn before it was presented", c);
+    }
+    int what = srn_test_below(80);
+    if (what < 10) {
+      srn_strip_redraw(&chart);
+    } else if (what == 10) {
+      srn_strip_reset(&chart);
+      added = 0;
+    }
+    if (mode == SRN_STRIP_SCROLL && srn_test_below(4)) continue; // present later
+    srn_strip_present(&chart);
+    check("a sample", c);
+  }
+  srn_strip_present(&chart);
+  check("the last sample", c);
+}
+
+int main() {
+  for (int c = 0; c < CHARTS; c++) test_chart(c);
+  return srn_test_done("strip");
+}
@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* test_text.c
+ * Checks draw_text() pixel by pixel against a model that reads the glyphs
+ * one pixel at a time.  Strings in each built in font go at random
+ * positions on and off the display, with no clip or with clips that are
+ * partly or wholly off the display.  Pixels of the text cell inside the
+ * clip take the glyph, everything else must be left alone, and every
+ * changed pixel must be marked dirty.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sh1107_spi.h"
+#include "pixel_ops.h"
+#include "draw_char.h"
+#include "srn_fonts.h"
+#include "srn_test.h"
+
+#define ROUNDS 20000
+
+static srn_pixels_t before, expect;
+static const char *font_names[] = {"8x8", "8x8_prop", "16x16", "24x24_digits"};
+
+static inline int pixel(const srn_pixels_t *pixels, int x, int y) {
+  return (SRN_FB_BYTE(*pixels, y >> 3, x) >> (y & 7)) & 1;
+}
+
+static int glyph_pixel(const srn_font_t *font, uint8_t chr, int col, int row) {
+  int pages = (font->height + 7) >> 3;
+  if (col >= font->cell_width) return 0;
+  const uint8_t *glyph = font->glyphs + (chr - font->first) * font->cell_width * pages;
+  return (glyph[(row >> 3) * font->cell_width + col] >> (row & 7)) & 1;
+}
+
+// draw_text() a pixel at a time into expect, returning the x after it
+static int model_text(const srn_font_t *font, const screen_region_t *bounds,
+                      int x, int y, const char *str) {
+  for (; *str; str++) {
+    int left;
+    int advance = srn_glyph_advance(font, *str, &left);
+    for (int c = 0; c < advance; c++, x++) {
+      for (int row = 0; row < font->height; row++) {
+        int py = y + row;
+        if (x < bounds->xMin || x > bounds->xMax || py < bounds->yMin || py > bounds->yMax) {
+          continue;
+        }
+        uint8_t *p = &SRN_FB_BYTE(expect, py >> 3, x);
+        if (glyph_pixel(font, *str, left + c, row)) *p |= 1 << (py & 7);
+        else *p &= ~(1 << (py & 7));
+      }
+    }
+  }
+  return x;
+}
+
+static void random_string(char *str, const srn_font_t *font) {
+  int n = 1 + srn_test_below(8);
+  for (int i = 0; i < n; i++) {
+    // a few characters the font may not have
+    str[i] = srn_test_below(10) == 0 ? srn_test_below(256) :
+             font->first + srn_test_below(font->last - font->first + 1);
+    if (str[i] == 0) str[i] = ' ';
+  }
+  str[n] = 0;
+}
+
+int main() {
+  for (int t = 0; t < ROUNDS; t++) {
+    const srn_font_t *font = srn_font_find(font_names[srn_test_below(4)]);
+    for (int page = 0; page < 16; page++) {
+      for (int col = 0; col < 128; col++) SRN_PAGE_BYTE(page, col) = srn_test_rand();
+    }
+    memcpy(before, srn_display_pixels, sizeof(before));
+    memcpy(expect, srn_display_pixels, sizeof(expect));
+    memset(srn_dirty_min, 0xFF, sizeof(srn_dirty_min));
+    memset(srn_dirty_max, 0, sizeof(srn_dirty_max));
+
+    // the clip, if any, runs up to 40 pixels off the display
+    screen_region_t clip, bounds;
+    bool clipped = srn_test_below(3) != 0;
+    if (clipped) {
+      clip.xMin = srn_test_below(168) - 40;
+      clip.yMin = srn_test_below(168) - 40;
+      clip.xMax = clip.xMin + srn_test_below(208);
+      clip.yMax = clip.yMin + srn_test_below(208);
+    }
+    srn_clip_bounds(clipped ? &clip : NULL, &bounds);
+    int x = srn_test_below(180) - 40, y = srn_test_below(180) - 40;
+    char str[16];
+    random_string(str, font);
+
+    int end = draw_text(font, clipped ? &clip : NULL, x, y, str);
+    CHECK(end == model_text(font, &bounds, x, y, str), "round %d: wrong end", t);
+    int wrong = 0, undirty = 0;
+    for (int py = 0; py < 128; py++) {
+      for (int px = 0; px < 128; px++) {
+        int p = pixel(&srn_display_pixels, px, py);
+        if (p != pixel(&expect, px, py)) wrong++;
+        if (p != pixel(&before, px, py) &&
+            (px < srn_dirty_min[py >> 3] || px > srn_dirty_max[py >> 3])) {
+          undirty++;
+        }
+      }
+    }
+    CHECK(wrong == 0, "round %d: \"%s\" at %d,%d: %d pixels differ", t, str, x, y, wrong);
+    CHECK(undirty == 0, "round %d: %d changed pixels not dirty", t, undirty);
+    for (int page = 0; page < 16; page++) {
+      if (srn_dirty_min[page] > srn_dirty_max[page]) continue;
+      CHECK(srn_dirty_min[page] <= 127 && srn_dirty_max[page] <= 127,
+            "round %d: page %d dirty from %d to %d", t, page, srn_dirty_min[page],
+            srn_dirty_max[page]);
+    }
+  }
+  return srn_test_done("text");
+}
@@ -0,0 +1,286 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* font_compiler.c
+ * Host tool that turns a font into a header with a srn_font_t (see
+ * draw_char.h).  The glyphs are written page by page in the byte layout of
+ * srn_display_pixels, so drawing a glyph of any size is a copy of its page
+ * bytes.
+ *
+ * The input can be a BDF font, a PSF (version 1 or 2) console font, or the
+ * built in font8x8_basic scaled up by a whole number.
+ *
+ *   font_compiler [-s scale] [-r first-last] [-p] [-n name] [-o out.h] input
+ *
+ *   input   a .bdf or .psf file, or "builtin" for font8x8_basic
+ *   -s      scale every pixel to scale x scale pixels
+ *   -r      range of characters to keep, as numbers or quoted characters
+ *   -p      add per glyph metrics for proportional text
+ *   -n      name of the srn_font_t, srn_font by default
+ *   -o      output file, stdout by default
+ *
+ * For example the large digits are made with
+ *   font_compiler -s 3 -r 32-58 -n srn_font8x8_3x_digits -o font8x8_3x_digits.h builtin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../font8x8_basic.h"
+
+#define MAX_GLYPHS 256
+#define MAX_SIZE 64  // largest cell in pixels
+
+// FONT
+// A font is read into one bitmap per character, pixel[y][x].
+
+typedef struct glyph {
+  bool present;
+  int advance;  // from the font, or 0 to use the pixels
+  uint8_t pixel[MAX_SIZE][MAX_SIZE];
+} glyph_t;
+
+static glyph_t glyphs[MAX_GLYPHS];
+static int font_w, font_h;
+
+static void fail(const char *msg, const char *arg) {
+  fprintf(stderr, "font_compiler: %s %s\n", msg, arg ? arg : "");
+  exit(1);
+}
+
+static void read_builtin() {
+  font_w = 8;
+  font_h = 8;
+  for (int c = 0; c < 128; c++) {
+    glyphs[c].present = true;
+    for (int x = 0; x < 8; x++) {
+      for (int y = 0; y < 8; y++) {
+        glyphs[c].pixel[y][x] = (font8x8_basic[c][x] >> y) & 1;
+      }
+    }
+  }
+}
+
+static void read_bdf(FILE *f) {
+  char line[256];
+  int fbb_w = 0, fbb_h = 0, fbb_x = 0, fbb_y = 0;
+  int enc = -1, w = 0, h = 0, xo = 0, yo = 0, dwidth = 0;
+  int row = -1;
+  while (fgets(line, sizeof(line), f)) {
+    if (sscanf(line, "FONTBOUNDINGBOX %d %d %d %d", &fbb_w, &fbb_h, &fbb_x, &fbb_y) == 4) {
+      if (fbb_w > MAX_SIZE || fbb_h > MAX_SIZE) fail("font too large", NULL);
+      font_w = fbb_w;
+      font_h = fbb_h;
+    } else if (sscanf(line, "ENCODING %d", &enc) == 1) {
+      row = -1;
+    } else if (sscanf(line, "DWIDTH %d", &dwidth) == 1) {
+    } else if (sscanf(line, "BBX %d %d %d %d", &w, &h, &xo, &yo) == 4) {
+    } else if (strncmp(line, "BITMAP", 6) == 0) {
+      row = 0;
+      if (enc >= 0 && enc < MAX_GLYPHS) {
+        glyphs[enc].present = true;
+        glyphs[enc].advance = dwidth;
+      }
+    } else if (strncmp(line, "ENDCHAR", 7) == 0) {
+      row = -1;
+      enc = -1;
+    } else if (row >= 0) {
+      if (enc >= 0 && enc < MAX_GLYPHS) {
+        unsigned long bits = strtoul(line, NULL, 16);
+        int nbits = (int)(strspn(line, "0123456789abcdefABCDEF") * 4);
+        // the glyph box sits on the baseline of the font box
+        int y = (fbb_h + fbb_y) - (h + yo) + row;
+        for (int i = 0; i < w; i++) {
+          int x = xo - fbb_x + i;
+          if (x < 0 || x >= font_w || y < 0 || y >= font_h) continue;
+          glyphs[enc].pixel[y][x] = (bits >> (nbits - 1 - i)) & 1;
+        }
+      }
+      row++;
+    }
+  }
+  if (font_w == 0) fail("no FONTBOUNDINGBOX in BDF font", NULL);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void read_psf(FILE *f) {
+  static uint8_t buf[1 << 20];
+  size_t len = fread(buf, 1, sizeof(buf), f);
+  uint32_t count, size, offset;
+  if (len >= 4 && buf[0] == 0x36 && buf[1] == 0x04) {
+    font_w = 8;
+    font_h = buf[3];
+    count = (buf[2] & 1) ? 512 : 256;
+    size = font_h;
+    offset = 4;
+  } else if (len >= 32 && get32(buf) == 0x864ab572) {
+    offset = get32(buf + 8);
+    count = get32(buf + 16);
+    size = get32(buf + 20);
+    font_h = get32(buf + 24);
+    font_w = get32(buf + 28);
+  } else {
+    fail("not a PSF font", NULL);
+  }
+  if (font_w > MAX_SIZE || font_h > MAX_SIZE) fail("font too large", NULL);
+  int row_bytes = (font_w + 7) / 8;
+  for (uint32_t c = 0; c < count && c < MAX_GLYPHS; c++) {
+    const uint8_t *g = buf + offset + c * size;
+    if (g + size > buf + len) break;
+    glyphs[c].present = true;
+    for (int y = 0; y < font_h; y++) {
+      for (int x = 0; x < font_w; x++) {
+        glyphs[c].pixel[y][x] = (g[y * row_bytes + x / 8] >> (7 - x % 8)) & 1;
+      }
+    }
+  }
+}
+
+static void scale_font(int s) {
+  if (font_w * s > MAX_SIZE || font_h * s > MAX_SIZE) fail("scaled font too large", NULL);
+  static uint8_t tmp[MAX_SIZE][MAX_SIZE];
+  for (int c = 0; c < MAX_GLYPHS; c++) {
+    memcpy(tmp, glyphs[c].pixel, sizeof(tmp));
+    for (int y = 0; y < font_h * s; y++) {
+      for (int x = 0; x < font_w * s; x++) {
+        glyphs[c].pixel[y][x] = tmp[y / s][x / s];
+      }
+    }
+    glyphs[c].advance *= s;
+  }
+  font_w *= s;
+  font_h *= s;
+}
+
+// OUTPUT
+
+static int parse_char(const char *s, char **end) {
+  if (s[0] == '\'' && s[1] && s[2] == '\'') {
+    *end = (char *)s + 3;
+    return (uint8_t)s[1];
+  }
+  return (int)strtol(s, end, 0);
+}
+
+static void write_font(FILE *out, const char *title, const char *name, int first,
+                       int last, bool proportional, const char *cmdline) {
+  int pages = (font_h + 7) / 8;
+  fprintf(out, "/* %s\n * Generated by tools/font_compiler, do not edit.\n", title);
+  fprintf(out, " *   %s\n */\n\n", cmdline);
+  fprintf(out, "static const uint8_t %s_glyphs[] = {\n", name);
+  for (int c = first; c <= last; c++) {
+    fprintf(out, "  // 0x%02X", c);
+    if (c >= 0x20 && c < 0x7F) fprintf(out, " (%c)", c);
+    fprintf(out, "\n");
+    for (int p = 0; p < pages; p++) {
+      fprintf(out, "  ");
+      for (int x = 0; x < font_w; x++) {
+        uint8_t b = 0;
+        for (int i = 0; i < 8 && p * 8 + i < font_h; i++) {
+          b |= glyphs[c].pixel[p * 8 + i][x] << i;
+        }
+        fprintf(out, "0x%02X,%s", b, x == font_w - 1 ? "\n" : " ");
+      }
+    }
+  }
+  fprintf(out, "};\n\n");
+  if (proportional) {
+    fprintf(out, "static const srn_glyph_metrics_t %s_metrics[] = {\n", name);
+    for (int c = first; c <= last; c++) {
+      int left = -1, right = -1;
+      for (int x = 0; x < font_w; x++) {
+        for (int y = 0; y < font_h; y++) {
+          if (glyphs[c].pixel[y][x]) {
+            if (left < 0) left = x;
+            right = x;
+            break;
+          }
+        }
+      }
+      int l = 0, w = 0;
+      if (left >= 0) {
+        l = left;
+        w = right - left + 1;
+      } else if (c == ' ') {  // blank columns for the space
+        w = glyphs[c].advance ? glyphs[c].advance : (font_w * 3 + 7) / 8;
+      }
+      fprintf(out, "  {%d, %d},   // 0x%02X\n", l, w, c);
+    }
+    fprintf(out, "};\n\n");
+  }
+  fprintf(out, "const srn_font_t %s = {\n", name);
+  fprintf(out, "  .first = %d, .last = %d, .height = %d, .cell_width = %d, .spacing = %d,\n",
+          first, last, font_h, font_w, proportional ? (font_w + 7) / 8 : 0);
+  fprintf(out, "  .glyphs = %s_glyphs, .metrics = %s%s,\n", name,
+          proportional ? name : "NULL", proportional ? "_metrics" : "");
+  fprintf(out, "};\n");
+}
+
+int main(int argc, char **argv) {
+  int scale = 1;
+  int first = 0x20, last = 0x7E;
+  bool proportional = false;
+  const char *name = "srn_font";
+  const char *out_path = NULL;
+  const char *in_path = NULL;
+  char cmdline[512] = "font_compiler";
+  for (int i = 1; i < argc; i++) {
+    if (strlen(cmdline) + strlen(argv[i]) + 2 < sizeof(cmdline)) {
+      strcat(cmdline, " ");
+      strcat(cmdline, argv[i]);
+    }
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      scale = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      char *end;
+      first = parse_char(argv[i + 1], &end);
+      if (*end != '-') fail("bad range", argv[i + 1]);
+      last = parse_char(end + 1, &end);
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      name = argv[i + 1];
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      out_path = argv[i + 1];
+    } else if (strcmp(argv[i], "-p") == 0) {
+      proportional = true;
+      continue;
+    } else {
+      in_path = argv[i];
+      continue;
+    }
+    // options with a value
+    i++;
+    strcat(cmdline, " ");
+    strncat(cmdline, argv[i], sizeof(cmdline) - strlen(cmdline) - 1);
+  }
+  if (in_path == NULL) fail("usage: font_compiler [-s scale] [-r first-last] [-p] [-n name] [-o out.h] input", NULL);
+  if (first < 0 || last >= MAX_GLYPHS || first > last) fail("bad range", NULL);
+  if (scale < 1) fail("bad scale", NULL);
+
+  if (strcmp(in_path, "builtin") == 0) {
+    read_builtin();
+  } else {
+    FILE *f = fopen(in_path, "rb");
+    if (f == NULL) fail("can not open", in_path);
+    const char *ext = strrchr(in_path, '.');
+    if (ext && strcmp(ext, ".bdf") == 0) read_bdf(f);
+    else read_psf(f);
+    fclose(f);
+  }
+  if (scale > 1) scale_font(scale);
+
+  FILE *out = stdout;
+  if (out_path && (out = fopen(out_path, "w")) == NULL) fail("can not write", out_path);
+  const char *title = out_path ? out_path : name;
+  if (out_path && strrchr(out_path, '/')) title = strrchr(out_path, '/') + 1;
+  write_font(out, title, name, first, last, proportional, cmdline);
+  if (out != stdout) fclose(out);
+  return 0;
+}
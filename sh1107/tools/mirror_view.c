@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* mirror_view.c
+ * Host tool that shows the frames a srn_mirror_t sends (see srn_mirror.h).
+ * It reads the USB CDC port of the Pico, or any file or pipe with a
+ * recorded stream, draws each frame in the terminal and passes the text
+ * the program printed on to stderr.
+ *
+ *   mirror_view [-p prefix] [-q] [port]
+ *
+ *   port    the serial port, for example /dev/ttyACM0, stdin by default
+ *   -p      also writes every frame as prefix0000.pbm, prefix0001.pbm ...
+ *   -q      does not draw the frames, for recording with -p
+ *
+ * On exit it prints the frames shown and the frames lost.  A recording
+ * of the port made with cat can be played back later:
+ *   cat /dev/ttyACM0 > screen.bin
+ *   mirror_view -p shot < screen.bin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include "srn_mirror.h"
+
+static const char *prefix;
+static bool quiet;
+static volatile sig_atomic_t stop;
+
+static void fail(const char *msg, const char *arg) {
+  fprintf(stderr, "mirror_view: %s %s\n", msg, arg ? arg : "");
+  exit(1);
+}
+
+static inline bool pixel(const uint8_t *frame, int x, int y) {
+  return frame[(y >> 3) * 128 + x] & (1 << (y & 7));
+}
+
+// two rows of pixels to a line of half blocks, 128 x 64 characters
+static void draw(const uint8_t *frame) {
+  static const char *cells[4] = {" ", "▀", "▄", "█"};
+  fputs("\033[H", stdout);
+  for (int y = 0; y < 128; y += 2) {
+    for (int x = 0; x < 128; x++) {
+      fputs(cells[pixel(frame, x, y) | pixel(frame, x, y + 1) << 1], stdout);
+    }
+    fputs("\033[K\n", stdout);
+  }
+  fflush(stdout);
+}
+
+static void write_pbm(const uint8_t *frame, int n) {
+  char name[256];
+  snprintf(name, sizeof(name), "%s%04d.pbm", prefix, n);
+  FILE *f = fopen(name, "wb");
+  if (f == NULL) fail("can not write", name);
+  fprintf(f, "P4\n128 128\n");
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 128; x += 8) {
+      uint8_t b = 0;
+      for (int i = 0; i < 8; i++) b |= pixel(frame, x + i, y) << (7 - i);
+      fputc(b, f);
+    }
+  }
+  fclose(f);
+}
+
+static void frame_done(void *ctx, const uint8_t *frame) {
+  srn_mirror_view_t *view = (srn_mirror_view_t *)ctx;
+  if (!quiet) draw(frame);
+  if (prefix) write_pbm(frame, view->frames - 1);
+}
+
+static void text(void *ctx, uint8_t c) {
+  fputc(c, stderr);
+}
+
+static void on_signal(int sig) {
+  stop = 1;
+}
+
+// raw bytes from a serial port, with DTR up so the Pico sees a listener
+static void set_raw(int fd) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0) return; // not a tty
+  cfmakeraw(&tio);
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+  tcsetattr(fd, TCSANOW, &tio);
+}
+
+int main(int argc, char **argv) {
+  const char *port = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) prefix = argv[++i];
+    else if (strcmp(argv[i], "-q") == 0) quiet = true;
+    else if (argv[i][0] == '-') fail("unknown option", argv[i]);
+    else port = argv[i];
+  }
+  int fd = 0;
+  if (port) {
+    fd = open(port, O_RDONLY | O_NOCTTY);
+    if (fd < 0) fail("can not open", port);
+  }
+  set_raw(fd);
+  signal(SIGINT, on_signal);
+
+  static srn_mirror_view_t view;
+  srn_mirror_view_init(&view);
+  view.text = text;
+  if (!quiet) fputs("\033[2J", stdout);
+  uint8_t buf[4096];
+  while (!stop) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0) break;
+    srn_mirror_view_feed(&view, buf, n, frame_done, &view);
+  }
+  fprintf(stderr, "\nmirror_view: %u frames, %u lost\n", view.frames, view.errors);
+  return 0;
+}
@@ -0,0 +1,219 @@
+/**
+ * Copyright (c) 2021 John Robinson.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* sprite_compiler.c
+ * Host tool that turns a PBM image into a header with a srn_sprite_t (see
+ * draw_sprite.h).  The sprite is written in all 8 vertical shifts within a
+ * page, in the byte layout of srn_display_pixels, so draw_sprite() only
+ * combines bytes and never shifts pixels.
+ *
+ *   sprite_compiler [-m mask.pbm | -k] [-f frames] [-n name] [-o out.h] image.pbm
+ *
+ *   image   a P1 or P4 PBM file, a 1 is a lit pixel
+ *   -m      mask of the same size, a 1 is an opaque pixel.  Without a mask
+ *           the sprite is ORed in and its unlit pixels are transparent
+ *   -k      the whole rectangle is opaque
+ *   -f      the image is a strip of frames side by side, written as an
+ *           array of srn_sprite_t
+ *   -n      name of the srn_sprite_t, srn_sprite by default
+ *   -o      output file, stdout by default
+ *
+ * For example the status icons are made with
+ *   sprite_compiler -k -n srn_icon_battery -o icon_battery.h battery.pbm
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+
+#define MAX_SIZE 128
+
+// IMAGES
+// A PBM image is read into pixel[y][x].
+
+typedef struct image {
+  int width, height;
+  uint8_t pixel[MAX_SIZE][MAX_SIZE];
+} image_t;
+
+static image_t image, mask;
+
+static void fail(const char *msg, const char *arg) {
+  fprintf(stderr, "sprite_compiler: %s %s\n", msg, arg ? arg : "");
+  exit(1);
+}
+
+// reads the next number of the header, skipping white space and comments
+static int read_number(FILE *f) {
+  int c;
+  while ((c = fgetc(f)) != EOF) {
+    if (c == '#') {
+      while ((c = fgetc(f)) != EOF && c != '\n') {}
+    } else if (!isspace(c)) {
+      break;
+    }
+  }
+  int n = 0;
+  while (c != EOF && isdigit(c)) {
+    n = n * 10 + c - '0';
+    c = fgetc(f);
+  }
+  return n;
+}
+
+static void read_pbm(const char *path, image_t *img) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) fail("can not open", path);
+  char magic[2];
+  if (fread(magic, 1, 2, f) != 2 || magic[0] != 'P' || (magic[1] != '1' && magic[1] != '4')) {
+    fail("not a PBM image", path);
+  }
+  img->width = read_number(f);
+  img->height = read_number(f);
+  if (img->width < 1 || img->height < 1 ||
+      img->width > MAX_SIZE || img->height > MAX_SIZE) fail("bad image size", path);
+  for (int y = 0; y < img->height; y++) {
+    if (magic[1] == '4') {  // rows of packed bits, most significant first
+      uint8_t row[MAX_SIZE / 8];
+      int n = (img->width + 7) / 8;
+      if (fread(row, 1, n, f) != (size_t)n) fail("image too short", path);
+      for (int x = 0; x < img->width; x++) {
+        img->pixel[y][x] = (row[x / 8] >> (7 - x % 8)) & 1;
+      }
+    } else {
+      for (int x = 0; x < img->width; x++) {
+        int c;
+        while ((c = fgetc(f)) != EOF && c != '0' && c != '1') {}
+        if (c == EOF) fail("image too short", path);
+        img->pixel[y][x] = c == '1';
+      }
+    }
+  }
+  fclose(f);
+}
+
+// OUTPUT
+
+// the byte of page p of a frame drawn s rows below a page boundary
+static uint8_t shifted_byte(const image_t *img, int x0, int x, int s, int p) {
+  uint8_t b = 0;
+  for (int i = 0; i < 8; i++) {
+    int y = p * 8 + i - s;
+    if (y >= 0 && y < img->height && img->pixel[y][x0 + x]) b |= 1 << i;
+  }
+  return b;
+}
+
+static void write_shifts(FILE *out, const char *name, const char *what, const image_t *img,
+                         int x0, int width, int pages) {
+  fprintf(out, "static const uint8_t %s_%s[] = {\n", name, what);
+  for (int s = 0; s < 8; s++) {
+    fprintf(out, "  // shift %d\n", s);
+    for (int p = 0; p < pages; p++) {
+      fprintf(out, "  ");
+      for (int x = 0; x < width; x++) {
+        fprintf(out, "0x%02X,%s", shifted_byte(img, x0, x, s, p), x == width - 1 ? "\n" : " ");
+      }
+    }
+  }
+  fprintf(out, "};\n\n");
+}
+
+static void write_sprites(FILE *out, const char *title, const char *name, int frames,
+                          bool has_mask, const char *cmdline) {
+  int width = image.width / frames;
+  int height = image.height;
+  int pages = (height + 14) / 8;  // enough for the largest shift
+  fprintf(out, "/* %s\n * Generated by tools/sprite_compiler, do not edit.\n", title);
+  fprintf(out, " *   %s\n */\n\n", cmdline);
+  char frame_name[256];
+  for (int f = 0; f < frames; f++) {
+    if (frames > 1) snprintf(frame_name, sizeof(frame_name), "%s_%d", name, f);
+    else snprintf(frame_name, sizeof(frame_name), "%s", name);
+    write_shifts(out, frame_name, "image", &image, f * width, width, pages);
+    if (has_mask) write_shifts(out, frame_name, "mask", &mask, f * width, width, pages);
+  }
+  if (frames > 1) fprintf(out, "const srn_sprite_t %s[%d] = {\n", name, frames);
+  for (int f = 0; f < frames; f++) {
+    if (frames > 1) snprintf(frame_name, sizeof(frame_name), "%s_%d", name, f);
+    else snprintf(frame_name, sizeof(frame_name), "%s", name);
+    fprintf(out, "%s", frames > 1 ? "  {" : "const srn_sprite_t ");
+    if (frames == 1) fprintf(out, "%s = {", name);
+    fprintf(out, ".width = %d, .height = %d, .pages = %d,\n", width, height, pages);
+    fprintf(out, "   .image = %s_image, .mask = %s%s}%s\n", frame_name,
+            has_mask ? frame_name : "NULL", has_mask ? "_mask" : "",
+            frames > 1 ? "," : ";");
+  }
+  if (frames > 1) fprintf(out, "};\n");
+}
+
+int main(int argc, char **argv) {
+  const char *name = "srn_sprite";
+  const char *out_path = NULL;
+  const char *in_path = NULL;
+  const char *mask_path = NULL;
+  bool opaque = false;
+  int frames = 1;
+  char cmdline[512] = "sprite_compiler";
+  for (int i = 1; i < argc; i++) {
+    if (strlen(cmdline) + strlen(argv[i]) + 2 < sizeof(cmdline)) {
+      strcat(cmdline, " ");
+      strcat(cmdline, argv[i]);
+    }
+    if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      mask_path = argv[i + 1];
+    } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      frames = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      name = argv[i + 1];
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      out_path = argv[i + 1];
+    } else if (strcmp(argv[i], "-k") == 0) {
+      opaque = true;
+      continue;
+    } else {
+      in_path = argv[i];
+      continue;
+    }
+    // options with a value
+    i++;
+    strcat(cmdline, " ");
+    strncat(cmdline, argv[i], sizeof(cmdline) - strlen(cmdline) - 1);
+  }
+  if (in_path == NULL) {
+    fail("usage: sprite_compiler [-m mask.pbm | -k] [-f frames] [-n name] [-o out.h] image.pbm", NULL);
+  }
+  read_pbm(in_path, &image);
+  if (frames < 1 || image.width % frames != 0) fail("width is not a whole number of frames", NULL);
+  if (mask_path != NULL) {
+    read_pbm(mask_path, &mask);
+    if (mask.width != image.width || mask.height != image.height) {
+      fail("mask is not the size of the image", mask_path);
+    }
+  } else if (opaque) {
+    mask.width = image.width;
+    mask.height = image.height;
+    memset(mask.pixel, 1, sizeof(mask.pixel));
+  }
+  bool has_mask = mask_path != NULL || opaque;
+  if (has_mask) {
+    // lit pixels outside the mask would not be drawn
+    for (int y = 0; y < image.height; y++) {
+      for (int x = 0; x < image.width; x++) image.pixel[y][x] &= mask.pixel[y][x];
+    }
+  }
+
+  FILE *out = stdout;
+  if (out_path && (out = fopen(out_path, "w")) == NULL) fail("can not write", out_path);
+  const char *title = out_path ? out_path : name;
+  if (out_path && strrchr(out_path, '/')) title = strrchr(out_path, '/') + 1;
+  write_sprites(out, title, name, frames, has_mask, cmdline);
+  if (out != stdout) fclose(out);
+  return 0;
+}